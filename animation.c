@@ -0,0 +1,48 @@
+#include <stddef.h>
+#include "animation.h"
+#include "crc.h"
+#include "pixel_format.h"
+
+static uint32_t AnimationHeaderCrc(const struct AnimationHeader* header)
+{
+    return Crc32((const uint8_t*) header, offsetof(struct AnimationHeader, headerCrc));
+}
+
+bool AnimationHeaderValid(const struct AnimationHeader* header, uint32_t available)
+{
+    if (header->magic != ANIMATION_MAGIC || header->format != ANIMATION_FORMAT ||
+        header->headerLength != sizeof(struct AnimationHeader) || header->headerCrc != AnimationHeaderCrc(header))
+    {
+        return false;
+    }
+
+    if (header->pixelFormat >= PIXEL_FORMATS || header->pixelCount == 0 || header->frameCount == 0 ||
+        header->frameStride < header->pixelCount * AnimationPixelBytes(header))
+    {
+        return false;
+    }
+
+    //  All of the frames have to be there
+    uint64_t length = header->headerLength + (uint64_t) header->frameStride * header->frameCount;
+
+    return length <= available;
+}
+
+uint32_t AnimationPixelBytes(const struct AnimationHeader* header)
+{
+    return (uint32_t) PixelFormatBits((int) header->pixelFormat) / 8;
+}
+
+void AnimationHeaderInit(struct AnimationHeader* header, uint32_t pixelCount, uint32_t frameCount, uint32_t frameIntervalUs,
+                         uint32_t pixelFormat)
+{
+    header->magic = ANIMATION_MAGIC;
+    header->format = ANIMATION_FORMAT;
+    header->headerLength = sizeof(struct AnimationHeader);
+    header->pixelCount = pixelCount;
+    header->frameCount = frameCount;
+    header->frameIntervalUs = frameIntervalUs;
+    header->pixelFormat = pixelFormat;
+    header->frameStride = pixelCount * AnimationPixelBytes(header);
+    header->headerCrc = AnimationHeaderCrc(header);
+}
@@ -0,0 +1,56 @@
+#ifndef PICOPIXOS_ANIMATION_H
+#define PICOPIXOS_ANIMATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Flash Animation Container
+//
+//  A pre-rendered sequence laid out so frames can be DMAed from flash into the PIO with no CPU work:
+//
+//      Offset  Size    Field
+//      0       32      struct AnimationHeader (little endian)
+//      32      ...     frameCount frames, each frameStride bytes apart
+//
+//  Each frame is pixelCount pixels already packed for the string, in pixelFormat's channel order (pixel_format.h),
+//  3 bytes a pixel or 4 for the RGBW formats.  It only plays when the running pixel format matches, older
+//  containers have 0 there and are GRB.  The container sits at ANIMATION_FLASH_OFFSET, load it with
+//
+//      picotool load -o 0x10100000 animation.ppa
+//
+
+//  'PPXA'
+#define ANIMATION_MAGIC 0x41585050u
+#define ANIMATION_FORMAT 1
+
+//  Where the container lives, and how much room it has before the boot frame and settings on a 2 MB flash
+#define ANIMATION_FLASH_OFFSET (1024 * 1024)
+#define ANIMATION_FLASH_SIZE (1024 * 1024 - 12 * 4096)
+
+struct AnimationHeader
+{
+    uint32_t magic;
+    uint16_t format;
+    uint16_t headerLength;
+    uint32_t pixelCount;
+    uint32_t frameCount;
+    uint32_t frameIntervalUs;
+    uint32_t frameStride;
+    uint32_t pixelFormat;
+
+    //  CRC-32 of everything above
+    uint32_t headerCrc;
+};
+
+//  Checks the header and that every frame fits in available bytes
+bool AnimationHeaderValid(const struct AnimationHeader* header, uint32_t available);
+
+//  Bytes each pixel takes in a frame
+uint32_t AnimationPixelBytes(const struct AnimationHeader* header);
+
+//  Fill in a header, including its CRC
+void AnimationHeaderInit(struct AnimationHeader* header, uint32_t pixelCount, uint32_t frameCount, uint32_t frameIntervalUs,
+                         uint32_t pixelFormat);
+
+#endif
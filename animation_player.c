@@ -0,0 +1,129 @@
+#include "hal.h"
+#include "animation_player.h"
+#include "settings_store.h"
+#include "trace.h"
+
+//  Gap after the last byte leaves the FIFO so the string latches, longest of the supported chips
+const uint32_t ANIMATION_LATCH_US = 300;
+
+bool AnimationPlayerInit(struct AnimationPlayerStruct* player)
+{
+    //  Uncached, so streaming frames doesn't push code out of the XIP cache
+    player->header = (const struct AnimationHeader*) HalFlashReadUncached(ANIMATION_FLASH_OFFSET);
+    player->frames = (const uint8_t*) player->header + sizeof(struct AnimationHeader);
+
+    player->playing = false;
+    player->frame = 0;
+    player->framesPlayed = 0;
+    player->framesLate = 0;
+
+    //  Container can run up to the boot frame
+    uint32_t available = SettingsStoreFlashOffset() - BOOT_FRAME_SECTORS * HAL_FLASH_SECTOR_SIZE - ANIMATION_FLASH_OFFSET;
+
+    return AnimationHeaderValid(player->header, available);
+}
+
+bool AnimationPlayerStart(struct AnimationPlayerStruct* player, int pixelFormat)
+{
+    if (!AnimationPlayerInit(player))
+    {
+        return false;
+    }
+
+    //  Frames go to the PIO as they are, packed for some other string they'd come out in the wrong colours
+    if (player->header->pixelFormat != (uint32_t) pixelFormat)
+    {
+        return false;
+    }
+
+    //  Whatever put_pixel left queued goes out in the pixel format first
+    HalPixelOutputFlush(ANIMATION_LATCH_US);
+
+    if (!HalPixelBytesBegin())
+    {
+        return false;
+    }
+
+    player->playing = true;
+    player->dmaPending = false;
+    player->nextFrameTime = HalTimeUs();
+
+    return true;
+}
+
+void AnimationPlayerStop(struct AnimationPlayerStruct* player)
+{
+    if (!player->playing)
+    {
+        return;
+    }
+
+    //  Let the last frame finish and drain before changing how the output pulls
+    while (HalPixelBytesBusy())
+    {
+        HalIdle();
+    }
+    HalPixelOutputFlush(ANIMATION_LATCH_US);
+
+    HalPixelBytesEnd();
+    player->playing = false;
+}
+
+void AnimationPlayerService(struct AnimationPlayerStruct* player, bool paused, uint32_t maxWaitUs)
+{
+    if (!player->playing)
+    {
+        return;
+    }
+
+    if (player->dmaPending && !HalPixelBytesBusy())
+    {
+        TraceRecord(TRACE_DMA_DONE, (uint16_t) (player->framesPlayed - 1));
+        player->dmaPending = false;
+    }
+
+    uint64_t now = HalTimeUs();
+
+    if (player->nextFrameTime > now)
+    {
+        //  Not due yet
+        if (player->nextFrameTime - now > maxWaitUs)
+        {
+            HalSleepUs(maxWaitUs);
+            return;
+        }
+        HalSleepUs(player->nextFrameTime - now);
+    }
+
+    //  Previous frame still going out, the sequence is faster than the string
+    if (HalPixelBytesBusy())
+    {
+        player->framesLate++;
+        player->nextFrameTime += player->header->frameIntervalUs;
+        return;
+    }
+
+    //  Last bytes have to leave the FIFO and the line sit low long enough to latch
+    if (player->framesPlayed > 0)
+    {
+        HalPixelOutputFlush(ANIMATION_LATCH_US);
+    }
+
+    HalPixelBytesWrite(player->frames + player->frame * player->header->frameStride,
+                       player->header->pixelCount * AnimationPixelBytes(player->header));
+    player->dmaPending = true;
+
+    player->framesPlayed++;
+    player->nextFrameTime += player->header->frameIntervalUs;
+
+    //  Don't try to catch up after a stall, just carry on from now
+    if (player->nextFrameTime < HalTimeUs())
+    {
+        player->nextFrameTime = HalTimeUs() + player->header->frameIntervalUs;
+    }
+
+    if (!paused)
+    {
+        player->frame = (player->frame + 1) % player->header->frameCount;
+    }
+}
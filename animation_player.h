@@ -0,0 +1,46 @@
+#ifndef PICOPIXOS_ANIMATION_PLAYER_H
+#define PICOPIXOS_ANIMATION_PLAYER_H
+
+#include "hal.h"
+#include "animation.h"
+
+//
+//  Flash Animation Player
+//
+//  Streams frames from the container in flash straight into the PIO TX FIFO with DMA, so playing a sequence
+//  takes no RAM for frames and no CPU per pixel.  While playing, the pixel output is in byte stream mode
+//  (HalPixelBytesBegin) and nothing else may write to it.
+//
+
+struct AnimationPlayerStruct
+{
+    const struct AnimationHeader* header;
+    const uint8_t* frames;
+
+    bool playing;
+    uint32_t frame;
+    uint64_t nextFrameTime;
+
+    //  A frame has gone to DMA and not been seen to finish
+    bool dmaPending;
+
+    //
+    //  Statistics
+    //
+    uint32_t framesPlayed;
+    uint32_t framesLate;
+};
+
+//  Look for a container in flash, returns false if there isn't a valid one
+bool AnimationPlayerInit(struct AnimationPlayerStruct* player);
+
+//  Take over the pixel output, refused unless the container was packed for pixelFormat
+bool AnimationPlayerStart(struct AnimationPlayerStruct* player, int pixelFormat);
+
+//  Finish the frame in flight and give the pixel output back
+void AnimationPlayerStop(struct AnimationPlayerStruct* player);
+
+//  Start the next frame once it's due, waits up to maxWaitUs for it.  Frames don't advance while paused.
+void AnimationPlayerService(struct AnimationPlayerStruct* player, bool paused, uint32_t maxWaitUs);
+
+#endif
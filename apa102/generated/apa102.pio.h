@@ -0,0 +1,83 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------ //
+// apa102 //
+// ------ //
+
+#define apa102_wrap_target 6
+#define apa102_wrap 24
+
+#define apa102_offset_frame 0u
+#define apa102_offset_pixel 6u
+#define apa102_offset_brightness 13u
+
+static const uint16_t apa102_program_instructions[] = {
+    0x80a0, //  0: pull   block           side 0     
+    0xa027, //  1: mov    x, osr          side 0     
+    0x6060, //  2: out    null, 32        side 0     
+    0xe000, //  3: set    pins, 0         side 0     
+    0xb042, //  4: nop                    side 1     
+    0x0044, //  5: jmp    x--, 4          side 0     
+            //     .wrap_target
+    0x80e0, //  6: pull   ifempty block   side 0     
+    0xe001, //  7: set    pins, 1         side 0     
+    0xb042, //  8: nop                    side 1     
+    0xe001, //  9: set    pins, 1         side 0     
+    0xb042, // 10: nop                    side 1     
+    0xe001, // 11: set    pins, 1         side 0     
+    0xb042, // 12: nop                    side 1     
+    0xe001, // 13: set    pins, 1         side 0     
+    0xb042, // 14: nop                    side 1     
+    0xe001, // 15: set    pins, 1         side 0     
+    0xb042, // 16: nop                    side 1     
+    0xe001, // 17: set    pins, 1         side 0     
+    0xb042, // 18: nop                    side 1     
+    0xe001, // 19: set    pins, 1         side 0     
+    0xb042, // 20: nop                    side 1     
+    0xe001, // 21: set    pins, 1         side 0     
+    0xf037, // 22: set    x, 23           side 1     
+    0x6001, // 23: out    pins, 1         side 0     
+    0x1057, // 24: jmp    x--, 23         side 1     
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program apa102_program = {
+    .instructions = apa102_program_instructions,
+    .length = 25,
+    .origin = -1,
+};
+
+static inline pio_sm_config apa102_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + apa102_wrap_target, offset + apa102_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+
+#include "hardware/clocks.h"
+static inline void apa102_program_init(PIO pio, uint sm, uint offset, uint pin_data, uint pin_clock, float freq) {
+    pio_sm_set_pins_with_mask(pio, sm, 0, (1u << pin_clock) | (1u << pin_data));
+    pio_sm_set_pindirs_with_mask(pio, sm, ~0u, (1u << pin_clock) | (1u << pin_data));
+    pio_gpio_init(pio, pin_clock);
+    pio_gpio_init(pio, pin_data);
+    pio_sm_config c = apa102_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin_data, 1);
+    sm_config_set_set_pins(&c, pin_data, 1);
+    sm_config_set_sideset_pins(&c, pin_clock);
+    sm_config_set_out_shift(&c, false, true, 24);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    // Two cycles a bit
+    float div = clock_get_hz(clk_sys) / (2 * freq);
+    sm_config_set_clkdiv(&c, div);
+    pio_sm_init(pio, sm, offset + apa102_offset_frame, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif
@@ -0,0 +1,283 @@
+#include "audio.h"
+
+//  Log power of a full scale sine through the window, in the FFT's units, and where the level scale starts
+#define AUDIO_FULL_SCALE_LOG2 40
+#define AUDIO_FLOOR_LOG16 ((AUDIO_FULL_SCALE_LOG2 - AUDIO_RANGE_LOG2) * 16)
+
+//  A butterfly can grow a value by up to 1 + sqrt(2), so a stage halves once when anything is at or over 2^13
+//  and twice at 2^14
+#define AUDIO_FFT_HEADROOM 8192
+
+//  Bass over its average by this much in 16ths of a factor of two (about 4.5 dB) is a beat, no more often than
+//  every AUDIO_BEAT_HOLD_BLOCKS blocks (about 125 ms)
+#define AUDIO_BEAT_RISE 24
+#define AUDIO_BEAT_HOLD_BLOCKS 8
+
+//  64 Hz bins at 16384 Hz: 64, 128, 192, 320, 512, 896, 1664, 3328 up to 8192 Hz
+const uint8_t AudioBandEdges[AUDIO_BANDS + 1] = {1, 2, 3, 5, 8, 14, 26, 52, AUDIO_BLOCK_SAMPLES / 2};
+
+//  Quarter of a sine wave in 256ths of a turn, Q15
+static const int16_t AudioSine[65] =
+        {
+                0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+                6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+                12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+                18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+                23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+                27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+                30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+                32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+                32767
+        };
+
+//  8 bit reversal, for loading the FFT input in the order the butterflies want it
+#define AUDIO_REVERSE_2(n) n, n + 2 * 64, n + 1 * 64, n + 3 * 64
+#define AUDIO_REVERSE_4(n) AUDIO_REVERSE_2(n), AUDIO_REVERSE_2(n + 2 * 16), AUDIO_REVERSE_2(n + 1 * 16), \
+                           AUDIO_REVERSE_2(n + 3 * 16)
+#define AUDIO_REVERSE_6(n) AUDIO_REVERSE_4(n), AUDIO_REVERSE_4(n + 2 * 4), AUDIO_REVERSE_4(n + 1 * 4), \
+                           AUDIO_REVERSE_4(n + 3 * 4)
+
+static const uint8_t AudioBitReverse[AUDIO_BLOCK_SAMPLES] =
+        {
+                AUDIO_REVERSE_6(0), AUDIO_REVERSE_6(2), AUDIO_REVERSE_6(1), AUDIO_REVERSE_6(3)
+        };
+
+//  Written by AudioPublish, the sequence is odd while it's part way through
+static struct AudioLevels AudioShared;
+static volatile uint32_t AudioSequence = 0;
+
+static inline int AudioSin(int angle)
+{
+    int quarter = angle & 63;
+
+    switch ((angle >> 6) & 3)
+    {
+        case 0: return AudioSine[quarter];
+        case 1: return AudioSine[64 - quarter];
+        case 2: return -AudioSine[quarter];
+        default: return -AudioSine[64 - quarter];
+    }
+}
+
+static inline int AudioCos(int angle)
+{
+    return AudioSin(angle + 64);
+}
+
+static inline int AudioAbs(int value)
+{
+    return value < 0 ? -value : value;
+}
+
+//
+//  log2 in 16ths, the fraction straight from the bits under the top one
+//
+static int AudioLog2(uint64_t value)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    int top = 63;
+    while (!(value >> top))
+    {
+        top--;
+    }
+
+    int fraction = top >= 4 ? (int) (value >> (top - 4)) & 15 : (int) (value << (4 - top)) & 15;
+
+    return top * 16 + fraction;
+}
+
+//
+//  Log power in 16ths to 0 to 255
+//
+static uint8_t AudioLevel(int log16)
+{
+    int level = (log16 - AUDIO_FLOOR_LOG16) * 255 / (AUDIO_RANGE_LOG2 * 16);
+
+    if (level < 0)
+    {
+        return 0;
+    }
+    if (level > 255)
+    {
+        return 255;
+    }
+    return (uint8_t) level;
+}
+
+//
+//  Straight up, an eighth of the way back down each block
+//
+static uint8_t AudioSmooth(uint8_t previous, uint8_t level)
+{
+    if (level >= previous)
+    {
+        return level;
+    }
+    return (uint8_t) (previous - (previous - level + 7) / 8);
+}
+
+void AudioAnalyserInit(struct AudioAnalyserStruct* analyser)
+{
+    for (int i = 0; i < AUDIO_BANDS; i++)
+    {
+        analyser->levels.bands[i] = 0;
+    }
+    analyser->levels.level = 0;
+    analyser->levels.beats = 0;
+    analyser->levels.blocks = 0;
+
+    analyser->bias = 0;
+    analyser->bassAverage = 0;
+    analyser->lastBeatBlock = 0;
+}
+
+int AudioFft(int16_t* real, int16_t* imaginary)
+{
+    int shifts = 0;
+    int peak = 0;
+
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+    {
+        peak |= AudioAbs(real[i]) | AudioAbs(imaginary[i]);
+    }
+
+    //  Radix 2 decimation in time, the input is already in bit reversed order
+    for (int half = 1, step = AUDIO_BLOCK_SAMPLES / 2; half < AUDIO_BLOCK_SAMPLES; half <<= 1, step >>= 1)
+    {
+        int shift = peak >= 2 * AUDIO_FFT_HEADROOM ? 2 : peak >= AUDIO_FFT_HEADROOM ? 1 : 0;
+        shifts += shift;
+        peak = 0;
+
+        for (int j = 0; j < half; j++)
+        {
+            int twiddleReal = AudioCos(j * step);
+            int twiddleImaginary = -AudioSin(j * step);
+
+            for (int a = j; a < AUDIO_BLOCK_SAMPLES; a += 2 * half)
+            {
+                int b = a + half;
+                int productReal = (real[b] * twiddleReal - imaginary[b] * twiddleImaginary) >> 15;
+                int productImaginary = (real[b] * twiddleImaginary + imaginary[b] * twiddleReal) >> 15;
+
+                int sumReal = (real[a] + productReal) >> shift;
+                int sumImaginary = (imaginary[a] + productImaginary) >> shift;
+                int differenceReal = (real[a] - productReal) >> shift;
+                int differenceImaginary = (imaginary[a] - productImaginary) >> shift;
+
+                real[a] = (int16_t) sumReal;
+                imaginary[a] = (int16_t) sumImaginary;
+                real[b] = (int16_t) differenceReal;
+                imaginary[b] = (int16_t) differenceImaginary;
+
+                //  Only whether a bit is set at the headroom or above matters, OR is enough
+                peak |= AudioAbs(sumReal) | AudioAbs(sumImaginary) | AudioAbs(differenceReal) |
+                        AudioAbs(differenceImaginary);
+            }
+        }
+    }
+
+    return shifts;
+}
+
+void AudioAnalyse(struct AudioAnalyserStruct* analyser, const uint16_t* samples)
+{
+    struct AudioLevels* levels = &analyser->levels;
+    int16_t* real = analyser->real;
+    int16_t* imaginary = analyser->imaginary;
+
+    //  Whatever the bias on the pin is, averaged over blocks.  Taking off each block's own mean would leave a step
+    //  that the window spreads into the lowest band whenever a block doesn't hold whole cycles.
+    int32_t sum = 0;
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+    {
+        sum += samples[i];
+    }
+    int mean = (int) (sum >> (AUDIO_FFT_BITS - 4));
+    analyser->bias = levels->blocks == 0 ? mean : analyser->bias + (mean - analyser->bias) / 16;
+
+    //  12 bits up to 15, through a Hann window, sin^2 from the cosine
+    for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+    {
+        int sample = (samples[i] * 16 - analyser->bias) / 2;
+        int window = (32768 - AudioCos(i)) >> 1;
+        int index = AudioBitReverse[i];
+
+        real[index] = (int16_t) ((sample * window) >> 15);
+        imaginary[index] = 0;
+    }
+
+    //  Each halving is a factor of four in power
+    int scale = AudioFft(real, imaginary) * 2 * 16;
+
+    uint64_t total = 0;
+    uint64_t bass = 0;
+
+    for (int band = 0; band < AUDIO_BANDS; band++)
+    {
+        uint64_t power = 0;
+
+        for (int bin = AudioBandEdges[band]; bin < AudioBandEdges[band + 1]; bin++)
+        {
+            power += (uint32_t) (real[bin] * real[bin]) + (uint32_t) (imaginary[bin] * imaginary[bin]);
+        }
+
+        levels->bands[band] = AudioSmooth(levels->bands[band], AudioLevel(AudioLog2(power) + scale));
+
+        total += power;
+        if (band < 2)
+        {
+            bass += power;
+        }
+    }
+
+    levels->level = AudioSmooth(levels->level, AudioLevel(AudioLog2(total) + scale));
+
+    //  The first block sets the average, there's nothing yet for it to be a beat against
+    int bassLog = AudioLog2(bass) + scale;
+    if (levels->blocks == 0)
+    {
+        analyser->bassAverage = bassLog;
+    }
+    else if (bassLog > analyser->bassAverage + AUDIO_BEAT_RISE && bassLog > AUDIO_FLOOR_LOG16 &&
+             levels->blocks - analyser->lastBeatBlock >= AUDIO_BEAT_HOLD_BLOCKS)
+    {
+        levels->beats++;
+        analyser->lastBeatBlock = levels->blocks;
+    }
+    analyser->bassAverage += (bassLog - analyser->bassAverage) / 16;
+
+    levels->blocks++;
+}
+
+void AudioPublish(const struct AudioLevels* levels)
+{
+    AudioSequence++;
+    __sync_synchronize();
+
+    AudioShared = *levels;
+
+    __sync_synchronize();
+    AudioSequence++;
+}
+
+bool AudioRead(struct AudioLevels* levels)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = AudioSequence;
+        __sync_synchronize();
+
+        *levels = AudioShared;
+
+        __sync_synchronize();
+    }
+    while ((sequence & 1) || sequence != AudioSequence);
+
+    return sequence != 0;
+}
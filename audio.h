@@ -0,0 +1,82 @@
+#ifndef PICOPIXOS_AUDIO_H
+#define PICOPIXOS_AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Audio Analysis
+//
+//  Turns blocks of AUDIO_BLOCK_SAMPLES 12 bit ADC samples into levels effects can use.  Each block has the input's
+//  bias taken off, gets a Hann window and a fixed-point FFT, and the power in each bin is summed into AUDIO_BANDS
+//  bands an octave or so wide from 64 Hz to the top.  The FFT is 16 bit with block floating point: a stage only
+//  halves its outputs when the biggest input could overflow, and the halvings are counted back in afterwards,
+//  so quiet input keeps its precision on the M0+ with no FPU.
+//
+//  Levels are log power, 0 to 255 across AUDIO_RANGE_LOG2 factors of two (3 dB each) up to a full scale sine.
+//  Bands rise straight away and fall back over a few blocks, which is what bars on LEDs want.  A beat is the
+//  bass jumping well above its running average.
+//
+//  Core 1 analyses and publishes, effects on core 0 read.  Publishing goes through a sequence count that is odd
+//  while a write is under way, AudioRead copies the levels and tries again if the count was odd or moved, so
+//  neither side ever waits on a lock.
+//
+
+#define AUDIO_SAMPLE_RATE 16384
+#define AUDIO_FFT_BITS 8
+#define AUDIO_BLOCK_SAMPLES (1 << AUDIO_FFT_BITS)
+#define AUDIO_BANDS 8
+
+//  Levels run from full scale down this many factors of two in power
+#define AUDIO_RANGE_LOG2 16
+
+//  Published results
+struct AudioLevels
+{
+    //  Per band, bass first, 0 to 255
+    uint8_t bands[AUDIO_BANDS];
+
+    //  Every band together, same scale
+    uint8_t level;
+
+    //  Counts up on every beat, compare with the count last seen
+    uint32_t beats;
+
+    //  Blocks analysed
+    uint32_t blocks;
+};
+
+struct AudioAnalyserStruct
+{
+    struct AudioLevels levels;
+
+    //  Input bias in 16ths of a sample, a running average over blocks
+    int bias;
+
+    //  Bass power as log2 in 16ths, a running average and when the last beat was
+    int bassAverage;
+    uint32_t lastBeatBlock;
+
+    //  FFT working buffers
+    int16_t real[AUDIO_BLOCK_SAMPLES];
+    int16_t imaginary[AUDIO_BLOCK_SAMPLES];
+};
+
+//  First FFT bin of each band and the end of the last, AUDIO_BANDS + 1 of them
+extern const uint8_t AudioBandEdges[AUDIO_BANDS + 1];
+
+void AudioAnalyserInit(struct AudioAnalyserStruct* analyser);
+
+//  Analyse one block of samples (0 to 4095) into analyser->levels
+void AudioAnalyse(struct AudioAnalyserStruct* analyser, const uint16_t* samples);
+
+//  In place FFT of AUDIO_BLOCK_SAMPLES points, returns how many times the outputs were halved
+int AudioFft(int16_t* real, int16_t* imaginary);
+
+//  Make levels the latest, from the one core that analyses
+void AudioPublish(const struct AudioLevels* levels);
+
+//  Copy out the latest levels from any core, false if nothing has been published
+bool AudioRead(struct AudioLevels* levels);
+
+#endif
@@ -0,0 +1,121 @@
+#include "automata.h"
+#include "fast_random.h"
+
+//  Bits of a row's last word that are cells
+static inline uint32_t AutomataLastMask(int width)
+{
+    return 0xFFFFFFFFu >> (31 - ((width - 1) & 31));
+}
+
+//  Each bit set where the cell to its left is alive, wrapping at the edge
+static inline uint32_t AutomataLeft(const uint32_t* row, int word, int words, int lastBit)
+{
+    uint32_t carry = word > 0 ? row[word - 1] >> 31 : (row[words - 1] >> lastBit) & 1;
+
+    return row[word] << 1 | carry;
+}
+
+//  Each bit set where the cell to its right is alive, wrapping at the edge
+static inline uint32_t AutomataRight(const uint32_t* row, int word, int words, int lastBit)
+{
+    if (word < words - 1)
+    {
+        return row[word] >> 1 | row[word + 1] << 31;
+    }
+
+    return row[word] >> 1 | (row[0] & 1) << lastBit;
+}
+
+void LifeStep(const uint32_t* cells, uint32_t* next, int width, int height)
+{
+    int words = AUTOMATA_WORDS(width);
+    int lastBit = (width - 1) & 31;
+    uint32_t lastMask = AutomataLastMask(width);
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint32_t* up = cells + (y > 0 ? y - 1 : height - 1) * words;
+        const uint32_t* row = cells + y * words;
+        const uint32_t* down = cells + (y < height - 1 ? y + 1 : 0) * words;
+        uint32_t* out = next + y * words;
+
+        for (int w = 0; w < words; w++)
+        {
+            uint32_t a = AutomataLeft(up, w, words, lastBit);
+            uint32_t b = up[w];
+            uint32_t c = AutomataRight(up, w, words, lastBit);
+            uint32_t d = AutomataLeft(row, w, words, lastBit);
+            uint32_t e = AutomataRight(row, w, words, lastBit);
+            uint32_t f = AutomataLeft(down, w, words, lastBit);
+            uint32_t g = down[w];
+            uint32_t h = AutomataRight(down, w, words, lastBit);
+
+            //  Ones of the three rows, and their carries into the twos
+            uint32_t ones0 = a ^ b ^ c;
+            uint32_t twos0 = (a & b) | (c & (a ^ b));
+            uint32_t ones1 = d ^ e;
+            uint32_t twos1 = d & e;
+            uint32_t ones2 = f ^ g ^ h;
+            uint32_t twos2 = (f & g) | (h & (f ^ g));
+
+            //  Bit 0 of the count, with one more carry
+            uint32_t count0 = ones0 ^ ones1 ^ ones2;
+            uint32_t twos3 = (ones0 & ones1) | (ones2 & (ones0 ^ ones1));
+
+            //  Bits 1 and 2 from the four twos, 8 wraps to 0 which is dead either way
+            uint32_t twosSum = twos0 ^ twos1 ^ twos2;
+            uint32_t foursA = (twos0 & twos1) | (twos2 & (twos0 ^ twos1));
+            uint32_t count1 = twosSum ^ twos3;
+            uint32_t foursB = twosSum & twos3;
+            uint32_t count2 = foursA ^ foursB;
+
+            //  Three neighbours, or two and already alive
+            out[w] = count1 & ~count2 & (count0 | row[w]);
+        }
+
+        out[words - 1] &= lastMask;
+    }
+}
+
+void RuleStep(const uint32_t* cells, uint32_t* next, int width, uint8_t rule)
+{
+    int words = AUTOMATA_WORDS(width);
+    int lastBit = (width - 1) & 31;
+
+    for (int w = 0; w < words; w++)
+    {
+        uint32_t left = AutomataLeft(cells, w, words, lastBit);
+        uint32_t centre = cells[w];
+        uint32_t right = AutomataRight(cells, w, words, lastBit);
+        uint32_t result = 0;
+
+        //  Rule bit n turns on the neighbourhood left, centre, right that reads n in binary
+        for (int pattern = 0; pattern < 8; pattern++)
+        {
+            if (rule & (1 << pattern))
+            {
+                result |= (pattern & 4 ? left : ~left) & (pattern & 2 ? centre : ~centre) &
+                          (pattern & 1 ? right : ~right);
+            }
+        }
+
+        next[w] = result;
+    }
+
+    next[words - 1] &= AutomataLastMask(width);
+}
+
+void AutomataRandomise(uint32_t* cells, int width, int height, uint32_t* random)
+{
+    int words = AUTOMATA_WORDS(width);
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int w = 0; w < words; w++)
+        {
+            cells[y * words + w] = FastRandom(random);
+        }
+
+        cells[y * words + words - 1] &= AutomataLastMask(width);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef PICOPIXOS_AUTOMATA_H
+#define PICOPIXOS_AUTOMATA_H
+
+#include <stdint.h>
+
+//
+//  Cellular Automata
+//
+//  Grids are bitsets, a row at a time, AUTOMATA_WORDS(width) words to a row with cell x at bit x % 32 of word
+//  x / 32.  Bits past the width in a row's last word are kept clear.  Both edges wrap round.
+//
+//  A generation is worked out 32 cells at a time.  For Life the eight neighbour bits of each cell come from
+//  the rows above and below and from shifting, and a tree of bitwise adders counts them into three bit planes,
+//  so there's no per cell loop at all.  A 1D rule ORs together the patterns its rule number turns on.
+//
+
+#define AUTOMATA_WORDS(width) (((width) + 31) / 32)
+
+//  Conway's Life, B3/S23, from cells into next
+void LifeStep(const uint32_t* cells, uint32_t* next, int width, int height);
+
+//  A Wolfram rule, 0 to 255, one row from cells into next
+void RuleStep(const uint32_t* cells, uint32_t* next, int width, uint8_t rule);
+
+//  Fill a grid with random cells
+void AutomataRandomise(uint32_t* cells, int width, int height, uint32_t* random);
+
+#endif
@@ -0,0 +1,476 @@
+//
+//  picopixos_bench - Per pixel cost of the pixel pipeline kernels
+//
+//  Runs each kernel over 64 to 16384 pixels and prints one line per kernel and size:
+//
+//      BENCH kernel=random pixels=1024 iterations=800 ns_per_pixel=12.301 pixels_per_s=81293000 cycles_per_pixel=1.538
+//
+//  Keys and their order don't change between releases, so results can be diffed or grepped straight out of a
+//  log.  Times come from the RP2040 timer on the board and a monotonic clock on the host, each result is the
+//  best of a few batches of at least BENCH_BATCH_US.  cycles_per_pixel is na on the host.  Other lines start
+//  with BENCH_INFO.
+//
+//  The particles kernel counts particles as pixels.
+//
+//  The image kernel decodes a 16 colour picture the size of the matrix, coded once per size in setup.  Setup
+//  borrows the other kernels' buffers rather than adding RAM the board doesn't have.
+//
+//  The audio kernel counts samples as pixels and analyses them a block of AUDIO_BLOCK_SAMPLES at a time, sizes
+//  under a block still analyse a whole one.
+//
+//  The bit plane kernels work through the pixels a chunk at a time, the whole string's planes wouldn't fit in
+//  the RP2040's RAM.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal.h"
+#include "effects.h"
+#include "pixel_monitor.h"
+#include "pixel_matrix.h"
+#include "fast_random.h"
+#include "particles.h"
+#include "fire.h"
+#include "automata.h"
+#include "text.h"
+#include "image.h"
+#include "audio.h"
+#include "ws2812/ws2812_planes.h"
+
+#define BENCH_MAX_PIXELS 16384
+#define BENCH_PLANE_CHUNK 64
+
+//  Shortest batch that counts, and how many batches to take the best of
+const uint64_t BENCH_BATCH_US = 50000;
+const int BENCH_BATCHES = 3;
+
+const int BenchSizes[] = {64, 256, 1024, 4096, 16384};
+
+//  Status screen monitor area
+const int BENCH_MONITOR_WIDTH = 66;
+const int BENCH_MONITOR_HEIGHT = 20;
+
+static int Pixels[BENCH_MAX_PIXELS];
+static uint32_t Words[BENCH_MAX_PIXELS];
+static int Canvas[BENCH_MAX_PIXELS];
+
+//  16 x 16 serpentine tiles in serpentine rows, turned a quarter, rebuilt when the size changes
+static struct PixelMatrixStruct Matrix;
+
+static uint8_t StringData[2][BENCH_PLANE_CHUNK * 4];
+static string_t BenchStrings[2] =
+        {
+                {StringData[0], BENCH_PLANE_CHUNK * 3, 0x40},
+                {StringData[1], BENCH_PLANE_CHUNK * 4, 0x100}
+        };
+static string_t* BenchStringList[2] = {&BenchStrings[0], &BenchStrings[1]};
+static value_bits_t Colors[BENCH_PLANE_CHUNK * 4];
+static value_bits_t States[2][BENCH_PLANE_CHUNK * 4];
+
+static struct PixelMonitorSettings Monitor;
+static char MonitorBuffer[16384];
+
+//  Stops the compiler dropping work nothing looks at
+volatile int BenchSink;
+
+//
+//  Kernels
+//
+static void BenchRandom(int count)
+{
+    EffectRandom(Pixels, count);
+}
+
+static void BenchBrightnessMask(int count)
+{
+    PixelBrightnessMask(Pixels, count, 0x07);
+}
+
+static void BenchTransformStrings(int count)
+{
+    for (int done = 0; done < count; done += BENCH_PLANE_CHUNK)
+    {
+        //  RGB values for the chunk, WRGB string along side as in ws2812_parallel.c
+        transform_strings(BenchStringList, 2, Colors, BENCH_PLANE_CHUNK * 3, 0x100);
+    }
+    BenchSink = Colors[0].planes[0];
+}
+
+static void BenchAddError(int count)
+{
+    for (int done = 0; done < count; done += BENCH_PLANE_CHUNK)
+    {
+        dither_values(Colors, States[done & 1], States[(done & 1) ^ 1], BENCH_PLANE_CHUNK * 3);
+    }
+    BenchSink = States[0][0].planes[0];
+}
+
+static void BenchMonitorFrame(int count)
+{
+    //  Full redraw, every cell sampled and sent
+    Monitor.invalidate = true;
+    BenchSink = BuildPixelMonitorFrame(&Monitor, Pixels, count, 5, MonitorBuffer, sizeof(MonitorBuffer),
+                                       3, 13, BENCH_MONITOR_WIDTH, BENCH_MONITOR_HEIGHT);
+}
+
+static void BenchPackGRB(int count)
+{
+    PixelFormatGetPacker(PIXEL_FORMAT_GRB)(Pixels, Words, count);
+    BenchSink = Words[0];
+}
+
+static void BenchPackRGBW(int count)
+{
+    PixelFormatGetPacker(PIXEL_FORMAT_RGBW)(Pixels, Words, count);
+    BenchSink = Words[0];
+}
+
+//  Noise over 64 wide rows, a row at a time the way the effects use it
+static void NoiseRowsFor(int count, int dimensions)
+{
+    uint8_t* values = (uint8_t*) Words;
+
+    for (int done = 0; done < count; done += 64)
+    {
+        if (dimensions == 2)
+        {
+            Noise2DRow(values + done, 64, 0, NOISE_ONE / 6, done / 64 * (NOISE_ONE / 6));
+        }
+        else
+        {
+            Noise3DRow(values + done, 64, 0, NOISE_ONE / 6, done / 64 * (NOISE_ONE / 6), 1000);
+        }
+    }
+    BenchSink = values[0];
+}
+
+static void BenchNoise2D(int count)
+{
+    NoiseRowsFor(count, 2);
+}
+
+static void BenchNoise3D(int count)
+{
+    NoiseRowsFor(count, 3);
+}
+
+static void BenchLava(int count)
+{
+    //  Whole effect, noise and palette, on a 64 wide canvas
+    EffectLava(Canvas, 64, count / 64 ? count / 64 : 1, 1000);
+    BenchSink = Canvas[0];
+}
+
+static struct ParticleSystem Particles;
+
+static void BenchParticles(int count)
+{
+    //  Spawn, one step and splat onto a 64 x 64 canvas, a pool full at a time
+    uint32_t random = FAST_RANDOM_SEED;
+
+    for (int done = 0; done < count; done += PARTICLE_CAPACITY)
+    {
+        ParticleSystemInit(&Particles, 3);
+        for (int i = 0; i < count - done && i < PARTICLE_CAPACITY; i++)
+        {
+            uint32_t r = FastRandom(&random);
+            ParticleSpawn(&Particles, (r & 0x3FFF) + 8 * PARTICLE_ONE, (r >> 14 & 0x1FFF) + 8 * PARTICLE_ONE,
+                          (int16_t) ((r >> 24) - 128), 16, 0x102030, 64);
+        }
+        ParticleUpdate(&Particles, 64, 64);
+        ParticleSplat(&Particles, Canvas, 64, 64);
+    }
+    BenchSink = Canvas[0];
+}
+
+static void BenchFire(int count)
+{
+    //  One step of a 32 wide grid, the heat kept in Words
+    static const struct FireSettings settings = {40, 100};
+    static uint32_t random = FAST_RANDOM_SEED;
+    uint8_t* heat = (uint8_t*) Words;
+
+    FireStep(heat, 32, count / 32 ? count / 32 : 1, &settings, &random);
+    BenchSink = heat[0];
+}
+
+static void BenchLife(int count)
+{
+    //  One generation of a 64 wide grid, both grids in Words
+    int height = count / 64 ? count / 64 : 1;
+    LifeStep(Words, Words + BENCH_MAX_PIXELS / 2, 64, height);
+    BenchSink = Words[BENCH_MAX_PIXELS / 2];
+}
+
+static void BenchRule(int count)
+{
+    //  One generation of a count wide row
+    RuleStep(Words, Words + BENCH_MAX_PIXELS / 2, count, 30);
+    BenchSink = Words[BENCH_MAX_PIXELS / 2];
+}
+
+static struct TextLayout Text;
+
+static void BenchTicker(int count)
+{
+    //  A frame of scrolling text on a 64 wide canvas
+    EffectTicker(Canvas, 64, count / 64 ? count / 64 : 1, 12345);
+    BenchSink = Canvas[0];
+}
+
+static void BenchTextLayout(int count)
+{
+    //  What the cache saves, laying out a message every frame
+    for (int done = 0; done < count; done += 64)
+    {
+        TextLayoutMessage(&Text, "The quick brown fox jumps");
+    }
+    BenchSink = Text.columns[0];
+}
+
+static void BenchMatrixFor(int count)
+{
+    if (Matrix.table != NULL && Matrix.width * Matrix.height == count)
+    {
+        return;
+    }
+
+    struct PixelMatrixLayout layout = {16, count < 256 ? count / 16 : 16, count < 256 ? 1 : count / 256, 1,
+                                       PIXEL_MATRIX_SERPENTINE | PIXEL_MATRIX_TILE_SERPENTINE, 1};
+
+    PixelMatrixFree(&Matrix);
+    PixelMatrixInit(&Matrix, &layout, count);
+}
+
+static void BenchMatrixTable(int count)
+{
+    BenchMatrixFor(count);
+    PixelMatrixPresent(&Matrix, Canvas, Pixels);
+    BenchSink = Pixels[0];
+}
+
+static void BenchMatrixCompute(int count)
+{
+    BenchMatrixFor(count);
+    for (int y = 0; y < Matrix.height; y++)
+    {
+        for (int x = 0; x < Matrix.width; x++)
+        {
+            Pixels[PixelMatrixIndex(&Matrix.layout, x, y)] = Canvas[y * Matrix.width + x];
+        }
+    }
+    BenchSink = Pixels[0];
+}
+
+//  Coded picture for the image kernel, kept in Words between setup and the runs
+static int ImageCodesLength;
+
+static struct ImageDecoderStruct* BenchImageDecoder()
+{
+    return (struct ImageDecoderStruct*) Canvas;
+}
+
+static void BenchImageSetup(int count)
+{
+    BenchMatrixFor(count);
+
+    //  Soft diagonal bands with some speckle, about as compressible as pixel art
+    uint8_t* indices = (uint8_t*) Pixels;
+    uint32_t state = FAST_RANDOM_SEED;
+    for (int y = 0; y < Matrix.height; y++)
+    {
+        for (int x = 0; x < Matrix.width; x++)
+        {
+            indices[y * Matrix.width + x] = (uint8_t) (((x + y) / 3 + (FastRandomRange(&state, 8) == 0)) & 15);
+        }
+    }
+
+    struct ImageEncoderStruct* encoder = (struct ImageEncoderStruct*) Canvas;
+    ImageCodesLength = ImageEncodeLzw(encoder, (uint8_t*) Words, indices, count, 4);
+
+    uint8_t palette[16 * 3];
+    for (int i = 0; i < 16 * 3; i++)
+    {
+        palette[i] = (uint8_t) (i * 16);
+    }
+    ImageDecoderSetPalette(BenchImageDecoder(), palette, 16);
+}
+
+static void BenchImage(int count)
+{
+    struct ImageDecoderStruct* decoder = BenchImageDecoder();
+
+    ImageDecoderBegin(decoder, Matrix.width, Matrix.height, 4, -1, Pixels, &Matrix);
+    BenchSink = ImageDecoderFeed(decoder, (const uint8_t*) Words, ImageCodesLength);
+    (void) count;
+}
+
+static struct AudioAnalyserStruct BenchAnalyser;
+
+static uint16_t* BenchAudioSamples()
+{
+    return (uint16_t*) Words;
+}
+
+static void BenchAudioSetup(int count)
+{
+    //  A square wave around 512 Hz over noise, biased like an ADC input
+    uint16_t* samples = BenchAudioSamples();
+    uint32_t state = FAST_RANDOM_SEED;
+    int length = count < AUDIO_BLOCK_SAMPLES ? AUDIO_BLOCK_SAMPLES : count;
+
+    for (int i = 0; i < length; i++)
+    {
+        samples[i] = (uint16_t) (2048 + ((i / 16) & 1 ? 600 : -600) + (int) FastRandomRange(&state, 256) - 128);
+    }
+    AudioAnalyserInit(&BenchAnalyser);
+}
+
+static void BenchAudio(int count)
+{
+    const uint16_t* samples = BenchAudioSamples();
+    int blocks = count < AUDIO_BLOCK_SAMPLES ? 1 : count / AUDIO_BLOCK_SAMPLES;
+
+    for (int block = 0; block < blocks; block++)
+    {
+        AudioAnalyse(&BenchAnalyser, samples + block * AUDIO_BLOCK_SAMPLES);
+    }
+    BenchSink = BenchAnalyser.levels.bands[3];
+}
+
+struct BenchKernel
+{
+    const char* name;
+    void (*run)(int count);
+
+    //  Run once per size before timing, if there is one
+    void (*setup)(int count);
+};
+
+const struct BenchKernel BenchKernels[] =
+        {
+                {"random", BenchRandom},
+                {"brightness_mask", BenchBrightnessMask},
+                {"transform_strings", BenchTransformStrings},
+                {"add_error", BenchAddError},
+                {"monitor_frame", BenchMonitorFrame},
+                {"pack_grb", BenchPackGRB},
+                {"pack_rgbw", BenchPackRGBW},
+                {"matrix_table", BenchMatrixTable},
+                {"matrix_compute", BenchMatrixCompute},
+                {"noise_2d", BenchNoise2D},
+                {"noise_3d", BenchNoise3D},
+                {"lava", BenchLava},
+                {"particles", BenchParticles},
+                {"fire_step", BenchFire},
+                {"life_step", BenchLife},
+                {"rule_step", BenchRule},
+                {"ticker", BenchTicker},
+                {"text_layout", BenchTextLayout},
+                {"image_decode", BenchImage, BenchImageSetup},
+                {"audio_block", BenchAudio, BenchAudioSetup}
+        };
+
+//
+//  Time one kernel at one size and print its line
+//
+static void BenchRun(const struct BenchKernel* kernel, int count)
+{
+    uint64_t bestUs = 0;
+    uint32_t bestIterations = 1;
+
+    if (kernel->setup != NULL)
+    {
+        kernel->setup(count);
+    }
+
+    //  Warm up caches and anything allocated on first use
+    kernel->run(count);
+
+    for (int batch = 0; batch < BENCH_BATCHES; batch++)
+    {
+        uint32_t iterations = 0;
+        uint64_t start = HalTimeUs();
+        uint64_t elapsed;
+
+        do
+        {
+            kernel->run(count);
+            iterations++;
+            elapsed = HalTimeUs() - start;
+        }
+        while (elapsed < BENCH_BATCH_US);
+
+        //  Compare per iteration, batches run different counts
+        if (batch == 0 || elapsed * bestIterations < bestUs * iterations)
+        {
+            bestUs = elapsed;
+            bestIterations = iterations;
+        }
+    }
+
+    double nsPerPixel = (double) bestUs * 1000.0 / ((double) bestIterations * count);
+
+    printf("BENCH kernel=%s pixels=%d iterations=%lu ns_per_pixel=%.3f pixels_per_s=%.0f cycles_per_pixel=",
+           kernel->name, count, (unsigned long) bestIterations, nsPerPixel, 1e9 / nsPerPixel);
+
+    if (HalCpuHz() != 0)
+    {
+        printf("%.3f\n", nsPerPixel * HalCpuHz() / 1e9);
+    }
+    else
+    {
+        printf("na\n");
+    }
+}
+
+static void BenchAll()
+{
+#ifdef PICOPIXOS_HOST
+    printf("BENCH_INFO platform=host cpu_hz=0\n");
+#else
+    printf("BENCH_INFO platform=rp2040 cpu_hz=%lu\n", (unsigned long) HalCpuHz());
+#endif
+
+    for (unsigned k = 0; k < sizeof(BenchKernels) / sizeof(BenchKernels[0]); k++)
+    {
+        for (unsigned s = 0; s < sizeof(BenchSizes) / sizeof(BenchSizes[0]); s++)
+        {
+            BenchRun(&BenchKernels[k], BenchSizes[s]);
+        }
+    }
+
+    printf("BENCH_INFO done\n");
+}
+
+int main()
+{
+    HalConsoleInit();
+
+    //  Something to chew on
+    srand(1);
+    EffectsInit(FAST_RANDOM_SEED);
+    EffectTickerSetMessage("Pico Pix OS bench");
+    EffectRandom(Pixels, BENCH_MAX_PIXELS);
+    for (int i = 0; i < 2; i++)
+    {
+        for (unsigned j = 0; j < sizeof(StringData[i]); j++)
+        {
+            StringData[i][j] = rand();
+        }
+    }
+    PixelMonitorInit(&Monitor);
+
+#ifdef PICOPIXOS_HOST
+    BenchAll();
+#else
+    //  Run over and over so there's always a full set to catch once the USB serial port is opened
+    while (1)
+    {
+        HalSleepMs(5000);
+        BenchAll();
+    }
+#endif
+
+    return 0;
+}
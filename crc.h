@@ -0,0 +1,31 @@
+#ifndef PICOPIXOS_CRC_H
+#define PICOPIXOS_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+//  CRC-32 (IEEE 802.3, reflected, same as zlib)
+//
+//  Start with CRC32_INITIAL, feed data through Crc32Update as it arrives, and finish with Crc32Final.
+//
+#define CRC32_INITIAL 0xFFFFFFFFu
+
+extern const uint32_t CRC32_TABLE[256];
+
+static inline uint32_t Crc32UpdateByte(uint32_t crc, uint8_t data)
+{
+    return CRC32_TABLE[(crc ^ data) & 0xFF] ^ (crc >> 8);
+}
+
+uint32_t Crc32Update(uint32_t crc, const uint8_t* data, size_t length);
+
+static inline uint32_t Crc32Final(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFFu;
+}
+
+//  One shot CRC over a block of memory
+uint32_t Crc32(const uint8_t* data, size_t length);
+
+#endif
@@ -0,0 +1,630 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "effects.h"
+#include "particles.h"
+#include "pixel_format.h"
+#include "fast_random.h"
+#include "fire.h"
+#include "automata.h"
+#include "text.h"
+#include "audio.h"
+
+//  Noise is worked out a run of a canvas row at a time
+#define EFFECT_NOISE_RUN 64
+
+//  Lattice cells a pixel, in noise units
+#define EFFECT_NOISE_SCALE (NOISE_ONE / 6)
+
+static int LavaPalette[256];
+static int CloudPalette[256];
+static int WaterPalette[256];
+static int FirePalette[256];
+static int LifePalette[256];
+static int RulePalette[256];
+static int RainbowPalette[256];
+
+static const struct EffectPaletteStop LavaStops[] =
+        {
+                {0, 0, 0, 0}, {96, 160, 0, 0}, {176, 255, 64, 0}, {232, 255, 192, 0}, {255, 255, 255, 96}
+        };
+
+static const struct EffectPaletteStop CloudStops[] =
+        {
+                {0, 0, 48, 160}, {112, 16, 96, 224}, {176, 192, 208, 255}, {255, 255, 255, 255}
+        };
+
+static const struct EffectPaletteStop FireStops[] =
+        {
+                {0, 0, 0, 0}, {96, 255, 0, 0}, {176, 255, 160, 0}, {255, 255, 255, 192}
+        };
+
+//  Newborn white, settling to green then blue as cells survive
+static const struct EffectPaletteStop LifeStops[] =
+        {
+                {0, 255, 255, 255}, {16, 64, 255, 96}, {96, 0, 96, 255}, {255, 96, 0, 160}
+        };
+
+//  Newest generation first
+static const struct EffectPaletteStop RuleStops[] =
+        {
+                {0, 255, 255, 255}, {64, 0, 224, 255}, {255, 96, 0, 128}
+        };
+
+static const struct EffectPaletteStop RainbowStops[] =
+        {
+                {0, 255, 0, 0}, {43, 255, 255, 0}, {85, 0, 255, 0}, {128, 0, 255, 255}, {170, 0, 0, 255},
+                {213, 255, 0, 255}, {255, 255, 0, 0}
+        };
+
+static const struct EffectPaletteStop WaterStops[] =
+        {
+                {0, 0, 0, 48}, {128, 0, 32, 160}, {208, 0, 160, 192}, {255, 160, 255, 255}
+        };
+
+void PixelFade(int* pixels, int count, uint32_t scale)
+{
+    for (int i = 0; i < count; i++)
+    {
+        pixels[i] = PixelScale(pixels[i], scale);
+    }
+}
+
+void EffectPaletteBuild(int* palette, const struct EffectPaletteStop* stops, int count)
+{
+    int stop = 0;
+
+    for (int i = 0; i < 256; i++)
+    {
+        while (stop < count - 2 && i > stops[stop + 1].position)
+        {
+            stop++;
+        }
+
+        const struct EffectPaletteStop* from = &stops[stop];
+        const struct EffectPaletteStop* to = &stops[stop + 1];
+        int span = to->position - from->position;
+        int along = i - from->position;
+
+        int red = from->red + (to->red - from->red) * along / span;
+        int green = from->green + (to->green - from->green) * along / span;
+        int blue = from->blue + (to->blue - from->blue) * along / span;
+
+        palette[i] = green << 16 | red << 8 | blue;
+    }
+}
+
+//  Shared by the particle effects, only one runs at a time
+static struct ParticleSystem EffectParticles;
+static uint32_t EffectParticlesTimeMs = UINT32_MAX;
+static uint32_t EffectRandomState = FAST_RANDOM_SEED;
+
+//  Simulations move in fixed steps, however often frames come
+#define EFFECT_STEP_MS 16
+#define EFFECT_MAX_STEPS 4
+
+//  Heat grid for the fire, bigger canvases only burn in the bottom rows
+#define EFFECT_FIRE_MAX_CELLS 8192
+static uint8_t FireHeat[EFFECT_FIRE_MAX_CELLS];
+static uint32_t FireTimeMs = UINT32_MAX;
+static const struct FireSettings FireDefaults = {40, 100};
+
+//  Automata grids, bigger canvases show the top left of them
+#define EFFECT_AUTOMATA_MAX 128
+#define EFFECT_AUTOMATA_WORDS AUTOMATA_WORDS(EFFECT_AUTOMATA_MAX)
+
+//  Life, its generations and how long each cell has been alive
+#define EFFECT_LIFE_STEP_MS 100
+#define EFFECT_LIFE_STALE_GENERATIONS 100
+static uint32_t LifeCells[2][EFFECT_AUTOMATA_MAX * EFFECT_AUTOMATA_WORDS];
+static uint8_t LifeAges[EFFECT_AUTOMATA_MAX * EFFECT_AUTOMATA_MAX];
+static int LifeCurrent;
+static uint32_t LifeTimeMs = UINT32_MAX;
+
+//  Population two generations back and before that, matching means it's settled or only blinking
+static int LifePopulation[2];
+static int LifeStale;
+
+//  1D rules, a ring of past generations scrolling up the canvas
+#define EFFECT_RULE_STEP_MS 50
+#define EFFECT_RULE_GENERATIONS 600
+static const uint8_t RuleNumbers[] = {30, 90, 110, 150, 45, 73};
+static uint32_t RuleRows[EFFECT_AUTOMATA_MAX][EFFECT_AUTOMATA_WORDS];
+static int RuleNewest;
+static int RuleGenerations;
+static int RuleIndex;
+static uint32_t RuleTimeMs = UINT32_MAX;
+
+//  Ticker message, laid out once when it's set
+#define EFFECT_TICKER_COLUMN_MS 60
+static struct TextLayout TickerText;
+
+static const int SparkColours[] =
+        {
+                0x00FF00, 0xFF0000, 0x0000FF, 0xFFFF00, 0x00FFFF, 0xC0FF40, 0x40FFFF, 0xFFFFFF
+        };
+
+void EffectsInit(uint32_t seed)
+{
+    EffectRandomState = seed != 0 ? seed : FAST_RANDOM_SEED;
+
+    NoiseInit(seed);
+
+    EffectPaletteBuild(LavaPalette, LavaStops, sizeof(LavaStops) / sizeof(LavaStops[0]));
+    EffectPaletteBuild(CloudPalette, CloudStops, sizeof(CloudStops) / sizeof(CloudStops[0]));
+    EffectPaletteBuild(WaterPalette, WaterStops, sizeof(WaterStops) / sizeof(WaterStops[0]));
+    EffectPaletteBuild(FirePalette, FireStops, sizeof(FireStops) / sizeof(FireStops[0]));
+    EffectPaletteBuild(LifePalette, LifeStops, sizeof(LifeStops) / sizeof(LifeStops[0]));
+    EffectPaletteBuild(RulePalette, RuleStops, sizeof(RuleStops) / sizeof(RuleStops[0]));
+    EffectPaletteBuild(RainbowPalette, RainbowStops, sizeof(RainbowStops) / sizeof(RainbowStops[0]));
+}
+
+void EffectRandom(int* pixels, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        pixels[i] = rand() % 0xFFFFFF;
+    }
+}
+
+void PixelBrightnessMask(int* pixels, int count, int mask)
+{
+    int channels = mask | mask << 8 | mask << 16;
+
+    for (int i = 0; i < count; i++)
+    {
+        pixels[i] &= channels;
+    }
+}
+
+void EffectMatrixTest(int* canvas, int width, int height, uint32_t timeMs)
+{
+    int column = (timeMs / 100) % width;
+
+    for (int y = 0; y < height; y++)
+    {
+        int green = height > 1 ? y * 255 / (height - 1) : 0;
+
+        for (int x = 0; x < width; x++)
+        {
+            int red = width > 1 ? x * 255 / (width - 1) : 0;
+
+            canvas[y * width + x] = x == column ? 0xFFFFFF : green << 16 | red << 8;
+        }
+    }
+}
+
+void EffectLava(int* canvas, int width, int height, uint32_t timeMs)
+{
+    uint8_t values[EFFECT_NOISE_RUN];
+    uint32_t z = timeMs / 8;
+
+    for (int y = 0; y < height; y++)
+    {
+        //  Rising slowly
+        uint32_t noiseY = y * EFFECT_NOISE_SCALE + timeMs / 32;
+
+        for (int x = 0; x < width; x += EFFECT_NOISE_RUN)
+        {
+            int run = width - x < EFFECT_NOISE_RUN ? width - x : EFFECT_NOISE_RUN;
+            Noise3DRow(values, run, x * EFFECT_NOISE_SCALE, EFFECT_NOISE_SCALE, noiseY, z);
+
+            int* row = canvas + y * width + x;
+            for (int i = 0; i < run; i++)
+            {
+                row[i] = LavaPalette[values[i]];
+            }
+        }
+    }
+}
+
+void EffectClouds(int* canvas, int width, int height, uint32_t timeMs)
+{
+    uint8_t coarse[EFFECT_NOISE_RUN];
+    uint8_t fine[EFFECT_NOISE_RUN];
+
+    //  The fine octave drifts faster, so the clouds change shape as they go
+    uint32_t drift = timeMs / 4;
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x += EFFECT_NOISE_RUN)
+        {
+            int run = width - x < EFFECT_NOISE_RUN ? width - x : EFFECT_NOISE_RUN;
+            Noise2DRow(coarse, run, x * EFFECT_NOISE_SCALE + drift, EFFECT_NOISE_SCALE, y * EFFECT_NOISE_SCALE);
+            Noise2DRow(fine, run, x * EFFECT_NOISE_SCALE * 2 + drift * 3, EFFECT_NOISE_SCALE * 2,
+                       y * EFFECT_NOISE_SCALE * 2 + 0x8000);
+
+            int* row = canvas + y * width + x;
+            for (int i = 0; i < run; i++)
+            {
+                row[i] = CloudPalette[(coarse[i] * 3 + fine[i]) >> 2];
+            }
+        }
+    }
+}
+
+void EffectWater(int* canvas, int width, int height, uint32_t timeMs)
+{
+    uint8_t values[EFFECT_NOISE_RUN];
+    uint32_t z = timeMs / 3;
+
+    for (int y = 0; y < height; y++)
+    {
+        uint32_t noiseY = y * EFFECT_NOISE_SCALE;
+
+        for (int x = 0; x < width; x += EFFECT_NOISE_RUN)
+        {
+            int run = width - x < EFFECT_NOISE_RUN ? width - x : EFFECT_NOISE_RUN;
+            //  Stretched across, so it ripples in bands
+            Noise3DRow(values, run, x * EFFECT_NOISE_SCALE / 2 + timeMs / 16, EFFECT_NOISE_SCALE / 2, noiseY, z);
+
+            int* row = canvas + y * width + x;
+            for (int i = 0; i < run; i++)
+            {
+                row[i] = WaterPalette[values[i]];
+            }
+        }
+    }
+}
+
+//
+//  Whole steps of intervalMs due since lastMs, moving it on by them.  -1 when the effect time went back and the
+//  effect should start over.
+//
+static int EffectStepsDue(uint32_t timeMs, uint32_t* lastMs, uint32_t intervalMs)
+{
+    if (*lastMs == UINT32_MAX || timeMs < *lastMs)
+    {
+        *lastMs = timeMs;
+        return -1;
+    }
+
+    int steps = (int) ((timeMs - *lastMs) / intervalMs);
+    *lastMs += steps * intervalMs;
+
+    return steps > EFFECT_MAX_STEPS ? EFFECT_MAX_STEPS : steps;
+}
+
+static int EffectParticleSteps(uint32_t timeMs, int16_t gravity)
+{
+    int steps = EffectStepsDue(timeMs, &EffectParticlesTimeMs, EFFECT_STEP_MS);
+    if (steps < 0)
+    {
+        ParticleSystemInit(&EffectParticles, gravity);
+        steps = 0;
+    }
+
+    return steps;
+}
+
+//  Random -range to range - 1
+static int16_t EffectRandomSpread(int range)
+{
+    return (int16_t) ((int) FastRandomRange(&EffectRandomState, 2 * range) - range);
+}
+
+void EffectFireworks(int* canvas, int width, int height, uint32_t timeMs)
+{
+    //  A strip has nowhere to fall
+    bool flat = height == 1;
+    int steps = EffectParticleSteps(timeMs, flat ? 0 : 3);
+
+    for (int step = 0; step < steps; step++)
+    {
+        //  A burst every 40 steps or so
+        if (FastRandomRange(&EffectRandomState, 40) == 0)
+        {
+            int32_t x = FastRandomRange(&EffectRandomState, width) * PARTICLE_ONE + PARTICLE_ONE / 2;
+            int32_t y = FastRandomRange(&EffectRandomState, height * 2 / 3 + 1) * PARTICLE_ONE + PARTICLE_ONE / 2;
+            int colour = SparkColours[FastRandomRange(&EffectRandomState, sizeof(SparkColours) / sizeof(int))];
+
+            for (int i = 0; i < 120; i++)
+            {
+                //  Anything inside the circle, so the burst comes out round
+                int16_t vx;
+                int16_t vy;
+                do
+                {
+                    vx = EffectRandomSpread(96);
+                    vy = flat ? 0 : EffectRandomSpread(96);
+                }
+                while (vx * vx + vy * vy > 96 * 96);
+
+                ParticleSpawn(&EffectParticles, x, y, vx, vy, colour,
+                              40 + FastRandomRange(&EffectRandomState, 30));
+            }
+        }
+
+        ParticleUpdate(&EffectParticles, width, height);
+    }
+
+    PixelFade(canvas, width * height, 160);
+    ParticleSplat(&EffectParticles, canvas, width, height);
+}
+
+void EffectComets(int* canvas, int width, int height, uint32_t timeMs)
+{
+    const int comets = 3;
+    int steps = EffectParticleSteps(timeMs, 0);
+
+    for (int step = 0; step < steps; step++)
+    {
+        uint32_t stepMs = EffectParticlesTimeMs - (steps - 1 - step) * EFFECT_STEP_MS;
+
+        for (int comet = 0; comet < comets; comet++)
+        {
+            //  Each a little faster than the last, wrapping round
+            int speed = 24 + 16 * comet;
+            int32_t x = (int32_t) ((uint64_t) stepMs * speed / EFFECT_STEP_MS % ((uint32_t) width * PARTICLE_ONE));
+            int32_t y = (height * (comet + 1) / (comets + 1)) * PARTICLE_ONE + PARTICLE_ONE / 2;
+
+            for (int i = 0; i < 3; i++)
+            {
+                ParticleSpawn(&EffectParticles, x, y, (int16_t) (-speed / 4 + EffectRandomSpread(8)),
+                              height == 1 ? 0 : EffectRandomSpread(8), SparkColours[comet + 3],
+                              24 + FastRandomRange(&EffectRandomState, 16));
+            }
+        }
+
+        ParticleUpdate(&EffectParticles, width, height);
+    }
+
+    PixelFade(canvas, width * height, 200);
+    ParticleSplat(&EffectParticles, canvas, width, height);
+}
+
+void EffectRain(int* canvas, int width, int height, uint32_t timeMs)
+{
+    //  On a strip the drops just land where they fall
+    bool flat = height == 1;
+    int steps = EffectParticleSteps(timeMs, flat ? 0 : 2);
+
+    for (int step = 0; step < steps; step++)
+    {
+        int drops = width / 16 + 1;
+
+        for (int i = 0; i < drops; i++)
+        {
+            int32_t x = FastRandomRange(&EffectRandomState, width) * PARTICLE_ONE + PARTICLE_ONE / 2;
+            int16_t vy = flat ? 0 : (int16_t) (64 + FastRandomRange(&EffectRandomState, 64));
+
+            ParticleSpawn(&EffectParticles, x, 0, 0, vy, 0x60408C, flat ? PARTICLE_FADE_STEPS / 2 : 0xFFFF);
+        }
+
+        ParticleUpdate(&EffectParticles, width, height);
+    }
+
+    PixelFade(canvas, width * height, 128);
+    ParticleSplat(&EffectParticles, canvas, width, height);
+}
+
+void EffectFire(int* canvas, int width, int height, uint32_t timeMs)
+{
+    //  A strip burns along its length
+    int fireWidth = height == 1 ? 1 : width;
+    int fireHeight = height == 1 ? width : height;
+    if (fireWidth * fireHeight > EFFECT_FIRE_MAX_CELLS)
+    {
+        fireHeight = EFFECT_FIRE_MAX_CELLS / fireWidth;
+    }
+
+    int steps = EffectStepsDue(timeMs, &FireTimeMs, EFFECT_STEP_MS);
+    if (steps < 0)
+    {
+        memset(FireHeat, 0, sizeof(FireHeat));
+        steps = 0;
+    }
+
+    for (int step = 0; step < steps; step++)
+    {
+        FireStep(FireHeat, fireWidth, fireHeight, &FireDefaults, &EffectRandomState);
+    }
+
+    //  Heat to colour, the grid's bottom row at the bottom of the canvas
+    if (height == 1)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            canvas[x] = x < fireHeight ? FirePalette[FireHeat[x]] : 0;
+        }
+        return;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        int row = height - 1 - y;
+        int* pixels = canvas + y * width;
+
+        if (row >= fireHeight)
+        {
+            memset(pixels, 0, sizeof(int) * width);
+            continue;
+        }
+
+        const uint8_t* heat = FireHeat + row * width;
+        for (int x = 0; x < width; x++)
+        {
+            pixels[x] = FirePalette[heat[x]];
+        }
+    }
+}
+
+static void EffectLifeSeed(int width, int height)
+{
+    AutomataRandomise(LifeCells[LifeCurrent], width, height, &EffectRandomState);
+    memset(LifeAges, 0, sizeof(LifeAges));
+    LifePopulation[0] = -1;
+    LifePopulation[1] = -1;
+    LifeStale = 0;
+}
+
+void EffectLife(int* canvas, int width, int height, uint32_t timeMs)
+{
+    int gridWidth = width < EFFECT_AUTOMATA_MAX ? width : EFFECT_AUTOMATA_MAX;
+    int gridHeight = height < EFFECT_AUTOMATA_MAX ? height : EFFECT_AUTOMATA_MAX;
+    int words = AUTOMATA_WORDS(gridWidth);
+
+    int steps = EffectStepsDue(timeMs, &LifeTimeMs, EFFECT_LIFE_STEP_MS);
+    if (steps < 0)
+    {
+        EffectLifeSeed(gridWidth, gridHeight);
+        steps = 0;
+    }
+
+    for (int step = 0; step < steps; step++)
+    {
+        const uint32_t* cells = LifeCells[LifeCurrent];
+        uint32_t* next = LifeCells[LifeCurrent ^ 1];
+        LifeStep(cells, next, gridWidth, gridHeight);
+        LifeCurrent ^= 1;
+
+        int population = 0;
+        for (int i = 0; i < gridHeight * words; i++)
+        {
+            population += __builtin_popcount(next[i]);
+        }
+
+        LifeStale = population == LifePopulation[0] ? LifeStale + 1 : 0;
+        LifePopulation[0] = LifePopulation[1];
+        LifePopulation[1] = population;
+
+        if (population == 0 || LifeStale > EFFECT_LIFE_STALE_GENERATIONS)
+        {
+            EffectLifeSeed(gridWidth, gridHeight);
+            continue;
+        }
+
+        //  Survivors age, everything else starts again
+        for (int y = 0; y < gridHeight; y++)
+        {
+            const uint32_t* row = next + y * words;
+            uint8_t* ages = LifeAges + y * EFFECT_AUTOMATA_MAX;
+
+            for (int x = 0; x < gridWidth; x++)
+            {
+                bool alive = row[x >> 5] >> (x & 31) & 1;
+                ages[x] = alive ? (ages[x] < 255 ? ages[x] + 1 : 255) : 0;
+            }
+        }
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        int* pixels = canvas + y * width;
+        const uint8_t* ages = LifeAges + y * EFFECT_AUTOMATA_MAX;
+
+        for (int x = 0; x < width; x++)
+        {
+            pixels[x] = y < gridHeight && x < gridWidth && ages[x] != 0 ? LifePalette[ages[x] - 1] : 0;
+        }
+    }
+}
+
+static void EffectRuleSeed(int width)
+{
+    memset(RuleRows, 0, sizeof(RuleRows));
+    RuleNewest = 0;
+    RuleGenerations = 0;
+
+    //  One live cell in the middle
+    RuleRows[0][(width / 2) >> 5] = 1u << ((width / 2) & 31);
+}
+
+void EffectRules(int* canvas, int width, int height, uint32_t timeMs)
+{
+    int gridWidth = width < EFFECT_AUTOMATA_MAX ? width : EFFECT_AUTOMATA_MAX;
+    int history = height < EFFECT_AUTOMATA_MAX ? height : EFFECT_AUTOMATA_MAX;
+
+    //  A strip still needs somewhere else to put the next generation
+    int ring = history < 2 ? 2 : history;
+
+    int steps = EffectStepsDue(timeMs, &RuleTimeMs, EFFECT_RULE_STEP_MS);
+    if (steps < 0)
+    {
+        RuleIndex = 0;
+        EffectRuleSeed(gridWidth);
+        steps = 0;
+    }
+
+    for (int step = 0; step < steps; step++)
+    {
+        //  On to the next rule now and then
+        if (++RuleGenerations > EFFECT_RULE_GENERATIONS)
+        {
+            RuleIndex = (RuleIndex + 1) % (int) sizeof(RuleNumbers);
+            EffectRuleSeed(gridWidth);
+            continue;
+        }
+
+        int next = (RuleNewest + 1) % ring;
+        RuleStep(RuleRows[RuleNewest], RuleRows[next], gridWidth, RuleNumbers[RuleIndex]);
+        RuleNewest = next;
+    }
+
+    //  Newest generation on the bottom row
+    for (int y = 0; y < height; y++)
+    {
+        int* pixels = canvas + y * width;
+        int back = history - 1 - y;
+
+        if (back < 0)
+        {
+            memset(pixels, 0, sizeof(int) * width);
+            continue;
+        }
+
+        const uint32_t* row = RuleRows[(RuleNewest - back + ring) % ring];
+        int colour = RulePalette[history > 1 ? back * 255 / (history - 1) : 0];
+
+        for (int x = 0; x < width; x++)
+        {
+            pixels[x] = x < gridWidth && (row[x >> 5] >> (x & 31) & 1) ? colour : 0;
+        }
+    }
+}
+
+void EffectTickerSetMessage(const char* message)
+{
+    TextLayoutMessage(&TickerText, message);
+}
+
+void EffectTicker(int* canvas, int width, int height, uint32_t timeMs)
+{
+    //  In from the right, out to the left, then round again
+    int travel = (int) (timeMs / EFFECT_TICKER_COLUMN_MS % (uint32_t) (TickerText.length + width));
+
+    memset(canvas, 0, sizeof(int) * width * height);
+    TextBlit(&TickerText, width - travel, canvas, width, height, (height - TEXT_FONT_HEIGHT) / 2, RainbowPalette,
+             (int) (timeMs / 8));
+}
+
+void EffectSpectrum(int* canvas, int width, int height, uint32_t timeMs)
+{
+    struct AudioLevels levels;
+
+    (void) timeMs;
+
+    if (!AudioRead(&levels))
+    {
+        memset(canvas, 0, sizeof(int) * width * height);
+        return;
+    }
+
+    for (int x = 0; x < width; x++)
+    {
+        int band = x * AUDIO_BANDS / width;
+        int colour = RainbowPalette[band * 256 / AUDIO_BANDS];
+
+        //  Bar height in 255ths of a pixel, the top pixel lit by the part of it left over
+        int bar = levels.bands[band] * height;
+
+        for (int y = 0; y < height; y++)
+        {
+            int* pixel = &canvas[(height - 1 - y) * width + x];
+            int lit = bar - y * 255;
+
+            *pixel = lit >= 255 ? colour : lit > 0 ? PixelScale(colour, (uint32_t) lit) : 0;
+        }
+    }
+}
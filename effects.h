@@ -0,0 +1,72 @@
+#ifndef PICOPIXOS_EFFECTS_H
+#define PICOPIXOS_EFFECTS_H
+
+#include <stdint.h>
+#include "noise.h"
+
+//
+//  Effect Kernels
+//
+//  Renderers and per-pixel passes used by the effects, kept apart from main.c so the benchmarks can run them.
+//  Pixels are GRB ints, as the pixel buffer holds them.
+//
+//  2D effects draw into a pixel matrix canvas, width by height in row order, and leave getting it onto the
+//  wire to PixelMatrixPresent.  They're given the effect time so they don't need state of their own.
+//
+
+//  Colour at a point along a palette, GRB values are built from the stops by EffectPaletteBuild
+struct EffectPaletteStop
+{
+    uint8_t position;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+//  Blend stops, in rising position from 0 to 255, into a 256 entry palette
+void EffectPaletteBuild(int* palette, const struct EffectPaletteStop* stops, int count);
+
+//  Seed the noise and build the palettes, before any effect runs
+void EffectsInit(uint32_t seed);
+
+//  Random colours over the whole buffer
+void EffectRandom(int* pixels, int count);
+
+//  Keep only the bits in mask of each channel, this is how the brightness setting is applied
+void PixelBrightnessMask(int* pixels, int count, int mask);
+
+//  Red rising along x, green down y and a white column sweeping left to right, for checking a matrix layout
+void EffectMatrixTest(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Noise fields through a palette: 3D noise with time as z for lava and water, two octaves of drifting 2D
+//  noise for clouds
+void EffectLava(int* canvas, int width, int height, uint32_t timeMs);
+void EffectClouds(int* canvas, int width, int height, uint32_t timeMs);
+void EffectWater(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Particle effects, sharing one pool that starts over whenever the effect time goes back.  They fade the
+//  canvas rather than clearing it, which leaves trails.
+void EffectFireworks(int* canvas, int width, int height, uint32_t timeMs);
+void EffectComets(int* canvas, int width, int height, uint32_t timeMs);
+void EffectRain(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Heat simulation through a fire palette, flames rising up a matrix or along a strip
+void EffectFire(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Conway's Life, coloured by how long each cell has lived, reseeded once it dies out or settles
+void EffectLife(int* canvas, int width, int height, uint32_t timeMs);
+
+//  1D Wolfram rules, generations scrolling up from the bottom, moving on to another rule every 30 s
+void EffectRules(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Text scrolling right to left through the middle rows, in a rainbow that moves along it
+void EffectTicker(int* canvas, int width, int height, uint32_t timeMs);
+void EffectTickerSetMessage(const char* message);
+
+//  Audio band levels as bars up from the bottom, bass on the left, or as brightness along a strip
+void EffectSpectrum(int* canvas, int width, int height, uint32_t timeMs);
+
+//  Scale every pixel by scale / 256
+void PixelFade(int* pixels, int count, uint32_t scale);
+
+#endif
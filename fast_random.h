@@ -0,0 +1,34 @@
+#ifndef PICOPIXOS_FAST_RANDOM_H
+#define PICOPIXOS_FAST_RANDOM_H
+
+#include <stdint.h>
+
+//
+//  Fast Random
+//
+//  xorshift32 for effects: three shifts and three XORs a number, no multiply or divide, and each caller keeps
+//  its own state so the cores don't share one.  Good enough for sparks and shuffles, not for anything else.
+//
+
+//  Any state but 0
+#define FAST_RANDOM_SEED 0x2545F491u
+
+static inline uint32_t FastRandom(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x;
+}
+
+//  0 to range - 1, range up to 65536, by scaling rather than a divide
+static inline uint32_t FastRandomRange(uint32_t* state, uint32_t range)
+{
+    return ((FastRandom(state) >> 16) * range) >> 16;
+}
+
+#endif
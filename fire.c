@@ -0,0 +1,65 @@
+#include "fire.h"
+#include "fast_random.h"
+
+//  Sparks land this hot or hotter
+#define FIRE_SPARK_MIN 160
+
+static inline uint8_t FireSubtract(uint8_t heat, uint32_t amount)
+{
+    return heat > amount ? heat - amount : 0;
+}
+
+void FireStep(uint8_t* heat, int width, int height, const struct FireSettings* settings, uint32_t* random)
+{
+    int cells = width * height;
+    uint32_t cooling = settings->cooling * 16 / height + 2;
+
+    //  Cool, a random byte per cell scaled to 0 to cooling
+    for (int i = 0; i < cells; i += 4)
+    {
+        uint32_t bytes = FastRandom(random);
+
+        for (int j = i; j < i + 4 && j < cells; j++, bytes >>= 8)
+        {
+            heat[j] = FireSubtract(heat[j], ((bytes & 0xFF) * cooling) >> 8);
+        }
+    }
+
+    //  Rise, from the top down so the rows read haven't been written yet
+    if (width == 1)
+    {
+        //  A strip, the classic one dimensional fire
+        for (int row = height - 1; row >= 2; row--)
+        {
+            heat[row] = (heat[row - 1] + heat[row - 2] * 2) / 3;
+        }
+    }
+    else
+    {
+        for (int row = height - 1; row >= 1; row--)
+        {
+            uint8_t* cell = heat + row * width;
+            const uint8_t* below = cell - width;
+            const uint8_t* under = row >= 2 ? below - width : below;
+
+            cell[0] = (below[0] * 2 + below[1] + under[0]) >> 2;
+            for (int x = 1; x < width - 1; x++)
+            {
+                cell[x] = (below[x - 1] + below[x] + below[x + 1] + under[x]) >> 2;
+            }
+            cell[width - 1] = (below[width - 2] + below[width - 1] * 2 + under[width - 1]) >> 2;
+        }
+    }
+
+    //  Spark along the bottom
+    for (int x = 0; x < width; x++)
+    {
+        uint32_t bytes = FastRandom(random);
+
+        if ((bytes & 0xFF) < settings->sparking)
+        {
+            uint32_t spark = FIRE_SPARK_MIN + ((bytes >> 8 & 0xFF) * (256 - FIRE_SPARK_MIN) >> 8);
+            heat[x] = heat[x] > spark ? heat[x] : spark;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef PICOPIXOS_FIRE_H
+#define PICOPIXOS_FIRE_H
+
+#include <stdint.h>
+
+//
+//  Fire
+//
+//  Heat simulation on a grid of 8 bit cells, row 0 at the bottom.  Each step every cell cools by a random amount,
+//  heat rises, each cell taking the average of the three cells below it and the one below those, and random
+//  sparks light up the bottom row.  A palette turns heat into colour.
+//
+//  A step goes through the grid a row at a time, top to bottom, reading the rows under the one it writes, so it
+//  can work in place and every pass runs along memory.  Random numbers come four bytes to a FastRandom call.
+//
+
+struct FireSettings
+{
+    //  Most a cell can cool in one step, for a grid height of 16, taller grids cool less so flames reach further
+    uint8_t cooling;
+
+    //  Chance out of 256 that a bottom cell sparks each step
+    uint8_t sparking;
+};
+
+//  One step of a width by height grid
+void FireStep(uint8_t* heat, int width, int height, const struct FireSettings* settings, uint32_t* random);
+
+#endif
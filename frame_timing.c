@@ -0,0 +1,85 @@
+#include "frame_timing.h"
+
+struct FrameTimingStruct CurrentFrameTiming;
+
+void FrameTimingBegin(uint64_t now)
+{
+    for (int metric = 0; metric < FRAME_METRICS; metric++)
+    {
+        CurrentFrameTiming.current[metric] = 0;
+    }
+
+    CurrentFrameTiming.frameStart = now;
+}
+
+void FrameTimingEndFrame(uint64_t now)
+{
+    struct FrameTimingStruct* timing = &CurrentFrameTiming;
+    int slot = timing->frames % FRAME_TIMING_WINDOW;
+
+    timing->current[FRAME_PERIOD] = (uint32_t) (now - timing->frameStart);
+    timing->frameStart = now;
+
+    for (int metric = 0; metric < FRAME_METRICS; metric++)
+    {
+        timing->samples[metric][slot] = timing->current[metric];
+        timing->current[metric] = 0;
+    }
+
+    timing->frames++;
+}
+
+static int FrameTimingWindowFrames()
+{
+    return CurrentFrameTiming.frames < FRAME_TIMING_WINDOW ? (int) CurrentFrameTiming.frames : FRAME_TIMING_WINDOW;
+}
+
+bool FrameTimingSummarize(int metric, struct FrameTimingSummary* summary)
+{
+    int count = FrameTimingWindowFrames();
+
+    if (count == 0)
+    {
+        return false;
+    }
+
+    uint64_t total = 0;
+    summary->min = 0xFFFFFFFF;
+    summary->max = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t sample = CurrentFrameTiming.samples[metric][i];
+
+        if (sample < summary->min) summary->min = sample;
+        if (sample > summary->max) summary->max = sample;
+        total += sample;
+    }
+
+    summary->average = (uint32_t) (total / count);
+
+    return true;
+}
+
+void FrameTimingHistogram(uint32_t buckets[FRAME_TIMING_BUCKETS])
+{
+    int count = FrameTimingWindowFrames();
+
+    for (int i = 0; i < FRAME_TIMING_BUCKETS; i++)
+    {
+        buckets[i] = 0;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t busy = CurrentFrameTiming.samples[FRAME_RENDER][i] + CurrentFrameTiming.samples[FRAME_OUTPUT][i];
+        int bucket = 0;
+
+        for (uint32_t limit = FRAME_TIMING_FIRST_BUCKET_US; busy >= limit && bucket < FRAME_TIMING_BUCKETS - 1; limit <<= 1)
+        {
+            bucket++;
+        }
+
+        buckets[bucket]++;
+    }
+}
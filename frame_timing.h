@@ -0,0 +1,99 @@
+#ifndef PICOPIXOS_FRAME_TIMING_H
+#define PICOPIXOS_FRAME_TIMING_H
+
+#include <stdint.h>
+#include "hal.h"
+
+//
+//  Frame Timing
+//
+//  Probes in the core 0 render loop record where each frame's time goes, kept over a rolling window of the last
+//  FRAME_TIMING_WINDOW frames for the Status screen.  Build with PICOPIXOS_FRAME_TIMING=0 (the CMake option of
+//  the same name, off by default for Release and MinSizeRel) and the probes compile to nothing, frame_timing.c
+//  and its window are left out of the build and the Status screen goes without the table.
+//
+
+#ifndef PICOPIXOS_FRAME_TIMING
+#define PICOPIXOS_FRAME_TIMING 0
+#endif
+
+enum FrameTimingMetrics
+{
+    //  Running the effect
+    FRAME_RENDER = 0,
+
+    //  Writing the buffer out, including time blocked
+    FRAME_OUTPUT = 1,
+
+    //  Waiting on a full FIFO
+    FRAME_BLOCKED = 2,
+
+    //  Idle until the next frame is due
+    FRAME_SLACK = 3,
+
+    //  Start of one frame to the start of the next
+    FRAME_PERIOD = 4,
+
+    FRAME_METRICS = 5
+};
+
+#define FRAME_TIMING_WINDOW 128
+
+//  Busy time histogram, log2 buckets from under 64 us to 64 ms and over
+#define FRAME_TIMING_BUCKETS 12
+#define FRAME_TIMING_FIRST_BUCKET_US 64
+
+struct FrameTimingStruct
+{
+    uint32_t samples[FRAME_METRICS][FRAME_TIMING_WINDOW];
+
+    //  The frame being recorded
+    uint32_t current[FRAME_METRICS];
+    uint64_t frameStart;
+
+    uint32_t frames;
+};
+
+struct FrameTimingSummary
+{
+    uint32_t min;
+    uint32_t average;
+    uint32_t max;
+};
+
+extern struct FrameTimingStruct CurrentFrameTiming;
+
+static inline void FrameTimingAdd(int metric, uint64_t us)
+{
+    CurrentFrameTiming.current[metric] += (uint32_t) us;
+}
+
+//  Drop anything recorded so far and start the first frame at now
+void FrameTimingBegin(uint64_t now);
+
+//  Close off the frame in progress at now and start the next
+void FrameTimingEndFrame(uint64_t now);
+
+//  Over the frames in the window, false if there aren't any yet
+bool FrameTimingSummarize(int metric, struct FrameTimingSummary* summary);
+
+//  Frames in the window by render plus output time
+void FrameTimingHistogram(uint32_t buckets[FRAME_TIMING_BUCKETS]);
+
+#if PICOPIXOS_FRAME_TIMING
+
+#define FRAME_PROBE_START(name) uint64_t name = HalTimeUs()
+#define FRAME_PROBE_END(metric, name) FrameTimingAdd(metric, HalTimeUs() - name)
+#define FRAME_PROBE_FRAME() FrameTimingEndFrame(HalTimeUs())
+#define FRAME_PROBE_BEGIN() FrameTimingBegin(HalTimeUs())
+
+#else
+
+#define FRAME_PROBE_START(name)
+#define FRAME_PROBE_END(metric, name)
+#define FRAME_PROBE_FRAME()
+#define FRAME_PROBE_BEGIN()
+
+#endif
+
+#endif
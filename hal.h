@@ -0,0 +1,170 @@
+#ifndef PICOPIXOS_HAL_H
+#define PICOPIXOS_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pixel_timing.h"
+#include "pixel_format.h"
+
+//
+//  Hardware Abstraction Layer
+//
+//  Everything the OS needs from the board goes through here: time, the pixel output, the console, the second
+//  core, flash and audio input.  hal_pico.c implements it on the RP2040.  hal_host.c implements it on Linux for
+//  the host build (PICOPIXOS_HOST), with threads for the cores, a RAM (or file) backed flash, a simulated PIO FIFO
+//  that runs at the timing profile's speed and decodes what it's sent back into frames, and audio played in real
+//  time from a sample file.
+//
+
+#ifdef PICOPIXOS_HOST
+
+typedef unsigned int uint;
+
+#define HAL_FLASH_SIZE (2 * 1024 * 1024)
+
+#else
+
+#include "pico/stdlib.h"
+
+#define HAL_FLASH_SIZE PICO_FLASH_SIZE_BYTES
+
+#endif
+
+#define HAL_FLASH_SECTOR_SIZE 4096
+#define HAL_FLASH_PAGE_SIZE 256
+
+//  Pixels the joined TX FIFO holds
+#define HAL_PIXEL_FIFO_DEPTH 8
+
+//  Audio input ring, blocks of samples
+#define HAL_AUDIO_BLOCK_SAMPLES 256
+#define HAL_AUDIO_BLOCKS 8
+
+//  HalPixelOutputTakeFlags bits
+#define HAL_PIXEL_STALLED 1
+#define HAL_PIXEL_OVERFLOWED 2
+
+//
+//  Time
+//
+uint64_t HalTimeUs();
+void HalSleepUs(uint64_t us);
+void HalSleepMs(uint32_t ms);
+
+//  Body of a busy wait loop
+void HalIdle();
+
+//  CPU clock, or 0 where cycles don't mean anything (the host)
+uint32_t HalCpuHz();
+
+//
+//  Pixel Output
+//
+
+//  Start the program for profile on a state machine driving pin, and pin + 1 as the clock for clocked chips
+void HalPixelOutputStart(int pioBlock, int stateMachine, uint pin, const struct PixelTimingProfile* profile);
+void HalPixelOutputStop();
+
+//  Format of the words HalPixelPut queues, set before starting.  Clocked chips only take 24 bit formats.
+void HalPixelOutputFormat(int format);
+
+//  Global brightness of clocked chips, 0 to 31, sent in every LED frame.  Takes effect from the next pixel.
+void HalPixelOutputBrightness(uint32_t level);
+
+//  Queue one pixel packed by the output format, left justified.  Blocks while the FIFO is full.
+void HalPixelPut(uint32_t word);
+
+//  Every pixel of the frame has been queued.  Clocked chips get their end frame and the next start frame once
+//  the FIFO drains, which waits for it.  The WS2812 latches on its own once the line goes idle, nothing to do.
+void HalPixelFrameEnd();
+
+//  True when HalPixelPut would block
+bool HalPixelOutputFull();
+
+//  Whether the state machine has run out of pixels (STALLED) or had a write to a full FIFO dropped (OVERFLOWED)
+//  since the last call, from the PIO's FDEBUG register.  Clears them.
+uint32_t HalPixelOutputTakeFlags();
+
+//  Wait for everything queued to go out, then hold the line low for latchUs so the string shows it.  Clocked
+//  chips get their end frame instead.
+void HalPixelOutputFlush(uint32_t latchUs);
+
+//  Byte stream output, for frames already packed 3 bytes per pixel in wire order.  Begin and End switch the
+//  output over and back, and must be called with nothing queued.  Write returns straight away, the bytes are
+//  fed to the output in the background (by DMA on the Pico) until Busy clears.  Begin fails if there's no
+//  DMA channel spare.
+bool HalPixelBytesBegin();
+void HalPixelBytesWrite(const uint8_t* bytes, uint32_t length);
+bool HalPixelBytesBusy();
+void HalPixelBytesEnd();
+
+//
+//  Console
+//
+
+//  Next character typed on the console, or -1 if there isn't one
+int HalConsoleRead();
+
+void HalConsoleInit();
+
+//
+//  Cores
+//
+void HalLaunchCore1(void (*entry)());
+
+//  0 or 1, whichever core is calling
+int HalCoreNumber();
+
+//  Core 0 calls this once so core 1 can pause it while flash is written
+void HalCoreLockoutVictimInit();
+
+//  Pause the other core, and let it go again
+void HalCoreLockoutStart();
+void HalCoreLockoutEnd();
+
+//
+//  Flash
+//
+//  Offsets are from the start of flash.  Erase and program take interrupts off while they run, anything that
+//  can run from flash on the other core has to be locked out first.
+//
+
+//  Flash mapped into memory, through the cache or around it
+const uint8_t* HalFlashRead(uint32_t offset);
+const uint8_t* HalFlashReadUncached(uint32_t offset);
+
+//  Whole sectors and whole pages only
+void HalFlashErase(uint32_t offset, uint32_t length);
+void HalFlashProgram(uint32_t offset, const uint8_t* data, uint32_t length);
+
+//
+//  Audio Input
+//
+//  Samples an ADC pin continuously into a ring of HAL_AUDIO_BLOCKS blocks, with no CPU time spent on it (DMA on
+//  the Pico).  Samples are 12 bit, 0 to 4095, centred on whatever the input is biased to.  The reader keeps its
+//  own count of blocks taken, block n is at ring + (n % HAL_AUDIO_BLOCKS) * HAL_AUDIO_BLOCK_SAMPLES, and it gets
+//  written over once the count has gone HAL_AUDIO_BLOCKS - 1 past it.
+//
+
+//  Start sampling pin (26 to 29) at sampleRate, false if it can't.  The host plays the raw signed 16 bit mono
+//  file named by PICOPIXOS_AUDIO instead, looping, and fails without one.
+bool HalAudioStart(uint pin, uint32_t sampleRate);
+void HalAudioStop();
+
+//  Blocks completed since starting
+uint32_t HalAudioBlocks();
+const uint16_t* HalAudioRing();
+
+#ifdef PICOPIXOS_HOST
+
+//
+//  Host Only
+//
+
+//  Frames the simulated string has latched, and the last of them as GRB values
+uint32_t HalSinkFrames();
+const int* HalSinkLastFrame(int* pixelCount);
+
+#endif
+
+#endif
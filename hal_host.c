@@ -0,0 +1,568 @@
+//
+//  Host implementation of the HAL, see hal.h
+//
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "hal.h"
+
+//  Joined TX FIFO depth of the state machine, in pixels
+#define HOST_FIFO_DEPTH HAL_PIXEL_FIFO_DEPTH
+
+//  Idle line time that latches a frame.  The long WS2812B-V5 figure, so sleep jitter on the host doesn't split frames.
+#define HOST_LATCH_US 280
+
+//  Largest frame the sink keeps
+#define HOST_SINK_MAX_PIXELS 65536
+
+//
+//  Time, from the first call like the Pico's timer from reset
+//
+static uint64_t HostClockUs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+uint64_t HalTimeUs()
+{
+    static uint64_t start = 0;
+
+    if (start == 0)
+    {
+        start = HostClockUs();
+    }
+
+    return HostClockUs() - start;
+}
+
+void HalSleepUs(uint64_t us)
+{
+    struct timespec duration = {(time_t) (us / 1000000), (long) (us % 1000000) * 1000};
+    nanosleep(&duration, NULL);
+}
+
+void HalSleepMs(uint32_t ms)
+{
+    HalSleepUs((uint64_t) ms * 1000);
+}
+
+void HalIdle()
+{
+}
+
+uint32_t HalCpuHz()
+{
+    return 0;
+}
+
+//
+//  Simulated Pixel Output
+//
+//  Nothing is actually shifted out.  The FIFO is modelled by when its last pixel will have left the wire, so
+//  writers block and DMA stays busy for as long as they would on the board.  Pixels are collected into a frame
+//  that latches once the line has been idle long enough, or at the end frame for clocked chips, and latched
+//  frames can be dumped as raw RGB to the file named by PICOPIXOS_SINK.
+//
+static pthread_mutex_t SinkLock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t SinkBusyUntil = 0;
+static int SinkFrame[HOST_SINK_MAX_PIXELS];
+static int SinkFrameLength = 0;
+static int SinkLast[HOST_SINK_MAX_PIXELS];
+static int SinkLastLength = 0;
+static uint32_t SinkFramesLatched = 0;
+static FILE* SinkFile = NULL;
+static bool SinkRunning = false;
+
+//  Wire time of one pixel, from the timing profile
+static uint32_t SinkPixelUs = 30;
+static const struct PixelTimingProfile* SinkProfile = NULL;
+static uint32_t SinkFramePixels = 0;
+static int SinkFormat = PIXEL_FORMAT_GRB;
+
+//  FDEBUG TXSTALL, set whenever the line has run dry
+static bool SinkStalled = false;
+
+//  Call with the lock held
+static void HostSinkLatch()
+{
+    memcpy(SinkLast, SinkFrame, SinkFrameLength * sizeof(int));
+    SinkLastLength = SinkFrameLength;
+    SinkFrameLength = 0;
+    SinkFramesLatched++;
+
+    if (SinkFile != NULL)
+    {
+        for (int i = 0; i < SinkLastLength; i++)
+        {
+            fputc((SinkLast[i] >> 8) & 0xFF, SinkFile);
+            fputc((SinkLast[i] >> 16) & 0xFF, SinkFile);
+            fputc(SinkLast[i] & 0xFF, SinkFile);
+        }
+        fflush(SinkFile);
+    }
+}
+
+//  Call with the lock held
+static void HostSinkLatchIfIdle(uint64_t now)
+{
+    //  Clocked chips only show a frame at its end frame
+    if (SinkProfile != NULL && SinkProfile->protocol == PIXEL_PROTOCOL_APA102)
+    {
+        return;
+    }
+
+    if (SinkFrameLength > 0 && now >= SinkBusyUntil + HOST_LATCH_US)
+    {
+        HostSinkLatch();
+    }
+}
+
+//
+//  Make room for pixels in the FIFO, returns the time to queue them from
+//
+static uint64_t HostSinkWaitForRoom()
+{
+    uint64_t now = HalTimeUs();
+
+    pthread_mutex_lock(&SinkLock);
+    HostSinkLatchIfIdle(now);
+    uint64_t busyUntil = SinkBusyUntil;
+    pthread_mutex_unlock(&SinkLock);
+
+    //  Full, sleep until it's half empty rather than cutting it fine
+    if (busyUntil > now + HOST_FIFO_DEPTH * SinkPixelUs)
+    {
+        HalSleepUs(busyUntil - now - HOST_FIFO_DEPTH * SinkPixelUs / 2);
+        now = HalTimeUs();
+    }
+
+    return now;
+}
+
+//  Call with the lock held
+static void HostSinkQueue(uint64_t now, uint32_t grb)
+{
+    if (now > SinkBusyUntil)
+    {
+        SinkStalled = true;
+    }
+
+    SinkBusyUntil = (SinkBusyUntil > now ? SinkBusyUntil : now) + SinkPixelUs;
+    SinkFramePixels++;
+
+    if (SinkFrameLength < HOST_SINK_MAX_PIXELS)
+    {
+        SinkFrame[SinkFrameLength++] = (int) (grb & 0xFFFFFF);
+    }
+}
+
+void HalPixelOutputStart(int pioBlock, int stateMachine, uint pin, const struct PixelTimingProfile* profile)
+{
+    const char* sinkPath = getenv("PICOPIXOS_SINK");
+
+    if (sinkPath != NULL && SinkFile == NULL)
+    {
+        SinkFile = fopen(sinkPath, "wb");
+    }
+
+    //  Microseconds are as fine as the simulation goes
+    int bits = profile->protocol == PIXEL_PROTOCOL_APA102 ? 24 : PixelFormatBits(SinkFormat);
+    SinkPixelUs = (PixelTimingPixelNs(profile, bits) + 500) / 1000;
+    SinkProfile = profile;
+    SinkFramePixels = 0;
+
+    fprintf(stderr, "Pixel output: simulated PIO %d state machine %d on GPIO %u, %s%s%s\n", pioBlock, stateMachine, pin,
+            profile->name, SinkFile != NULL ? ", frames to " : "", SinkFile != NULL ? sinkPath : "");
+
+    SinkRunning = true;
+}
+
+void HalPixelOutputStop()
+{
+    SinkRunning = false;
+}
+
+void HalPixelOutputFormat(int format)
+{
+    SinkFormat = format;
+}
+
+void HalPixelPut(uint32_t word)
+{
+    //  A stopped state machine never drains, same as the board
+    while (!SinkRunning)
+    {
+        HalSleepMs(1);
+    }
+
+    uint64_t now = HostSinkWaitForRoom();
+
+    pthread_mutex_lock(&SinkLock);
+    HostSinkQueue(now, (uint32_t) PixelFormatUnpack(SinkFormat, word));
+    pthread_mutex_unlock(&SinkLock);
+}
+
+void HalPixelOutputBrightness(uint32_t level)
+{
+    //  Frames are collected as the colours sent, brightness isn't applied
+    (void) level;
+}
+
+void HalPixelFrameEnd()
+{
+    if (SinkProfile == NULL || SinkProfile->protocol != PIXEL_PROTOCOL_APA102)
+    {
+        return;
+    }
+
+    uint64_t now = HalTimeUs();
+    if (SinkBusyUntil > now)
+    {
+        HalSleepUs(SinkBusyUntil - now);
+        now = HalTimeUs();
+    }
+
+    //  The end frame is clocked out behind the last pixel, the string shows the frame as it goes
+    pthread_mutex_lock(&SinkLock);
+    uint64_t frameUs = (uint64_t) PixelTimingClockedFrameBits(SinkFramePixels) * 1000000 / SinkProfile->bitHz;
+    SinkBusyUntil = (SinkBusyUntil > now ? SinkBusyUntil : now) + frameUs;
+    SinkFramePixels = 0;
+    HostSinkLatch();
+    pthread_mutex_unlock(&SinkLock);
+}
+
+bool HalPixelOutputFull()
+{
+    return SinkBusyUntil > HalTimeUs() + HOST_FIFO_DEPTH * SinkPixelUs;
+}
+
+uint32_t HalPixelOutputTakeFlags()
+{
+    pthread_mutex_lock(&SinkLock);
+    bool stalled = SinkStalled || HalTimeUs() > SinkBusyUntil;
+    SinkStalled = false;
+    pthread_mutex_unlock(&SinkLock);
+
+    //  Writers always block, nothing is ever dropped
+    return stalled ? HAL_PIXEL_STALLED : 0;
+}
+
+void HalPixelOutputFlush(uint32_t latchUs)
+{
+    if (SinkProfile != NULL && SinkProfile->protocol == PIXEL_PROTOCOL_APA102)
+    {
+        if (SinkFramePixels > 0)
+        {
+            HalPixelFrameEnd();
+        }
+        latchUs = 0;
+    }
+
+    uint64_t now = HalTimeUs();
+
+    if (SinkBusyUntil > now)
+    {
+        HalSleepUs(SinkBusyUntil - now);
+    }
+    HalSleepUs(latchUs);
+
+    pthread_mutex_lock(&SinkLock);
+    HostSinkLatchIfIdle(HalTimeUs());
+    pthread_mutex_unlock(&SinkLock);
+}
+
+bool HalPixelBytesBegin()
+{
+    return true;
+}
+
+void HalPixelBytesWrite(const uint8_t* bytes, uint32_t length)
+{
+    uint64_t now = HostSinkWaitForRoom();
+    uint32_t pixelBytes = (uint32_t) PixelFormatBits(SinkFormat) / 8;
+
+    //  Packed the way the format's words are shifted out, first byte on the wire first
+    pthread_mutex_lock(&SinkLock);
+    for (uint32_t i = 0; i + pixelBytes <= length; i += pixelBytes)
+    {
+        uint32_t word = 0;
+        for (uint32_t j = 0; j < pixelBytes; j++)
+        {
+            word |= (uint32_t) bytes[i + j] << (24 - 8 * j);
+        }
+        HostSinkQueue(now, (uint32_t) PixelFormatUnpack(SinkFormat, word));
+    }
+    pthread_mutex_unlock(&SinkLock);
+}
+
+bool HalPixelBytesBusy()
+{
+    //  DMA is done once the last byte is in the FIFO
+    return SinkBusyUntil > HalTimeUs() + HOST_FIFO_DEPTH * SinkPixelUs;
+}
+
+void HalPixelBytesEnd()
+{
+}
+
+uint32_t HalSinkFrames()
+{
+    pthread_mutex_lock(&SinkLock);
+    HostSinkLatchIfIdle(HalTimeUs());
+    uint32_t frames = SinkFramesLatched;
+    pthread_mutex_unlock(&SinkLock);
+
+    return frames;
+}
+
+const int* HalSinkLastFrame(int* pixelCount)
+{
+    *pixelCount = SinkLastLength;
+    return SinkLast;
+}
+
+//
+//  Console, stdin and stdout (usb_cdc_host.c points them at a pty)
+//
+int HalConsoleRead()
+{
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    unsigned char character;
+
+    if (poll(&input, 1, 0) <= 0 || read(STDIN_FILENO, &character, 1) != 1)
+    {
+        return -1;
+    }
+
+    return character;
+}
+
+void HalConsoleInit()
+{
+    //  The TUI writes escape sequences without newlines, don't hold them back
+    setvbuf(stdout, NULL, _IONBF, 0);
+}
+
+//
+//  Audio Input, from the raw signed 16 bit mono file named by PICOPIXOS_AUDIO, played in real time and looped
+//
+static uint16_t AudioRing[HAL_AUDIO_BLOCKS * HAL_AUDIO_BLOCK_SAMPLES];
+static volatile uint32_t AudioBlockCount = 0;
+static volatile bool AudioRunning = false;
+static FILE* AudioFile = NULL;
+static uint32_t AudioSampleRate = 0;
+static pthread_t AudioThread;
+
+static void* HostAudio(void* unused)
+{
+    (void) unused;
+
+    uint64_t start = HalTimeUs();
+    uint32_t blocks = 0;
+
+    while (AudioRunning)
+    {
+        int16_t samples[HAL_AUDIO_BLOCK_SAMPLES];
+        size_t count = fread(samples, sizeof(int16_t), HAL_AUDIO_BLOCK_SAMPLES, AudioFile);
+
+        while (count < HAL_AUDIO_BLOCK_SAMPLES)
+        {
+            rewind(AudioFile);
+            count += fread(samples + count, sizeof(int16_t), HAL_AUDIO_BLOCK_SAMPLES - count, AudioFile);
+        }
+
+        //  When the block would have finished arriving from the ADC
+        blocks++;
+        uint64_t due = start + (uint64_t) blocks * HAL_AUDIO_BLOCK_SAMPLES * 1000000 / AudioSampleRate;
+        uint64_t now = HalTimeUs();
+        if (due > now)
+        {
+            HalSleepUs(due - now);
+        }
+
+        //  12 bit, biased to the middle like a microphone module
+        uint16_t* block = &AudioRing[(blocks - 1) % HAL_AUDIO_BLOCKS * HAL_AUDIO_BLOCK_SAMPLES];
+        for (int i = 0; i < HAL_AUDIO_BLOCK_SAMPLES; i++)
+        {
+            block[i] = (uint16_t) ((samples[i] >> 4) + 2048);
+        }
+
+        __sync_synchronize();
+        AudioBlockCount = blocks;
+    }
+
+    return NULL;
+}
+
+bool HalAudioStart(uint pin, uint32_t sampleRate)
+{
+    (void) pin;
+
+    const char* path = getenv("PICOPIXOS_AUDIO");
+    if (AudioRunning || path == NULL || sampleRate == 0)
+    {
+        return false;
+    }
+
+    AudioFile = fopen(path, "rb");
+    if (AudioFile == NULL)
+    {
+        return false;
+    }
+
+    //  Needs at least one sample to loop on
+    fseek(AudioFile, 0, SEEK_END);
+    if (ftell(AudioFile) < (long) sizeof(int16_t))
+    {
+        fclose(AudioFile);
+        AudioFile = NULL;
+        return false;
+    }
+    rewind(AudioFile);
+
+    AudioSampleRate = sampleRate;
+    AudioBlockCount = 0;
+    AudioRunning = true;
+    pthread_create(&AudioThread, NULL, HostAudio, NULL);
+
+    return true;
+}
+
+void HalAudioStop()
+{
+    if (!AudioRunning)
+    {
+        return;
+    }
+
+    AudioRunning = false;
+    pthread_join(AudioThread, NULL);
+    fclose(AudioFile);
+    AudioFile = NULL;
+}
+
+uint32_t HalAudioBlocks()
+{
+    return AudioBlockCount;
+}
+
+const uint16_t* HalAudioRing()
+{
+    return AudioRing;
+}
+
+//
+//  Cores
+//
+static __thread int HostCoreNumber = 0;
+
+static void* HostCore1(void* entry)
+{
+    HostCoreNumber = 1;
+    ((void (*)()) entry)();
+    return NULL;
+}
+
+void HalLaunchCore1(void (*entry)())
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, HostCore1, (void*) entry);
+}
+
+int HalCoreNumber()
+{
+    return HostCoreNumber;
+}
+
+//  Flash is plain memory on the host, nothing has to stop while it's written
+void HalCoreLockoutVictimInit()
+{
+}
+
+void HalCoreLockoutStart()
+{
+}
+
+void HalCoreLockoutEnd()
+{
+}
+
+//
+//  Flash, in RAM or mapped from the file named by PICOPIXOS_FLASH so settings survive a restart
+//
+static uint8_t* HostFlash = NULL;
+
+static uint8_t* HostFlashMemory()
+{
+    if (HostFlash != NULL)
+    {
+        return HostFlash;
+    }
+
+    const char* path = getenv("PICOPIXOS_FLASH");
+    int fd = path != NULL ? open(path, O_RDWR | O_CREAT, 0666) : -1;
+    struct stat info;
+
+    if (fd >= 0 && fstat(fd, &info) == 0)
+    {
+        bool fresh = info.st_size < HAL_FLASH_SIZE;
+
+        if (ftruncate(fd, HAL_FLASH_SIZE) == 0)
+        {
+            HostFlash = mmap(NULL, HAL_FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (HostFlash == MAP_FAILED)
+            {
+                HostFlash = NULL;
+            }
+            else if (fresh)
+            {
+                memset(HostFlash + info.st_size, 0xFF, HAL_FLASH_SIZE - info.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    if (HostFlash == NULL)
+    {
+        HostFlash = malloc(HAL_FLASH_SIZE);
+        memset(HostFlash, 0xFF, HAL_FLASH_SIZE);
+    }
+
+    return HostFlash;
+}
+
+const uint8_t* HalFlashRead(uint32_t offset)
+{
+    return HostFlashMemory() + offset;
+}
+
+const uint8_t* HalFlashReadUncached(uint32_t offset)
+{
+    return HostFlashMemory() + offset;
+}
+
+void HalFlashErase(uint32_t offset, uint32_t length)
+{
+    memset(HostFlashMemory() + offset, 0xFF, length);
+}
+
+void HalFlashProgram(uint32_t offset, const uint8_t* data, uint32_t length)
+{
+    uint8_t* target = HostFlashMemory() + offset;
+
+    //  Programming can only clear bits, like the real thing
+    for (uint32_t i = 0; i < length; i++)
+    {
+        target[i] &= data[i];
+    }
+}
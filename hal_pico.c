@@ -0,0 +1,470 @@
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/adc.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "ws2812/generated/ws2812.pio.h"
+#include "apa102/generated/apa102.pio.h"
+#include "hal.h"
+
+//
+//  Time
+//
+uint64_t HalTimeUs()
+{
+    return time_us_64();
+}
+
+void HalSleepUs(uint64_t us)
+{
+    sleep_us(us);
+}
+
+void HalSleepMs(uint32_t ms)
+{
+    sleep_ms(ms);
+}
+
+void HalIdle()
+{
+    tight_loop_contents();
+}
+
+uint32_t HalCpuHz()
+{
+    return clock_get_hz(clk_sys);
+}
+
+//
+//  Pixel Output
+//
+static PIO PixelPio;
+static uint PixelStateMachine;
+static int PixelDmaChannel = -1;
+
+//  The ws2812 program as loaded, with the profile's delays, or the apa102 program with the brightness
+static uint16_t PixelProgramInstructions[PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH];
+static struct pio_program PixelProgram =
+        {
+                .instructions = PixelProgramInstructions,
+                .length = PIXEL_TIMING_PROGRAM_LENGTH,
+                .origin = -1
+        };
+static uint PixelProgramOffset;
+
+static int PixelProtocol = PIXEL_PROTOCOL_WS2812;
+static uint PixelBits = 24;
+static uint32_t PixelBrightness = 31;
+
+//  Queued since the last end frame, sizes the next one
+static uint32_t PixelFramePixels = 0;
+
+//
+//  Bits the state machine pulls per FIFO word
+//
+static void HalSetPullThreshold(uint bits)
+{
+    //  32 is written as 0
+    hw_write_masked(&PixelPio->sm[PixelStateMachine].shiftctrl,
+                    (bits & 0x1F) << PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB,
+                    PIO_SM0_SHIFTCTRL_PULL_THRESH_BITS);
+}
+
+void HalPixelOutputStart(int pioBlock, int stateMachine, uint pin, const struct PixelTimingProfile* profile)
+{
+    PixelPio = pioBlock ? pio1 : pio0;
+    PixelStateMachine = stateMachine;
+
+    //  Get the GPIO ready on the target pin
+    gpio_init(pin);
+
+    //  Make the GPIO an output
+    gpio_set_dir(pin, GPIO_OUT);
+
+    PixelProtocol = profile->protocol;
+    PixelFramePixels = 0;
+
+    //  The apa102 program always sends 24 bits after the header
+    if (PixelProtocol == PIXEL_PROTOCOL_APA102)
+    {
+        PixelBits = 24;
+    }
+
+    if (PixelProtocol == PIXEL_PROTOCOL_APA102)
+    {
+        PixelTimingClockedProgram(PixelBrightness, PixelProgramInstructions);
+        PixelProgram.length = PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH;
+        PixelProgramOffset = pio_add_program(PixelPio, &PixelProgram);
+
+        //  Starts in the frame routine, waiting for the zeros of the first start frame
+        apa102_program_init(PixelPio, PixelStateMachine, PixelProgramOffset, pin, pin + 1, (float) profile->bitHz);
+        pio_sm_put(PixelPio, PixelStateMachine, 32 - 1);
+        return;
+    }
+
+    //  Get the program offset that we load up into the pio
+    PixelTimingProgram(profile, PixelProgramInstructions);
+    PixelProgram.length = PIXEL_TIMING_PROGRAM_LENGTH;
+    PixelProgramOffset = pio_add_program(PixelPio, &PixelProgram);
+
+    //  Same set up as ws2812_program_init, with the profile's cycles per bit and rate
+    pio_gpio_init(PixelPio, pin);
+    pio_sm_set_consecutive_pindirs(PixelPio, PixelStateMachine, pin, 1, true);
+
+    pio_sm_config config = ws2812_program_get_default_config(PixelProgramOffset);
+    sm_config_set_sideset_pins(&config, pin);
+    sm_config_set_out_shift(&config, false, true, PixelBits);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+
+    int cyclesPerBit = profile->t1 + profile->t2 + profile->t3;
+    sm_config_set_clkdiv(&config, (float) clock_get_hz(clk_sys) / ((float) profile->bitHz * cyclesPerBit));
+
+    pio_sm_init(PixelPio, PixelStateMachine, PixelProgramOffset, &config);
+    pio_sm_set_enabled(PixelPio, PixelStateMachine, true);
+}
+
+void HalPixelOutputStop()
+{
+    pio_sm_set_enabled(PixelPio, PixelStateMachine, false);
+
+    //  Free the instruction memory, the next start may load a different split
+    pio_remove_program(PixelPio, &PixelProgram, PixelProgramOffset);
+}
+
+void HalPixelOutputBrightness(uint32_t level)
+{
+    PixelBrightness = level & 0x1F;
+
+    if (PixelProtocol != PIXEL_PROTOCOL_APA102)
+    {
+        return;
+    }
+
+    //  Rewrite the header SETs in place, a pixel already going out may get a mix of old and new
+    PixelTimingClockedProgram(PixelBrightness, PixelProgramInstructions);
+    for (uint i = apa102_offset_brightness; i < apa102_offset_brightness + 9; i += 2)
+    {
+        PixelPio->instr_mem[PixelProgramOffset + i] = PixelProgramInstructions[i];
+    }
+}
+
+void HalPixelOutputFormat(int format)
+{
+    PixelBits = PixelFormatBits(format);
+}
+
+void HalPixelPut(uint32_t word)
+{
+    pio_sm_put_blocking(PixelPio, PixelStateMachine, word);
+    PixelFramePixels++;
+}
+
+//
+//  Wait for the apa102 program to be sat at pixel with nothing left to send
+//
+static void HalClockedWaitIdle()
+{
+    uint32_t stalled = 1u << (PIO_FDEBUG_TXSTALL_LSB + PixelStateMachine);
+
+    //  Stall is sticky, only one from now on counts
+    PixelPio->fdebug = stalled;
+
+    while (!(PixelPio->fdebug & stalled) || !pio_sm_is_tx_fifo_empty(PixelPio, PixelStateMachine) ||
+           pio_sm_get_pc(PixelPio, PixelStateMachine) != PixelProgramOffset + apa102_offset_pixel)
+    {
+        tight_loop_contents();
+    }
+}
+
+void HalPixelFrameEnd()
+{
+    if (PixelProtocol != PIXEL_PROTOCOL_APA102)
+    {
+        return;
+    }
+
+    HalClockedWaitIdle();
+
+    //  Into the frame routine, then tell it how many zeros
+    pio_sm_exec(PixelPio, PixelStateMachine, pio_encode_jmp(PixelProgramOffset + apa102_offset_frame));
+    pio_sm_put(PixelPio, PixelStateMachine, PixelTimingClockedFrameBits(PixelFramePixels) - 1);
+
+    PixelFramePixels = 0;
+}
+
+bool HalPixelOutputFull()
+{
+    return pio_sm_is_tx_fifo_full(PixelPio, PixelStateMachine);
+}
+
+uint32_t HalPixelOutputTakeFlags()
+{
+    uint32_t stalled = 1u << (PIO_FDEBUG_TXSTALL_LSB + PixelStateMachine);
+    uint32_t overflowed = 1u << (PIO_FDEBUG_TXOVER_LSB + PixelStateMachine);
+    uint32_t debug = PixelPio->fdebug & (stalled | overflowed);
+
+    //  Write 1 to clear
+    PixelPio->fdebug = debug;
+
+    return (debug & stalled ? HAL_PIXEL_STALLED : 0) | (debug & overflowed ? HAL_PIXEL_OVERFLOWED : 0);
+}
+
+void HalPixelOutputFlush(uint32_t latchUs)
+{
+    if (PixelProtocol == PIXEL_PROTOCOL_APA102)
+    {
+        if (PixelFramePixels > 0)
+        {
+            HalPixelFrameEnd();
+        }
+        HalClockedWaitIdle();
+        return;
+    }
+
+    while (!pio_sm_is_tx_fifo_empty(PixelPio, PixelStateMachine))
+    {
+        tight_loop_contents();
+    }
+    sleep_us(latchUs);
+}
+
+bool HalPixelBytesBegin()
+{
+    PixelDmaChannel = dma_claim_unused_channel(false);
+    if (PixelDmaChannel < 0)
+    {
+        return false;
+    }
+
+    //  Bytes from memory to the FIFO, paced by the state machine
+    dma_channel_config config = dma_channel_get_default_config(PixelDmaChannel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(PixelPio, PixelStateMachine, true));
+    dma_channel_configure(PixelDmaChannel, &config, &PixelPio->txf[PixelStateMachine], NULL, 0, false);
+
+    //  A byte write is replicated across the word, so pulling 8 bits at a time puts each byte on the wire once
+    HalSetPullThreshold(8);
+
+    return true;
+}
+
+void HalPixelBytesWrite(const uint8_t* bytes, uint32_t length)
+{
+    PixelFramePixels += length / (PixelBits / 8);
+    dma_channel_transfer_from_buffer_now(PixelDmaChannel, bytes, length);
+}
+
+bool HalPixelBytesBusy()
+{
+    return dma_channel_is_busy(PixelDmaChannel);
+}
+
+void HalPixelBytesEnd()
+{
+    HalSetPullThreshold(PixelBits);
+
+    dma_channel_unclaim(PixelDmaChannel);
+    PixelDmaChannel = -1;
+}
+
+//
+//  Console
+//
+int HalConsoleRead()
+{
+    int input = getchar_timeout_us(0);
+
+    return input == PICO_ERROR_TIMEOUT ? -1 : input;
+}
+
+void HalConsoleInit()
+{
+    stdio_init_all();
+}
+
+//
+//  Audio Input
+//
+//  The ADC free runs into its FIFO and a data channel copies a block at a time into the ring.  When a block is
+//  done the data channel chains to a control channel, which writes the next block's address from a table into
+//  the data channel's write address trigger, restarting it, and the table wraps by the DMA's own read ring.  The
+//  completion interrupt only counts blocks, nothing is copied by the CPU.
+//
+static uint16_t AudioRing[HAL_AUDIO_BLOCKS * HAL_AUDIO_BLOCK_SAMPLES];
+static uint16_t* AudioBlockAddresses[HAL_AUDIO_BLOCKS] __attribute__((aligned(HAL_AUDIO_BLOCKS * sizeof(uint16_t*))));
+static int AudioDataChannel = -1;
+static int AudioControlChannel = -1;
+static volatile uint32_t AudioBlockCount = 0;
+
+static void HalAudioDmaIrq()
+{
+    if (dma_hw->ints1 & (1u << AudioDataChannel))
+    {
+        dma_hw->ints1 = 1u << AudioDataChannel;
+        AudioBlockCount++;
+    }
+}
+
+bool HalAudioStart(uint pin, uint32_t sampleRate)
+{
+    if (pin < 26 || pin > 29 || AudioDataChannel >= 0)
+    {
+        return false;
+    }
+
+    AudioDataChannel = dma_claim_unused_channel(false);
+    AudioControlChannel = dma_claim_unused_channel(false);
+    if (AudioDataChannel < 0 || AudioControlChannel < 0)
+    {
+        if (AudioDataChannel >= 0)
+        {
+            dma_channel_unclaim(AudioDataChannel);
+        }
+        if (AudioControlChannel >= 0)
+        {
+            dma_channel_unclaim(AudioControlChannel);
+        }
+        AudioDataChannel = -1;
+        AudioControlChannel = -1;
+        return false;
+    }
+
+    for (int i = 0; i < HAL_AUDIO_BLOCKS; i++)
+    {
+        AudioBlockAddresses[i] = &AudioRing[i * HAL_AUDIO_BLOCK_SAMPLES];
+    }
+    AudioBlockCount = 0;
+
+    adc_init();
+    adc_gpio_init(pin);
+    adc_select_input(pin - 26);
+    adc_fifo_setup(true, true, 1, false, false);
+
+    //  A conversion every clkdiv + 1 cycles of the 48 MHz ADC clock
+    adc_set_clkdiv(48000000.0f / (float) sampleRate - 1.0f);
+
+    //  FIFO to the current block, a DREQ per sample
+    dma_channel_config data = dma_channel_get_default_config(AudioDataChannel);
+    channel_config_set_transfer_data_size(&data, DMA_SIZE_16);
+    channel_config_set_read_increment(&data, false);
+    channel_config_set_write_increment(&data, true);
+    channel_config_set_dreq(&data, DREQ_ADC);
+    channel_config_set_chain_to(&data, AudioControlChannel);
+
+    //  Next address from the table into the data channel's trigger, one word per block
+    dma_channel_config control = dma_channel_get_default_config(AudioControlChannel);
+    channel_config_set_transfer_data_size(&control, DMA_SIZE_32);
+    channel_config_set_read_increment(&control, true);
+    channel_config_set_write_increment(&control, false);
+    channel_config_set_ring(&control, false, __builtin_ctz(sizeof(AudioBlockAddresses)));
+    dma_channel_configure(AudioControlChannel, &control, &dma_hw->ch[AudioDataChannel].al2_write_addr_trig,
+                          &AudioBlockAddresses[1], 1, false);
+
+    dma_channel_set_irq1_enabled(AudioDataChannel, true);
+    irq_set_exclusive_handler(DMA_IRQ_1, HalAudioDmaIrq);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    dma_channel_configure(AudioDataChannel, &data, AudioBlockAddresses[0], &adc_hw->fifo, HAL_AUDIO_BLOCK_SAMPLES,
+                          true);
+    adc_run(true);
+
+    return true;
+}
+
+void HalAudioStop()
+{
+    if (AudioDataChannel < 0)
+    {
+        return;
+    }
+
+    adc_run(false);
+
+    //  Chain the data channel to itself so stopping it can't start the control channel again
+    hw_write_masked(&dma_hw->ch[AudioDataChannel].al1_ctrl, AudioDataChannel << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB,
+                    DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS);
+    dma_channel_abort(AudioControlChannel);
+    dma_channel_abort(AudioDataChannel);
+
+    dma_channel_set_irq1_enabled(AudioDataChannel, false);
+    irq_set_enabled(DMA_IRQ_1, false);
+    irq_remove_handler(DMA_IRQ_1, HalAudioDmaIrq);
+    adc_fifo_drain();
+
+    dma_channel_unclaim(AudioControlChannel);
+    dma_channel_unclaim(AudioDataChannel);
+    AudioDataChannel = -1;
+    AudioControlChannel = -1;
+}
+
+uint32_t HalAudioBlocks()
+{
+    return AudioBlockCount;
+}
+
+const uint16_t* HalAudioRing()
+{
+    return AudioRing;
+}
+
+//
+//  Cores
+//
+void HalLaunchCore1(void (*entry)())
+{
+    multicore_launch_core1(entry);
+}
+
+int HalCoreNumber()
+{
+    return get_core_num();
+}
+
+void HalCoreLockoutVictimInit()
+{
+    multicore_lockout_victim_init();
+}
+
+void HalCoreLockoutStart()
+{
+    multicore_lockout_start_blocking();
+}
+
+void HalCoreLockoutEnd()
+{
+    multicore_lockout_end_blocking();
+}
+
+//
+//  Flash
+//
+const uint8_t* HalFlashRead(uint32_t offset)
+{
+    return (const uint8_t*) (XIP_BASE + offset);
+}
+
+const uint8_t* HalFlashReadUncached(uint32_t offset)
+{
+    //  Streaming through this alias doesn't push code out of the XIP cache
+    return (const uint8_t*) (XIP_NOCACHE_NOALLOC_BASE + offset);
+}
+
+void HalFlashErase(uint32_t offset, uint32_t length)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_erase(offset, length);
+    restore_interrupts(interrupts);
+}
+
+void HalFlashProgram(uint32_t offset, const uint8_t* data, uint32_t length)
+{
+    uint32_t interrupts = save_and_disable_interrupts();
+    flash_range_program(offset, data, length);
+    restore_interrupts(interrupts);
+}
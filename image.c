@@ -0,0 +1,459 @@
+#include <stddef.h>
+#include <string.h>
+#include "image.h"
+#include "crc.h"
+
+static inline uint32_t ReadLE32(const uint8_t* data)
+{
+    return  ((uint32_t) data[0])        |
+            ((uint32_t) data[1] << 8)   |
+            ((uint32_t) data[2] << 16)  |
+            ((uint32_t) data[3] << 24);
+}
+
+static uint32_t ImageHeaderCrc(const struct ImageHeader* header)
+{
+    return Crc32((const uint8_t*) header, offsetof(struct ImageHeader, headerCrc));
+}
+
+bool ImageOpen(struct ImageStruct* image, const void* data, uint32_t available)
+{
+    const struct ImageHeader* header = (const struct ImageHeader*) data;
+
+    if (available < sizeof(struct ImageHeader))
+    {
+        return false;
+    }
+
+    if (header->magic != IMAGE_MAGIC || header->format != IMAGE_FORMAT ||
+        header->headerLength != sizeof(struct ImageHeader) || header->headerCrc != ImageHeaderCrc(header))
+    {
+        return false;
+    }
+
+    if (header->width == 0 || header->height == 0 || header->frameCount == 0 || header->paletteSize == 0 ||
+        header->paletteSize > IMAGE_MAX_COLOURS || header->minCodeSize < 2 || header->minCodeSize > 8 ||
+        header->paletteSize > (1u << header->minCodeSize))
+    {
+        return false;
+    }
+
+    if ((header->flags & IMAGE_FLAG_TRANSPARENT) && header->transparentIndex >= header->paletteSize)
+    {
+        return false;
+    }
+
+    uint32_t paletteLength = header->paletteSize * 3u;
+    if (header->dataLength < paletteLength || (uint64_t) header->headerLength + header->dataLength > available)
+    {
+        return false;
+    }
+
+    const uint8_t* body = (const uint8_t*) data + header->headerLength;
+    if (Crc32(body, header->dataLength) != header->dataCrc)
+    {
+        return false;
+    }
+
+    //  Every frame has to end inside the data, and the last one right at its end
+    const uint8_t* frames = body + paletteLength;
+    uint32_t framesLength = header->dataLength - paletteLength;
+    uint32_t offset = 0;
+
+    for (int i = 0; i < header->frameCount; i++)
+    {
+        if (framesLength - offset < IMAGE_FRAME_HEADER_LENGTH)
+        {
+            return false;
+        }
+
+        uint32_t length = ReadLE32(frames + offset + IMAGE_FRAME_LENGTH);
+        offset += IMAGE_FRAME_HEADER_LENGTH;
+
+        if (length > framesLength - offset)
+        {
+            return false;
+        }
+        offset += length;
+    }
+
+    if (offset != framesLength)
+    {
+        return false;
+    }
+
+    image->header = header;
+    image->palette = body;
+    image->frames = frames;
+    ImageRewind(image);
+
+    return true;
+}
+
+void ImageHeaderInit(struct ImageHeader* header, uint16_t width, uint16_t height, uint16_t frameCount,
+                     const uint8_t* palette, uint16_t paletteSize, uint8_t minCodeSize, int transparentIndex,
+                     const uint8_t* frames, uint32_t framesLength)
+{
+    header->magic = IMAGE_MAGIC;
+    header->format = IMAGE_FORMAT;
+    header->headerLength = sizeof(struct ImageHeader);
+    header->width = width;
+    header->height = height;
+    header->frameCount = frameCount;
+    header->paletteSize = paletteSize;
+    header->minCodeSize = minCodeSize;
+    header->flags = transparentIndex >= 0 ? IMAGE_FLAG_TRANSPARENT : 0;
+    header->transparentIndex = transparentIndex >= 0 ? (uint16_t) transparentIndex : 0;
+    header->dataLength = paletteSize * 3u + framesLength;
+
+    //  Palette and frames are laid out back to back, so the CRC runs over both
+    uint32_t crc = Crc32Update(CRC32_INITIAL, palette, paletteSize * 3u);
+    crc = Crc32Update(crc, frames, framesLength);
+    header->dataCrc = Crc32Final(crc);
+
+    header->headerCrc = ImageHeaderCrc(header);
+}
+
+void ImageRewind(struct ImageStruct* image)
+{
+    image->frameIndex = 0;
+    image->frameOffset = 0;
+}
+
+uint32_t ImageRenderNext(struct ImageStruct* image, struct ImageDecoderStruct* decoder, int* pixels, int pixelCount,
+                         const struct PixelMatrixStruct* matrix)
+{
+    const struct ImageHeader* header = image->header;
+    const uint8_t* frame = image->frames + image->frameOffset;
+    uint32_t length = ReadLE32(frame + IMAGE_FRAME_LENGTH);
+    uint32_t delayMs = ReadLE32(frame + IMAGE_FRAME_DELAY);
+
+    //  Later frames build on the one before, the first starts from black
+    if (image->frameIndex == 0)
+    {
+        memset(pixels, 0, sizeof(int) * pixelCount);
+    }
+
+    ImageDecoderSetPalette(decoder, image->palette, header->paletteSize);
+    ImageDecoderBegin(decoder, header->width, header->height, header->minCodeSize,
+                      header->flags & IMAGE_FLAG_TRANSPARENT ? header->transparentIndex : -1, pixels, matrix);
+
+    //  A bad frame leaves whatever it got through, the CRC makes that a corrupt encoder rather than bad flash
+    ImageDecoderFeed(decoder, frame + IMAGE_FRAME_HEADER_LENGTH, (int) length);
+
+    image->frameOffset += IMAGE_FRAME_HEADER_LENGTH + length;
+    if (++image->frameIndex == header->frameCount)
+    {
+        ImageRewind(image);
+    }
+
+    return delayMs;
+}
+
+//
+//  Decoder
+//
+
+void ImageDecoderSetPalette(struct ImageDecoderStruct* decoder, const uint8_t* palette, int count)
+{
+    for (int i = 0; i < count; i++, palette += 3)
+    {
+        decoder->colours[i] = palette[1] << 16 | palette[0] << 8 | palette[2];
+    }
+
+    //  Codes past the palette come out black
+    for (int i = count; i < IMAGE_MAX_COLOURS; i++)
+    {
+        decoder->colours[i] = 0;
+    }
+}
+
+bool ImageDecoderBegin(struct ImageDecoderStruct* decoder, int width, int height, int minCodeSize, int transparent,
+                       int* pixels, const struct PixelMatrixStruct* matrix)
+{
+    if (minCodeSize < 2 || minCodeSize > 8)
+    {
+        decoder->result = IMAGE_DECODE_ERROR;
+        return false;
+    }
+
+    decoder->pixels = pixels;
+    decoder->matrix = matrix;
+    decoder->width = width;
+    decoder->height = height;
+    decoder->x = 0;
+    decoder->y = 0;
+    decoder->transparent = transparent;
+
+    decoder->result = IMAGE_DECODE_MORE;
+    decoder->minCodeSize = minCodeSize;
+    decoder->codeSize = minCodeSize + 1;
+    decoder->nextCode = (1 << minCodeSize) + 2;
+    decoder->previousCode = -1;
+    decoder->firstIndex = 0;
+    decoder->bits = 0;
+    decoder->bitCount = 0;
+
+    return true;
+}
+
+//
+//  Write count indices off the top of the stack along the rows, false if they run off the bottom
+//
+static bool ImageDecoderWrite(struct ImageDecoderStruct* decoder, int count)
+{
+    const struct PixelMatrixStruct* matrix = decoder->matrix;
+    const uint8_t* stack = decoder->stack;
+    const int* colours = decoder->colours;
+    int* pixels = decoder->pixels;
+    int transparent = decoder->transparent;
+    int x = decoder->x;
+
+    while (count > 0)
+    {
+        if (decoder->y >= decoder->height)
+        {
+            return false;
+        }
+
+        //  Part of this row on the panel, worked out once per run along it
+        int run = decoder->width - x < count ? decoder->width - x : count;
+        int visible = decoder->y < matrix->height ? matrix->width : 0;
+        const uint16_t* row = matrix->table + decoder->y * matrix->width;
+
+        for (int end = x + run; x < end; x++)
+        {
+            int index = stack[--count];
+
+            if (x < visible && index != transparent)
+            {
+                pixels[row[x]] = colours[index];
+            }
+        }
+
+        if (x == decoder->width)
+        {
+            x = 0;
+            decoder->y++;
+        }
+    }
+
+    decoder->x = x;
+
+    return true;
+}
+
+int ImageDecoderFeed(struct ImageDecoderStruct* decoder, const uint8_t* data, int length)
+{
+    int clearCode = 1 << decoder->minCodeSize;
+    int endCode = clearCode + 1;
+
+    for (int i = 0; i < length && decoder->result == IMAGE_DECODE_MORE; i++)
+    {
+        decoder->bits |= (uint32_t) data[i] << decoder->bitCount;
+        decoder->bitCount += 8;
+
+        while (decoder->bitCount >= decoder->codeSize)
+        {
+            int code = (int) (decoder->bits & ((1u << decoder->codeSize) - 1));
+            decoder->bits >>= decoder->codeSize;
+            decoder->bitCount -= decoder->codeSize;
+
+            if (code == clearCode)
+            {
+                decoder->codeSize = decoder->minCodeSize + 1;
+                decoder->nextCode = clearCode + 2;
+                decoder->previousCode = -1;
+                continue;
+            }
+
+            if (code == endCode)
+            {
+                decoder->result = IMAGE_DECODE_DONE;
+                break;
+            }
+
+            //  First code after a clear is a single index and adds nothing to the dictionary
+            if (decoder->previousCode < 0)
+            {
+                if (code > clearCode)
+                {
+                    decoder->result = IMAGE_DECODE_ERROR;
+                    break;
+                }
+
+                decoder->stack[0] = (uint8_t) code;
+                decoder->firstIndex = (uint8_t) code;
+                decoder->previousCode = code;
+
+                if (!ImageDecoderWrite(decoder, 1))
+                {
+                    decoder->result = IMAGE_DECODE_ERROR;
+                    break;
+                }
+                continue;
+            }
+
+            //  The one code that isn't in the dictionary yet is the previous string plus its own first index
+            if (code > decoder->nextCode || (code == decoder->nextCode && code == IMAGE_MAX_CODES))
+            {
+                decoder->result = IMAGE_DECODE_ERROR;
+                break;
+            }
+
+            int count = 0;
+            int current = code;
+
+            if (code == decoder->nextCode)
+            {
+                decoder->stack[count++] = decoder->firstIndex;
+                current = decoder->previousCode;
+            }
+
+            while (current > endCode)
+            {
+                decoder->stack[count++] = decoder->suffix[current];
+                current = decoder->prefix[current];
+            }
+
+            decoder->stack[count++] = (uint8_t) current;
+            decoder->firstIndex = (uint8_t) current;
+
+            if (decoder->nextCode < IMAGE_MAX_CODES)
+            {
+                decoder->prefix[decoder->nextCode] = (uint16_t) decoder->previousCode;
+                decoder->suffix[decoder->nextCode] = decoder->firstIndex;
+                decoder->nextCode++;
+
+                if (decoder->nextCode == 1 << decoder->codeSize && decoder->codeSize < IMAGE_MAX_CODE_BITS)
+                {
+                    decoder->codeSize++;
+                }
+            }
+
+            decoder->previousCode = code;
+
+            if (!ImageDecoderWrite(decoder, count))
+            {
+                decoder->result = IMAGE_DECODE_ERROR;
+                break;
+            }
+        }
+    }
+
+    return decoder->result;
+}
+
+//
+//  Encoder, used by the host tools
+//
+
+struct ImageBitWriter
+{
+    uint8_t* output;
+    int length;
+    uint32_t bits;
+    int bitCount;
+};
+
+static void ImagePutCode(struct ImageBitWriter* writer, int code, int codeSize)
+{
+    writer->bits |= (uint32_t) code << writer->bitCount;
+    writer->bitCount += codeSize;
+
+    while (writer->bitCount >= 8)
+    {
+        writer->output[writer->length++] = writer->bits & 0xFF;
+        writer->bits >>= 8;
+        writer->bitCount -= 8;
+    }
+}
+
+static void ImageEncoderReset(struct ImageEncoderStruct* encoder)
+{
+    memset(encoder->keys, 0xFF, sizeof(encoder->keys));
+}
+
+//
+//  Slot holding key, or the empty one it would go in
+//
+static int ImageEncoderFind(const struct ImageEncoderStruct* encoder, uint32_t key)
+{
+    int slot = (int) ((key * 2654435761u) % IMAGE_ENCODER_HASH_SIZE);
+
+    while (encoder->keys[slot] != key && encoder->keys[slot] != 0xFFFFFFFFu)
+    {
+        slot = slot + 1 == IMAGE_ENCODER_HASH_SIZE ? 0 : slot + 1;
+    }
+
+    return slot;
+}
+
+int ImageEncodeLzw(struct ImageEncoderStruct* encoder, uint8_t* output, const uint8_t* indices, int count,
+                   int minCodeSize)
+{
+    struct ImageBitWriter writer = {output, 0, 0, 0};
+    int clearCode = 1 << minCodeSize;
+    int codeSize = minCodeSize + 1;
+    int nextCode = clearCode + 2;
+
+    ImageEncoderReset(encoder);
+    ImagePutCode(&writer, clearCode, codeSize);
+
+    if (count > 0)
+    {
+        int prefix = indices[0];
+
+        for (int i = 1; i < count; i++)
+        {
+            uint32_t key = (uint32_t) prefix << 8 | indices[i];
+            int slot = ImageEncoderFind(encoder, key);
+
+            if (encoder->keys[slot] == key)
+            {
+                prefix = encoder->codes[slot];
+                continue;
+            }
+
+            ImagePutCode(&writer, prefix, codeSize);
+
+            //  The decoder adds each entry a code later, so it widens its codes one entry later too
+            if (nextCode < IMAGE_MAX_CODES)
+            {
+                encoder->keys[slot] = key;
+                encoder->codes[slot] = (uint16_t) nextCode++;
+
+                if (nextCode > 1 << codeSize && codeSize < IMAGE_MAX_CODE_BITS)
+                {
+                    codeSize++;
+                }
+            }
+            else
+            {
+                ImagePutCode(&writer, clearCode, codeSize);
+                ImageEncoderReset(encoder);
+                codeSize = minCodeSize + 1;
+                nextCode = clearCode + 2;
+            }
+
+            prefix = indices[i];
+        }
+
+        ImagePutCode(&writer, prefix, codeSize);
+
+        //  The decoder adds an entry for that last code before it reads the end code
+        if (nextCode == 1 << codeSize && codeSize < IMAGE_MAX_CODE_BITS)
+        {
+            codeSize++;
+        }
+    }
+
+    ImagePutCode(&writer, clearCode + 1, codeSize);
+
+    if (writer.bitCount > 0)
+    {
+        output[writer.length++] = writer.bits & 0xFF;
+    }
+
+    return writer.length;
+}
@@ -0,0 +1,172 @@
+#ifndef PICOPIXOS_IMAGE_H
+#define PICOPIXOS_IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "pixel_matrix.h"
+
+//
+//  Indexed Colour Images
+//
+//  GIF-class pictures: up to 256 palette colours, each frame's pixel indices LZW coded the way GIF codes them,
+//  variable width codes from minCodeSize + 1 bits up to 12, packed least significant bit first, with a clear
+//  code and an end code.  There is no sub-block framing, a frame's codes are one run of bytes.
+//
+//  The decoder takes codes in pieces of any size and writes each pixel as it comes out straight into the pixel
+//  buffer through the matrix table, along rows from the top left, so nothing the size of the image is ever
+//  held.  Its working memory is the LZW dictionary and one string's worth of stack, fixed whatever the image
+//  size.  Pixels outside the matrix are dropped, the image is drawn from the canvas' top left corner.
+//
+//  Pictures for flash go in a container in the animation slot (ANIMATION_FLASH_OFFSET), the magic says which:
+//
+//      Offset  Size    Field
+//      0       32      struct ImageHeader (little endian)
+//      32      3 * n   paletteSize colours, R, G, B
+//      ...             frameCount frames, each 8 bytes of IMAGE_FRAME_ fields then that many bytes of codes
+//
+//  Frames are shown in order for their delay in ms and loop, none for less than one output frame.  With
+//  IMAGE_FLAG_TRANSPARENT, pixels of colour transparentIndex leave what the frame before drew, so later frames
+//  only need to code what changed.
+//
+
+//  'PPXI'
+#define IMAGE_MAGIC 0x49585050u
+#define IMAGE_FORMAT 1
+
+#define IMAGE_MAX_COLOURS 256
+#define IMAGE_MAX_CODE_BITS 12
+#define IMAGE_MAX_CODES (1 << IMAGE_MAX_CODE_BITS)
+
+//  transparentIndex is used
+#define IMAGE_FLAG_TRANSPARENT 0x01
+
+//  Frame header, byte offsets as frames aren't aligned
+#define IMAGE_FRAME_LENGTH 0
+#define IMAGE_FRAME_DELAY 4
+#define IMAGE_FRAME_HEADER_LENGTH 8
+
+//  Room the encoder can need for a frame of pixels, a 12 bit code per pixel at worst plus clears
+#define IMAGE_LZW_MAX_LENGTH(pixels) ((pixels) * 2 + 16)
+
+struct ImageHeader
+{
+    uint32_t magic;
+    uint16_t format;
+    uint16_t headerLength;
+    uint16_t width;
+    uint16_t height;
+    uint16_t frameCount;
+    uint16_t paletteSize;
+    uint8_t minCodeSize;
+    uint8_t flags;
+    uint16_t transparentIndex;
+
+    //  Palette and frames, and their CRC-32
+    uint32_t dataLength;
+    uint32_t dataCrc;
+
+    //  CRC-32 of everything above
+    uint32_t headerCrc;
+};
+
+//  An image opened in place, and where playback has got to
+struct ImageStruct
+{
+    const struct ImageHeader* header;
+    const uint8_t* palette;
+    const uint8_t* frames;
+
+    //  Next frame to show and its offset from frames
+    int frameIndex;
+    uint32_t frameOffset;
+};
+
+//  Decoder results
+enum ImageDecodeResults
+{
+    IMAGE_DECODE_MORE = 0,
+    IMAGE_DECODE_DONE,
+    IMAGE_DECODE_ERROR
+};
+
+struct ImageDecoderStruct
+{
+    //
+    //  Output
+    //
+    int* pixels;
+    const struct PixelMatrixStruct* matrix;
+    int width;
+    int height;
+    int x;
+    int y;
+
+    //  Palette index that isn't drawn, -1 for none
+    int transparent;
+
+    //  GRB, as the pixel buffer holds them
+    int colours[IMAGE_MAX_COLOURS];
+
+    //
+    //  LZW State
+    //
+    int result;
+    int minCodeSize;
+    int codeSize;
+    int nextCode;
+    int previousCode;
+    uint8_t firstIndex;
+    uint32_t bits;
+    int bitCount;
+
+    //  Each code is its prefix code plus one more index, strings are unwound backwards onto the stack
+    uint16_t prefix[IMAGE_MAX_CODES];
+    uint8_t suffix[IMAGE_MAX_CODES];
+    uint8_t stack[IMAGE_MAX_CODES];
+};
+
+//  Checks an image held in available bytes at data, and points image at its parts and its first frame
+bool ImageOpen(struct ImageStruct* image, const void* data, uint32_t available);
+
+//  Fill in a header for a palette and frames laid out after it, including both CRCs
+void ImageHeaderInit(struct ImageHeader* header, uint16_t width, uint16_t height, uint16_t frameCount,
+                     const uint8_t* palette, uint16_t paletteSize, uint8_t minCodeSize, int transparentIndex,
+                     const uint8_t* frames, uint32_t framesLength);
+
+//  Decode the next frame over pixels through matrix and move on, clearing pixelCount pixels first when it's the
+//  first frame.  Returns how long to show it in ms.
+uint32_t ImageRenderNext(struct ImageStruct* image, struct ImageDecoderStruct* decoder, int* pixels, int pixelCount,
+                         const struct PixelMatrixStruct* matrix);
+
+//  Back to the first frame
+void ImageRewind(struct ImageStruct* image);
+
+//  Set colours from R, G, B palette entries
+void ImageDecoderSetPalette(struct ImageDecoderStruct* decoder, const uint8_t* palette, int count);
+
+//  Start decoding a width by height frame into pixels, false if minCodeSize isn't 2 to 8
+bool ImageDecoderBegin(struct ImageDecoderStruct* decoder, int width, int height, int minCodeSize, int transparent,
+                       int* pixels, const struct PixelMatrixStruct* matrix);
+
+//  Feed code bytes, returns IMAGE_DECODE_DONE once the end code is read, anything after it is ignored
+int ImageDecoderFeed(struct ImageDecoderStruct* decoder, const uint8_t* data, int length);
+
+//
+//  Encoder, used by the host tools
+//
+
+//  Open addressed table of (prefix code, index) strings, a prime a bit over IMAGE_MAX_CODES
+#define IMAGE_ENCODER_HASH_SIZE 5003
+
+struct ImageEncoderStruct
+{
+    uint32_t keys[IMAGE_ENCODER_HASH_SIZE];
+    uint16_t codes[IMAGE_ENCODER_HASH_SIZE];
+};
+
+//  LZW code count palette indices, output needs room for IMAGE_LZW_MAX_LENGTH(count) bytes, returns the length
+int ImageEncodeLzw(struct ImageEncoderStruct* encoder, uint8_t* output, const uint8_t* indices, int count,
+                   int minCodeSize);
+
+#endif
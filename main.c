@@ -1,10 +1,20 @@
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "pico/stdlib.h"
-#include "hardware/pio.h"
-#include "hardware/clocks.h"
-#include "ws2812/generated/ws2812.pio.h"
-#include "pico/multicore.h"
+#include "hal.h"
+#include "stream.h"
+#include "usb_cdc.h"
+#include "settings_store.h"
+#include "animation_player.h"
+#include "show.h"
+#include "image.h"
+#include "pixel_monitor.h"
+#include "effects.h"
+#include "pixel_matrix.h"
+#include "fast_random.h"
+#include "frame_timing.h"
+#include "trace.h"
+#include "audio.h"
 
 //
 //  DEFAULTS
@@ -15,7 +25,7 @@ uint NUMBER_OF_PIXELS = 24;
 //
 //  Version String to Tag things and Check Against
 //
-const char OSVersionString[17] = "Pico Pix OS V1.0";
+const char OSVersionString[17] = "Pico Pix OS V1.1";
 
 //
 //  Utility Functions
@@ -42,47 +52,140 @@ int StringLength(const char* source)
     return i;
 }
 
+bool StringEqual(const char* first, const char* second)
+{
+    int i = 0;
+    while (first[i] != 0 && first[i] == second[i])
+    {
+        i++;
+    }
+
+    return first[i] == second[i];
+}
+
 //
 //  Master Settings Struct
 //
 struct SystemSettings
 {
     char SaveVersionString[17];
-    PIO pio;
+    int pioBlock;
     int stateMachine;
     uint LEDPin;
     uint pixelBufferSize;
 
+    //  One of PixelTimingProfiles
+    int timingProfile;
+
+    //  5 bit global brightness sent to clocked chips
+    int globalBrightness;
+
+    //  One of PixelFormats
+    int pixelFormat;
+
+    //  How the string is laid out for 2D effects
+    struct PixelMatrixLayout matrix;
+
+    //  What the Ticker effect scrolls, set by a TEXT stream frame
+    char tickerMessage[STREAM_TEXT_MAX_LENGTH + 1];
+
     bool ProgramRunning;
 };
 
 //
 //  Stored and Current Settings
 //
-struct SystemSettings* StoredSettings;
+const struct SystemSettings* StoredSettings;
 struct SystemSettings CurrentSettings;
 
+//  Outcome of the last commit, shown on the Commit screen
+const char* LastCommitResult = "";
+
+//
+//  The whole string as one row
+//
+void DefaultMatrixLayout(struct PixelMatrixLayout* layout, int pixelCount)
+{
+    layout->tileWidth = pixelCount;
+    layout->tileHeight = 1;
+    layout->tilesAcross = 1;
+    layout->tilesDown = 1;
+    layout->flags = 0;
+    layout->rotation = 0;
+}
+
 void CheckLoadSettings()
 {
-    bool findValidSettings = false;
+    uint16_t storedLength = 0;
+
+    //  Newest intact settings record in flash, if any
+    StoredSettings = SettingsStoreLoad(&storedLength);
+
+    //  Only trust settings saved by this version
+    bool findValidSettings = StoredSettings != NULL &&
+                             storedLength == sizeof(struct SystemSettings) &&
+                             StringEqual(StoredSettings->SaveVersionString, OSVersionString);
 
     if (findValidSettings)
     {
         //Load the settings
+        CurrentSettings = *StoredSettings;
+
+        if (CurrentSettings.timingProfile < 0 || CurrentSettings.timingProfile >= PIXEL_TIMING_PROFILES)
+        {
+            CurrentSettings.timingProfile = PIXEL_TIMING_WS2812B;
+        }
+        CurrentSettings.globalBrightness &= 0x1F;
+        if (CurrentSettings.pixelFormat < 0 || CurrentSettings.pixelFormat >= PIXEL_FORMATS)
+        {
+            CurrentSettings.pixelFormat = PixelTimingProfiles[CurrentSettings.timingProfile].pixelFormat;
+        }
+        CurrentSettings.tickerMessage[STREAM_TEXT_MAX_LENGTH] = 0;
+
+        //  Nothing is running yet, whatever was saved
+        CurrentSettings.ProgramRunning = false;
     }
     else
     {
         //Load the defaults
         StringCopy(CurrentSettings.SaveVersionString, OSVersionString);
         CurrentSettings.LEDPin = 0;
-        CurrentSettings.pio = pio0;
+        CurrentSettings.pioBlock = 0;
         CurrentSettings.stateMachine = 0;
         CurrentSettings.pixelBufferSize = NUMBER_OF_PIXELS;
+        CurrentSettings.timingProfile = PIXEL_TIMING_WS2812B;
+        CurrentSettings.globalBrightness = 31;
+        CurrentSettings.pixelFormat = PIXEL_FORMAT_GRB;
+        DefaultMatrixLayout(&CurrentSettings.matrix, CurrentSettings.pixelBufferSize);
+        StringCopy(CurrentSettings.tickerMessage, OSVersionString);
 
         CurrentSettings.ProgramRunning = false;
     }
 }
 
+//
+//  Write the current settings to flash as a new record
+//
+void CommitSettings()
+{
+    uint16_t storedLength = 0;
+
+    StringCopy(CurrentSettings.SaveVersionString, OSVersionString);
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_COMMIT << 8);
+
+    if (SettingsStoreCommit(&CurrentSettings, sizeof(struct SystemSettings)))
+    {
+        LastCommitResult = "Settings committed.";
+    }
+    else
+    {
+        LastCommitResult = "Commit FAILED, flash record did not verify.";
+    }
+
+    //  Point at the record just written
+    StoredSettings = SettingsStoreLoad(&storedLength);
+}
+
 //
 //  Serial Interface Settings Struct
 //
@@ -130,6 +233,9 @@ void InitSerialSettings()
 const int TERMINAL_WIDTH = 80;
 const int TERMINAL_HEIGHT = 24;
 
+//  Time between screen updates
+const uint64_t SERIAL_UPDATE_PERIOD_US = 100000;
+
 //
 //  Background Attributes
 //
@@ -163,6 +269,26 @@ const int MENU_SCREEN_BORDER_HEIGHT = TERMINAL_HEIGHT - MENU_SCREEN_BORDER_ROW_S
 const int MENU_SCREEN_WIDTH = TERMINAL_WIDTH - MENU_SCREEN_COLUMN_START - 1;
 const int MENU_SCREEN_HEIGHT = TERMINAL_HEIGHT - MENU_SCREEN_ROW_START - 1;
 
+//  Config screen, timing list to the right of the Pico
+const int CONFIG_TIMING_COLUMN_OFFSET = 23;
+
+//  Effects screen, the list fills columns this many rows deep so the lines under it stay on screen.  Three
+//  columns fit across, 27 effects.
+const int EFFECT_LIST_ROWS = 9;
+const int EFFECT_LIST_COLUMN_WIDTH = 22;
+
+//
+//  Status Screen Attributes
+//
+
+//  Heading and boot frame line, output health lines and frame timing table under them, the pixel monitor gets the rest
+const int STATUS_HEADING_ROWS = 2;
+const int STATUS_HEALTH_ROWS = 2;
+const int STATUS_TIMING_ROWS = PICOPIXOS_FRAME_TIMING ? 7 : 0;
+const int STATUS_MONITOR_ROW_START = MENU_SCREEN_ROW_START + STATUS_HEADING_ROWS + STATUS_HEALTH_ROWS +
+                                     STATUS_TIMING_ROWS;
+const int STATUS_MONITOR_HEIGHT = MENU_SCREEN_HEIGHT - STATUS_HEADING_ROWS - STATUS_HEALTH_ROWS - STATUS_TIMING_ROWS;
+
 
 
 
@@ -174,23 +300,135 @@ const int MENU_SCREEN_HEIGHT = TERMINAL_HEIGHT - MENU_SCREEN_ROW_START - 1;
 //
 //
 
-static inline void put_pixel(uint32_t pixel_grb)
+static inline void put_pixel(uint32_t word)
 {
-    pio_sm_put_blocking(pio0, 0, pixel_grb << 8u);
+#if PICOPIXOS_FRAME_TIMING
+    //  Only time the puts that have to wait, checking is cheap but reading the timer for every pixel isn't
+    if (HalPixelOutputFull())
+    {
+        FRAME_PROBE_START(blockedStart);
+        HalPixelPut(word);
+        FRAME_PROBE_END(FRAME_BLOCKED, blockedStart);
+        return;
+    }
+#endif
+
+    HalPixelPut(word);
 }
 
-static inline uint32_t urgb_u32(uint8_t red, uint8_t green, uint8_t blue)
+//
+//  Output Health
+//
+//  A put that finds the state machine stalled means the FIFO ran dry part way through a frame.  If the gap was
+//  long enough for the line to sit low past the reset time, the string latched what it had and the rest of the
+//  frame lands on the next one.
+//
+struct OutputHealthStruct
 {
-    return  ((uint32_t) (red) << 8)     |
-            ((uint32_t) (green) << 16)  |
-            ((uint32_t) (blue));
-}
+    uint32_t underruns;
+    uint32_t framesUnderrun;
+    uint32_t framesLatchedEarly;
+    uint32_t overflows;
+    uint32_t lastFrameUnderruns;
+};
 
-static inline void GRBtoColors(uint32_t GRBValue, uint8_t* red, uint8_t* green, uint8_t* blue)
+struct OutputHealthStruct CurrentOutputHealth;
+
+//  Wire time of a pixel and the reset low time, from the running timing profile.  No reset for clocked chips.
+uint32_t CurrentPixelTimeUs = 30;
+uint32_t CurrentResetUs = 50;
+
+//  Format the running program was started with
+int CurrentPixelFormat = PIXEL_FORMAT_GRB;
+
+//  The boot frame and the first frames after it go out while core 1 is still bringing USB up, and the line sat
+//  idle before the program started, so their stalls aren't counted
+#define OUTPUT_HEALTH_SETTLE_FRAMES 3
+int OutputHealthSettleFrames = 0;
+
+//  Pixels packed at a time, ahead of them going into the FIFO
+#define WRITE_CHUNK_PIXELS 32
+
+//
+//  Write a whole buffer out, counting underruns along the way.  FDEBUG is sticky, so it's read once a chunk rather
+//  than once a pixel, as is the timer that tells how long a stall could have been.  Underruns count the chunks
+//  that stalled.
+//
+void WritePixels(const int* pixels, int count)
 {
-    (*red) =     (GRBValue & 0x00FF00) >> 8;
-    (*green) =   (GRBValue & 0xFF0000) >> 16;
-    (*blue) =    (GRBValue & 0x0000FF);
+    int underruns = 0;
+    bool latchedEarly = false;
+    uint64_t chunkEnd = 0;
+
+    //  Format is picked once a frame, the packer's loop is specialised for it
+    PixelFormatPacker pack = PixelFormatGetPacker(CurrentPixelFormat);
+    uint32_t words[WRITE_CHUNK_PIXELS];
+
+    for (int start = 0; start < count; start += WRITE_CHUNK_PIXELS)
+    {
+        int length = count - start < WRITE_CHUNK_PIXELS ? count - start : WRITE_CHUNK_PIXELS;
+        int first = 0;
+
+        pack(pixels + start, words, length);
+
+        //  Line was idle before the first pixel, that's the gap between frames, so its stall is thrown away
+        if (start == 0)
+        {
+            put_pixel(words[0]);
+            if (HalPixelOutputTakeFlags() & HAL_PIXEL_OVERFLOWED)
+            {
+                CurrentOutputHealth.overflows++;
+            }
+            chunkEnd = HalTimeUs();
+            first = 1;
+        }
+
+        for (int i = first; i < length; i++)
+        {
+            put_pixel(words[i]);
+        }
+
+        uint32_t flags = HalPixelOutputTakeFlags();
+        if (flags & HAL_PIXEL_OVERFLOWED)
+        {
+            CurrentOutputHealth.overflows++;
+        }
+
+        if (flags & HAL_PIXEL_STALLED)
+        {
+            underruns++;
+
+            //  The last chunk boundary left at most a full FIFO and the shift register to go out, this chunk
+            //  adds its own pixels.  Idle past that by the reset time and the string latched.  Clocked chips just
+            //  wait for the clock to start again.
+            if (CurrentResetUs > 0 &&
+                HalTimeUs() - chunkEnd > (HAL_PIXEL_FIFO_DEPTH + 1 + length) * CurrentPixelTimeUs + CurrentResetUs)
+            {
+                latchedEarly = true;
+            }
+        }
+        chunkEnd = HalTimeUs();
+    }
+    HalPixelFrameEnd();
+
+    if (OutputHealthSettleFrames > 0)
+    {
+        OutputHealthSettleFrames--;
+        underruns = 0;
+        latchedEarly = false;
+    }
+
+    CurrentOutputHealth.lastFrameUnderruns = underruns;
+    if (underruns > 0)
+    {
+        CurrentOutputHealth.underruns += underruns;
+        CurrentOutputHealth.framesUnderrun++;
+        TraceRecord(TRACE_UNDERRUN, underruns > 0xFFFF ? 0xFFFF : underruns);
+    }
+    if (latchedEarly)
+    {
+        CurrentOutputHealth.framesLatchedEarly++;
+    }
 }
 
 struct PixelBufferStruct
@@ -202,15 +440,102 @@ struct PixelBufferStruct
 //  Pointer the pixel buffer
 struct PixelBufferStruct CurrentPixelBuffer;
 
+//  Buffer that incoming frames get built in before being presented
+struct PixelBufferStruct BackPixelBuffer;
+
+//  Set by core 1 when the back buffer holds a finished frame, cleared by core 0 once it swaps
+volatile bool FramePresentPending = false;
+
+//  Set by core 1 when a TEXT frame has changed the ticker message, cleared by core 0 once it's laid out
+volatile bool TickerMessagePending = false;
+
 //  Effects
 enum Effects
 {
-    RANDOM = 0
+    RANDOM = 0,
+    STREAM = 1,
+    PLAYBACK = 2,
+    SHOW = 3,
+    IMAGE = 4,
+
+    //  2D effects from here on
+    MATRIX_TEST = 5,
+    LAVA = 6,
+    CLOUDS = 7,
+    WATER = 8,
+    FIREWORKS = 9,
+    COMETS = 10,
+    RAIN = 11,
+    FIRE = 12,
+    LIFE = 13,
+    RULES = 14,
+    TICKER = 15,
+    SPECTRUM = 16
 };
 
+const int NUMBER_OF_EFFECTS = 17;
+
+const char* EffectNames[17] = {"Random", "Stream", "Flash Playback", "Keyframe Show", "Flash Image", "Matrix Test",
+                               "Lava", "Clouds", "Water", "Fireworks", "Comets", "Rain", "Fire", "Life", "Rules",
+                               "Ticker", "Spectrum"};
+
+//  Renderers for the 2D effects, in Effects order from MATRIX_TEST
+typedef void (*MatrixEffectRenderer)(int* canvas, int width, int height, uint32_t timeMs);
+const MatrixEffectRenderer MatrixEffectRenderers[12] =
+        {
+                EffectMatrixTest, EffectLava, EffectClouds, EffectWater, EffectFireworks, EffectComets, EffectRain,
+                EffectFire, EffectLife, EffectRules, EffectTicker, EffectSpectrum
+        };
+
 //  Current Effect Mode
 int currentEffect = RANDOM;
 
+//  Pre-rendered animation in flash, played by core 0
+struct AnimationPlayerStruct CurrentAnimation;
+bool AnimationAvailable = false;
+
+//  Flash playback sends frames as they were packed, so only on a string running that pixel format
+bool AnimationPlayable()
+{
+    return AnimationAvailable && CurrentAnimation.header->pixelFormat == (uint32_t) CurrentSettings.pixelFormat;
+}
+
+//  Keyframe show in the same flash slot, interpolated by core 0 at the output rate
+struct ShowStruct CurrentShow;
+bool ShowAvailable = false;
+const uint32_t SHOW_FRAME_INTERVAL_US = 1000000 / 60;
+
+//  Indexed colour image in the same flash slot, decoded by core 0 through the matrix as each frame comes due
+struct ImageStruct CurrentImage;
+bool ImageAvailable = false;
+struct ImageDecoderStruct ImageDecoder;
+uint64_t ImageFrameDueUs = 0;
+
+//  Audio input, sampled by DMA and analysed on core 1 between console updates, published for the effects
+#if HAL_AUDIO_BLOCK_SAMPLES != AUDIO_BLOCK_SAMPLES
+#error "The HAL's audio blocks have to be the analyser's FFT size"
+#endif
+const uint AUDIO_INPUT_PIN = 26;
+struct AudioAnalyserStruct AudioAnalyser;
+bool AudioInputRunning = false;
+uint32_t AudioBlocksTaken = 0;
+uint32_t AudioOverruns = 0;
+
+//  Time to analyse a block in us, the average in 16ths
+uint32_t AudioBlockLastUs = 0;
+uint32_t AudioBlockAverageUs16 = 0;
+uint32_t AudioBlockMaxUs = 0;
+
+//  Layout 2D effects draw through, and the canvas they draw into
+struct PixelMatrixStruct CurrentMatrix;
+int* MatrixCanvas = NULL;
+
+//  Effects that render against the effect clock, at the show's frame rate
+bool EffectIsAnimated(int effect)
+{
+    return effect == SHOW || effect == IMAGE || effect >= MATRIX_TEST;
+}
+
 //  Status Flags
 bool PauseEffect = false;
 
@@ -218,6 +543,10 @@ bool PauseEffect = false;
 int CurrentBrightnessMask = 0x07;
 int CurrentBrightLevel = 5;
 
+//  Time from reset until the first frame was out, and how much of it came from the stored boot frame
+uint64_t BootToFirstFrameUs = 0;
+int BootFramePixelsRestored = 0;
+
 
 //
 //
@@ -225,28 +554,110 @@ int CurrentBrightLevel = 5;
 //
 //
 
-void StartPIOPixelProgram ()
-{
-    //  Get the GPIO ready on the target pin
-    gpio_init(CurrentSettings.LEDPin);
-
-    //  Make the GPIO an output
-    gpio_set_dir(CurrentSettings.LEDPin, GPIO_OUT);
+//  Set from core 1 when the timing profile changes, core 0 restarts the program between frames
+volatile bool PixelProgramRestartPending = false;
 
-    //  Get the program offset that we load up into the pio
-    uint offset = pio_add_program(CurrentSettings.pio, &ws2812_program);
+//  Set from core 1 by the 'S' key, core 0 starts or stops the program between frames
+volatile bool PixelProgramTogglePending = false;
 
-    // Fire off the state machine for the ws2812 program
-    ws2812_program_init(CurrentSettings.pio, CurrentSettings.stateMachine, offset, CurrentSettings.LEDPin, 800000, false);
+void StartPIOPixelProgram ()
+{
+    const struct PixelTimingProfile* profile = &PixelTimingProfiles[CurrentSettings.timingProfile];
+
+    //  Fire off the state machine for the profile's program on the target pin
+    HalPixelOutputBrightness(CurrentSettings.globalBrightness);
+    HalPixelOutputFormat(CurrentSettings.pixelFormat);
+    CurrentPixelFormat = CurrentSettings.pixelFormat;
+    HalPixelOutputStart(CurrentSettings.pioBlock, CurrentSettings.stateMachine, CurrentSettings.LEDPin, profile);
+    int bits = profile->protocol == PIXEL_PROTOCOL_APA102 ? 24 : PixelFormatBits(CurrentPixelFormat);
+    CurrentPixelTimeUs = (PixelTimingPixelNs(profile, bits) + 999) / 1000;
+    CurrentResetUs = profile->resetUs;
+    OutputHealthSettleFrames = OUTPUT_HEALTH_SETTLE_FRAMES;
 
     //  Flag that the program is running
     CurrentSettings.ProgramRunning = true;
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_OUTPUT << 8 | 1);
 }
 
 void StopPIOPixelProgram ()
 {
-    pio_sm_set_enabled(CurrentSettings.pio, CurrentSettings.stateMachine, false);
+    HalPixelOutputStop();
     CurrentSettings.ProgramRunning = false;
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_OUTPUT << 8 | 0);
+}
+
+//
+//  Step through the timing profiles, the program picks it up on its next restart
+//
+void SelectTimingProfile(int direction)
+{
+    CurrentSettings.timingProfile = (CurrentSettings.timingProfile + PIXEL_TIMING_PROFILES + direction) % PIXEL_TIMING_PROFILES;
+    CurrentSettings.pixelFormat = PixelTimingProfiles[CurrentSettings.timingProfile].pixelFormat;
+    PixelProgramRestartPending = true;
+}
+
+//
+//  Step through the pixel formats, clocked chips don't take the 32 bit ones
+//
+void SelectPixelFormat(int direction)
+{
+    bool clocked = PixelTimingProfiles[CurrentSettings.timingProfile].protocol == PIXEL_PROTOCOL_APA102;
+    int format = CurrentSettings.pixelFormat;
+
+    do
+    {
+        format = (format + PIXEL_FORMATS + direction) % PIXEL_FORMATS;
+    }
+    while (clocked && PixelFormatBits(format) != 24);
+
+    CurrentSettings.pixelFormat = format;
+    PixelProgramRestartPending = true;
+}
+
+//
+//  Global brightness of clocked chips, straight into the running program
+//
+void StepGlobalBrightness(int direction)
+{
+    int level = CurrentSettings.globalBrightness + direction;
+
+    CurrentSettings.globalBrightness = level < 0 ? 0 : level > 31 ? 31 : level;
+    HalPixelOutputBrightness(CurrentSettings.globalBrightness);
+}
+
+//
+//  First light, the stored boot frame or all off, pushed out as soon as the PIO is running
+//
+void ShowBootFrame()
+{
+    for (int i = 0; i < CurrentPixelBuffer.size; i++)
+    {
+        CurrentPixelBuffer.data[i] = 0;
+    }
+
+    BootFramePixelsRestored = BootFrameLoad(CurrentPixelBuffer.data, CurrentPixelBuffer.size);
+
+    WritePixels(CurrentPixelBuffer.data, CurrentPixelBuffer.size);
+
+    //  Timer starts counting at reset
+    BootToFirstFrameUs = HalTimeUs();
+}
+
+//
+//  Save what's on the string now as the boot frame
+//
+void SaveBootFrame()
+{
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_BOOT_FRAME << 8);
+
+    if (BootFrameSave(CurrentPixelBuffer.data, CurrentPixelBuffer.size))
+    {
+        LastCommitResult = "Boot frame saved.";
+    }
+    else
+    {
+        LastCommitResult = "Boot frame save FAILED, flash did not verify.";
+    }
 }
 
 
@@ -299,67 +710,67 @@ const struct RGBValues BorderInactiveBackground = {16,16,32};
 //
 //
 
-void inline SetForegroundColor(char red, char green, char blue)
+static inline void SetForegroundColor(uint8_t red, uint8_t green, uint8_t blue)
 {
     printf("\x1b[38;2;%u;%u;%um", red, green, blue);
 }
 
-void inline SetForegroundValues (struct RGBValues color)
+static inline void SetForegroundValues (struct RGBValues color)
 {
     SetForegroundColor(color.red, color.green, color.blue);
 }
 
-void inline SetBackgroundColor(char red, char green, char blue)
+static inline void SetBackgroundColor(uint8_t red, uint8_t green, uint8_t blue)
 {
     printf("\x1b[48;2;%u;%u;%um", red, green, blue);
 }
 
-void inline SetBackgroundValues(struct RGBValues color)
+static inline void SetBackgroundValues(struct RGBValues color)
 {
     SetBackgroundColor(color.red, color.green, color.blue);
 }
 
-void inline SetCursorPosition(unsigned int row, unsigned int column)
+static inline void SetCursorPosition(unsigned int row, unsigned int column)
 {
     printf("\x1b[%u;%uH", row, column);
 }
 
-void inline TurnCursorOff()
+static inline void TurnCursorOff()
 {
     printf("\x1b[?25l");
 }
 
-void inline TurnCursorOn()
+static inline void TurnCursorOn()
 {
     printf("\x1b[?25h");
 }
 
-void inline MoveCursorUp(unsigned int spaces)
+static inline void MoveCursorUp(unsigned int spaces)
 {
     printf("\x1b[%uA", spaces);
 }
 
-void inline MoveCursorDown(unsigned int spaces)
+static inline void MoveCursorDown(unsigned int spaces)
 {
     printf("\x1b[%uB", spaces);
 }
 
-void inline MoveCursorForward(unsigned int spaces)
+static inline void MoveCursorForward(unsigned int spaces)
 {
     printf("\x1b[%uC", spaces);
 }
 
-void inline MoveCursorBack(unsigned int spaces)
+static inline void MoveCursorBack(unsigned int spaces)
 {
     printf("\x1b[%uD", spaces);
 }
 
-void inline ClearScreen()
+static inline void ClearScreen()
 {
     printf("\x1b[2J");
 }
 
-void inline ResetDisplayAttributes()
+static inline void ResetDisplayAttributes()
 {
     printf("\x1b[0m");
 }
@@ -370,7 +781,7 @@ void inline ResetDisplayAttributes()
 //
 //
 
-void inline DrawRow     (unsigned int row, unsigned int column, unsigned int width)
+static inline void DrawRow     (unsigned int row, unsigned int column, unsigned int width)
 {
     SetCursorPosition(row, column);
     for (int i = 0; i < width; i++)
@@ -379,7 +790,7 @@ void inline DrawRow     (unsigned int row, unsigned int column, unsigned int wid
     }
 }
 
-void inline DrawColumn  (unsigned int row, unsigned int column, unsigned int height)
+static inline void DrawColumn  (unsigned int row, unsigned int column, unsigned int height)
 {
     SetCursorPosition(row, column);
     for (int i = 0; i < height; i++)
@@ -389,7 +800,7 @@ void inline DrawColumn  (unsigned int row, unsigned int column, unsigned int hei
     }
 }
 
-void inline DrawBox     (unsigned int row, unsigned int column, unsigned int width, unsigned int height)
+static inline void DrawBox     (unsigned int row, unsigned int column, unsigned int width, unsigned int height)
 {
     DrawRow(row, column+1, width-2);
     DrawRow(row+height-1, column+1, width-2);
@@ -410,7 +821,7 @@ void inline DrawBox     (unsigned int row, unsigned int column, unsigned int wid
 
 }
 
-void inline DrawFill    (unsigned int row, unsigned int column, unsigned int width, unsigned int height)
+static inline void DrawFill    (unsigned int row, unsigned int column, unsigned int width, unsigned int height)
 {
     //  Allocate a buffer
     char* tempBuffer = malloc(sizeof(char)*width + 1);
@@ -434,7 +845,7 @@ void inline DrawFill    (unsigned int row, unsigned int column, unsigned int wid
     free(tempBuffer);
 }
 
-void inline DrawButton  (unsigned int row, unsigned int column, unsigned int width, unsigned int height, const char* text, bool select,
+static inline void DrawButton  (unsigned int row, unsigned int column, unsigned int width, unsigned int height, const char* text, bool select,
                          char redFore, char greenFore, char blueFore,
                          char redBack, char greenBack, char blueBack)
 {
@@ -475,49 +886,93 @@ void inline DrawButton  (unsigned int row, unsigned int column, unsigned int wid
 //
 //
 
-void PrintPixelBufferStatus (int row, int column, int width, int height, int startIndex)
+//
+//  Pixel Monitor, on the Status screen (see pixel_monitor.h)
+//
+struct PixelMonitorSettings CurrentMonitor;
+
+void InitPixelMonitor()
 {
-    //  Temp Variables for color data
-    uint8_t red;
-    uint8_t green;
-    uint8_t blue;
+    PixelMonitorInit(&CurrentMonitor);
+}
+
+void InvalidatePixelMonitor()
+{
+    CurrentMonitor.invalidate = true;
+}
 
-    //  Variables to figure out how to arrange the pixel data within given height and width.
-    //  Given the number of pixels in the buffer and the given width, how many rows are we going to have?
-    int dataRows = 1 + (CurrentSettings.pixelBufferSize * 2) / width;
+//
+//  Pixels covered by a single half cell at the current zoom level
+//
+int PixelMonitorSpan(int halfCells)
+{
+    return PixelMonitorSpanFor(&CurrentMonitor, CurrentSettings.pixelBufferSize, halfCells);
+}
 
-    //  If dataRows is larger than height, default to height
-    if (dataRows > height)
+void PixelMonitorZoom(int direction)
+{
+    if (direction > 0)
+    {
+        //  No point zooming in past one pixel per half cell
+        if (PixelMonitorSpan(MENU_SCREEN_WIDTH * (STATUS_MONITOR_HEIGHT - 1) * 2) > 1)
+        {
+            CurrentMonitor.zoomLevel++;
+        }
+    }
+    else if (CurrentMonitor.zoomLevel > 0)
     {
-        dataRows = height;
+        CurrentMonitor.zoomLevel--;
     }
 
-    //  Set the current row offset
-    int currentRow = 0;
-
-    //  For each row
-    while (currentRow < dataRows)
+    //  Keep the page aligned with what the new zoom level can show
+    if (CurrentMonitor.zoomLevel == 0)
     {
-        //  Move cursor into position
-        SetCursorPosition(row + currentRow, column);
+        CurrentMonitor.pageOffset = 0;
+    }
 
-        //  Print out all the columns
-        for (int i = 0; i < (width / 2) && i < CurrentSettings.pixelBufferSize; i++)
-        {
-            GRBtoColors(CurrentPixelBuffer.data[(startIndex + i + (currentRow * width)) % CurrentSettings.pixelBufferSize], &red, &green, &blue);
-            SetForegroundColor((red << CurrentBrightLevel) ^ 0xFF, (green << CurrentBrightLevel) ^ 0xFF, (blue << CurrentBrightLevel) ^ 0xFF);
-            SetBackgroundColor(red << CurrentBrightLevel , green << CurrentBrightLevel, blue << CurrentBrightLevel);
-            printf("%02i",i);
-        }
+    CurrentMonitor.invalidate = true;
+}
 
-        //  Move to the next row
-        currentRow++;
+void PixelMonitorPage(int direction)
+{
+    int halfCells = MENU_SCREEN_WIDTH * (STATUS_MONITOR_HEIGHT - 1) * 2;
+    int pageSize = PixelMonitorSpan(halfCells) * halfCells;
+
+    CurrentMonitor.pageOffset += direction * pageSize;
+
+    //  Clamp to the buffer
+    if (CurrentMonitor.pageOffset < 0 || CurrentSettings.pixelBufferSize == 0)
+    {
+        CurrentMonitor.pageOffset = 0;
     }
+    else if (CurrentMonitor.pageOffset >= CurrentSettings.pixelBufferSize)
+    {
+        CurrentMonitor.pageOffset = ((CurrentSettings.pixelBufferSize - 1) / pageSize) * pageSize;
+    }
+
+    CurrentMonitor.invalidate = true;
+}
+
+void PixelMonitorCycleSampleMode()
+{
+    CurrentMonitor.sampleMode = (CurrentMonitor.sampleMode + 1) % 3;
+    CurrentMonitor.invalidate = true;
+}
+
+void PrintPixelBufferStatus (int row, int column, int width, int height)
+{
+    //  Kept off the stack, core 1 doesn't have much
+    static char buffer[PIXEL_MONITOR_BYTE_BUDGET];
+
+    int length = BuildPixelMonitorFrame(&CurrentMonitor, CurrentPixelBuffer.data, CurrentPixelBuffer.size, CurrentBrightLevel,
+                                        buffer, PIXEL_MONITOR_BYTE_BUDGET, row, column, width, height);
+
+    fwrite(buffer, 1, length, stdout);
 }
 
 void DrawMainLogo(int row, int column, int colorRotateIndex)
 {
-    char logoString[17] = "Pico Pix OS V1.0";
+    const char* logoString = OSVersionString;
 
     //Move the cursor to position
     SetCursorPosition(row, column);
@@ -553,6 +1008,22 @@ void ClearMenuScreenArea()
     }
 }
 
+//
+//  One line of the screen area at the cursor, cut off at the border and padded out to it so nothing a longer line
+//  left there shows through
+//
+void PrintScreenLine(const char* format, ...)
+{
+    char line[MENU_SCREEN_WIDTH + 1];
+    va_list arguments;
+
+    va_start(arguments, format);
+    vsnprintf(line, sizeof(line), format, arguments);
+    va_end(arguments);
+
+    printf("%-*s", MENU_SCREEN_WIDTH, line);
+}
+
 void DrawBackground()
 {
     //Draw Outer Border Box
@@ -1283,9 +1754,75 @@ void DrawConfigScreen()
     //  Draw Pico Chip
     DrawPicoLayout(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
 
+    //  Timing profiles beside the chip, current one highlighted
+    struct RGBValues SelectionBackground = {32,192,32};
+    struct RGBValues SelectionForeground = {255,255,255};
+    struct RGBValues DefaultForeground = {192,192,192};
+    struct RGBValues DefaultBackground = {0,0,0};
+
+    int column = MENU_SCREEN_COLUMN_START + CONFIG_TIMING_COLUMN_OFFSET;
+
+    SetForegroundValues(DefaultForeground);
+    SetBackgroundValues(DefaultBackground);
+    SetCursorPosition(MENU_SCREEN_ROW_START, column);
+    printf(" Timing        Rate  Split Pixel");
+
+    for (int i = 0; i < PIXEL_TIMING_PROFILES; i++)
+    {
+        const struct PixelTimingProfile* profile = &PixelTimingProfiles[i];
+
+        SetCursorPosition(MENU_SCREEN_ROW_START + 2 + i, column);
+
+        if (i == CurrentSettings.timingProfile)
+        {
+            SetForegroundValues(SelectionForeground);
+            SetBackgroundValues(SelectionBackground);
+        }
+        else
+        {
+            SetForegroundValues(DefaultForeground);
+            SetBackgroundValues(DefaultBackground);
+        }
+
+        if (profile->protocol == PIXEL_PROTOCOL_APA102)
+        {
+            printf(" %-12s %4luM  clock %5.2f us ", profile->name, (unsigned long) (profile->bitHz / 1000000),
+                   PixelTimingPixelNs(profile, 24) / 1000.0);
+        }
+        else
+        {
+            printf(" %-12s %4luk  %u/%u/%u %5.2f us ", profile->name, (unsigned long) (profile->bitHz / 1000),
+                   profile->t1, profile->t2, profile->t3, PixelTimingPixelNs(profile, 24) / 1000.0);
+        }
+    }
+
+    SetForegroundValues(DefaultForeground);
+    SetBackgroundValues(DefaultBackground);
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 3 + PIXEL_TIMING_PROFILES, column);
+    printf("Up/Down - Choose timing.");
+
+    const struct PixelTimingProfile* current = &PixelTimingProfiles[CurrentSettings.timingProfile];
 
+    SetCursorPosition(MENU_SCREEN_ROW_START + 4 + PIXEL_TIMING_PROFILES, column);
+    if (current->protocol == PIXEL_PROTOCOL_APA102)
+    {
+        printf("Data GP%02u, clock GP%02u      ", CurrentSettings.LEDPin, CurrentSettings.LEDPin + 1);
+    }
+    else
+    {
+        printf("Reset low %3lu us            ", (unsigned long) current->resetUs);
+    }
 
+    SetCursorPosition(MENU_SCREEN_ROW_START + 6 + PIXEL_TIMING_PROFILES, column);
+    printf("Global brightness %2d/31", CurrentSettings.globalBrightness);
+    SetCursorPosition(MENU_SCREEN_ROW_START + 7 + PIXEL_TIMING_PROFILES, column);
+    printf("Left/Right - Clocked LEDs only.");
 
+    SetCursorPosition(MENU_SCREEN_ROW_START + 9 + PIXEL_TIMING_PROFILES, column);
+    printf("Pixel format %-4s", PixelFormatNames[CurrentSettings.pixelFormat]);
+    SetCursorPosition(MENU_SCREEN_ROW_START + 10 + PIXEL_TIMING_PROFILES, column);
+    printf("F - Next format, RGBW sends white.");
 
     //  Pin to use config option
 
@@ -1299,43 +1836,304 @@ void DrawConfigScreen()
 //
 void DrawEffectScreen()
 {
-    // Locate to the right corner of the screen
-    SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
+    struct RGBValues SelectionBackground = {32,192,32};
+    struct RGBValues SelectionForeground = {255,255,255};
+    struct RGBValues DefaultForeground = {192,192,192};
+    struct RGBValues DefaultBackground = {0,0,0};
 
-    //  Write Stuff
-    printf("Temporary Effect Screen Text!");
-}
+    SetForegroundValues(DefaultForeground);
+    SetBackgroundValues(DefaultBackground);
 
-//
-//  Draw Inputs Screen
-//
-void DrawInputsScreen()
-{
     // Locate to the right corner of the screen
     SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
 
     //  Write Stuff
-    printf("Temporary Inputs Screen Text!");
-}
+    printf("Effects");
 
-//
-//  Draw Status Screen
-//
-void DrawStatusScreen()
-{
-    // Locate to the right corner of the screen
-    SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
+    //  List the effects down then across, current one highlighted
+    for (int i = 0; i < NUMBER_OF_EFFECTS; i++)
+    {
+        SetCursorPosition(MENU_SCREEN_ROW_START + 2 + i % EFFECT_LIST_ROWS,
+                          MENU_SCREEN_COLUMN_START + i / EFFECT_LIST_ROWS * EFFECT_LIST_COLUMN_WIDTH);
 
-    //  Write Stuff
-    printf("Pixel Buffer Status");
-}
+        if (i == currentEffect)
+        {
+            SetForegroundValues(SelectionForeground);
+            SetBackgroundValues(SelectionBackground);
+        }
+        else
+        {
+            SetForegroundValues(DefaultForeground);
+            SetBackgroundValues(DefaultBackground);
+        }
+
+        printf(" %-*s ", EFFECT_LIST_COLUMN_WIDTH - 2, EffectNames[i]);
+    }
+
+    SetForegroundValues(DefaultForeground);
+    SetBackgroundValues(DefaultBackground);
+
+    int row = MENU_SCREEN_ROW_START + 3 + EFFECT_LIST_ROWS;
+
+    SetCursorPosition(row, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("Up/Down - Choose effect. Stream starts when frames arrive.");
+
+    //  Flash animation details
+    SetCursorPosition(row + 2, MENU_SCREEN_COLUMN_START);
+    if (AnimationAvailable)
+    {
+        PrintScreenLine("Flash animation: %lu frames of %lu %s pixels, %lu us/frame",
+                        (unsigned long) CurrentAnimation.header->frameCount,
+                        (unsigned long) CurrentAnimation.header->pixelCount,
+                        PixelFormatNames[CurrentAnimation.header->pixelFormat],
+                        (unsigned long) CurrentAnimation.header->frameIntervalUs);
+
+        SetCursorPosition(row + 3, MENU_SCREEN_COLUMN_START);
+        if (AnimationPlayable())
+        {
+            PrintScreenLine("Played %lu, late %lu", (unsigned long) CurrentAnimation.framesPlayed,
+                            (unsigned long) CurrentAnimation.framesLate);
+        }
+        else
+        {
+            PrintScreenLine("Won't play, the string is set to %s", PixelFormatNames[CurrentSettings.pixelFormat]);
+        }
+    }
+    else if (ShowAvailable)
+    {
+        PrintScreenLine("Keyframe show: %u pixels, %u tracks, %lu keys, %lu ms loop",
+                        CurrentShow.header->pixelCount, CurrentShow.header->trackCount,
+                        (unsigned long) CurrentShow.header->keyCount, (unsigned long) CurrentShow.header->durationMs);
+    }
+    else if (ImageAvailable)
+    {
+        PrintScreenLine("Flash image: %u x %u, %u frames, %u colours", CurrentImage.header->width,
+                        CurrentImage.header->height, CurrentImage.header->frameCount,
+                        CurrentImage.header->paletteSize);
+    }
+    else
+    {
+        PrintScreenLine("Flash animation: none loaded at offset 0x%06X", ANIMATION_FLASH_OFFSET);
+    }
+
+    //  What the 2D effects draw on
+    const struct PixelMatrixLayout* layout = &CurrentMatrix.layout;
+    SetCursorPosition(row + 5, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("Matrix %d x %d: %d x %d tiles of %d x %d, %s%s, turned %d", CurrentMatrix.width,
+                    CurrentMatrix.height, layout->tilesAcross, layout->tilesDown, layout->tileWidth,
+                    layout->tileHeight, layout->flags & PIXEL_MATRIX_COLUMNS ? "columns" : "rows",
+                    layout->flags & PIXEL_MATRIX_SERPENTINE ? " serpentine" : "", layout->rotation * 90);
+}
+
+//
+//  Step the current effect, stream mode is left to the data port
+//
+void SelectEffect(int direction)
+{
+    if (currentEffect == STREAM)
+    {
+        return;
+    }
+
+    int effect = currentEffect;
+
+    //  Skip over anything there's nothing in flash for
+    do
+    {
+        effect = (effect + NUMBER_OF_EFFECTS + direction) % NUMBER_OF_EFFECTS;
+    }
+    while (effect == STREAM || (effect == PLAYBACK && !AnimationPlayable()) || (effect == SHOW && !ShowAvailable) ||
+           (effect == IMAGE && !ImageAvailable) || (effect >= IMAGE && CurrentMatrix.table == NULL));
+
+    currentEffect = effect;
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_EFFECT << 8 | effect);
+}
+
+//
+//  Draw Inputs Screen
+//
+void DrawInputsScreen()
+{
+    SetForegroundColor(255,255,255);
+    SetBackgroundColor(0,0,0);
+
+    // Locate to the right corner of the screen
+    SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
+
+    //  Write Stuff
+    PrintScreenLine("Audio Input   ADC pin %u, %i Hz", AUDIO_INPUT_PIN, AUDIO_SAMPLE_RATE);
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 1, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("%i sample blocks every %lu us, %i bands", AUDIO_BLOCK_SAMPLES,
+                    (unsigned long) ((uint64_t) AUDIO_BLOCK_SAMPLES * 1000000 / AUDIO_SAMPLE_RATE), AUDIO_BANDS);
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + AUDIO_BANDS + 7, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("Spectrum draws these bands, effects read them with AudioRead");
+}
+
+//
+//  Draw Inputs Screen Active, the levels as last published and what analysing them costs
+//
+void DrawInputsScreenActive()
+{
+    const char* bars[9] = {" ", "▏", "▎", "▍", "▌", "▋", "▊", "▉", "█"};
+    const int barWidth = 48;
+    struct AudioLevels levels;
+    int row = MENU_SCREEN_ROW_START + 2;
+
+    SetForegroundColor(192,192,192);
+    SetBackgroundColor(0,0,0);
+
+    if (!AudioInputRunning)
+    {
+        SetCursorPosition(row, MENU_SCREEN_COLUMN_START);
+        PrintScreenLine("No audio input, no ADC or DMA (no PICOPIXOS_AUDIO on the host)");
+        return;
+    }
+
+    AudioRead(&levels);
+
+    for (int band = 0; band < AUDIO_BANDS; band++)
+    {
+        int eighths = levels.bands[band] * barWidth * 8 / 255;
+
+        SetCursorPosition(row + band, MENU_SCREEN_COLUMN_START);
+        printf("%5i Hz %3i ", AudioBandEdges[band] * AUDIO_SAMPLE_RATE / AUDIO_BLOCK_SAMPLES, levels.bands[band]);
+        for (int i = 0; i < barWidth; i++)
+        {
+            int cell = eighths - i * 8;
+            printf("%s", bars[cell < 0 ? 0 : cell > 8 ? 8 : cell]);
+        }
+    }
+
+    uint32_t blockUs = (uint32_t) ((uint64_t) AUDIO_BLOCK_SAMPLES * 1000000 / AUDIO_SAMPLE_RATE);
+    uint32_t averageUs = AudioBlockAverageUs16 / 16;
+
+    SetCursorPosition(row + AUDIO_BANDS + 1, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("Level %3i  Beats %lu  Blocks %lu  Overruns %lu", levels.level, (unsigned long) levels.beats,
+                    (unsigned long) levels.blocks, (unsigned long) AudioOverruns);
+
+    SetCursorPosition(row + AUDIO_BANDS + 2, MENU_SCREEN_COLUMN_START);
+    PrintScreenLine("Analysis us  last %lu  avg %lu  max %lu  (%lu%% of a block)", (unsigned long) AudioBlockLastUs,
+                    (unsigned long) averageUs, (unsigned long) AudioBlockMaxUs,
+                    (unsigned long) (averageUs * 100 / blockUs));
+}
+
+#if PICOPIXOS_FRAME_TIMING
+//
+//  Frame timing table and busy time histogram, redrawn in place every refresh
+//
+void PrintFrameTiming(int row, int column)
+{
+    const char* names[FRAME_METRICS] = {"Render", "Output", "Blocked", "Slack", "Period"};
+    const char* bars[9] = {" ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+    struct FrameTimingSummary summary;
+
+    SetForegroundColor(192,192,192);
+    SetBackgroundColor(0,0,0);
+
+    SetCursorPosition(row, column);
+    printf("Frame time (us)     min      avg      max   last %i frames", FRAME_TIMING_WINDOW);
+
+    for (int metric = 0; metric < FRAME_METRICS; metric++)
+    {
+        SetCursorPosition(row + 1 + metric, column);
+        int printed;
+
+        if (FrameTimingSummarize(metric, &summary))
+        {
+            printed = printf("  %-10s %8lu %8lu %8lu", names[metric], (unsigned long) summary.min,
+                             (unsigned long) summary.average, (unsigned long) summary.max);
+
+            //  Rate goes on the period line
+            if (metric == FRAME_PERIOD && summary.average > 0)
+            {
+                printed += printf("   %5.1f fps", 1000000.0 / summary.average);
+            }
+        }
+        else
+        {
+            printed = printf("  %-10s %8s %8s %8s", names[metric], "-", "-", "-");
+        }
+
+        //  Clear whatever a longer line left, short of the border
+        if (printed < MENU_SCREEN_WIDTH)
+        {
+            printf("%*s", MENU_SCREEN_WIDTH - printed, "");
+        }
+    }
+
+    //  Busy (render + output) histogram, scaled to the fullest bucket
+    uint32_t buckets[FRAME_TIMING_BUCKETS];
+    uint32_t fullest = 1;
+
+    FrameTimingHistogram(buckets);
+    for (int i = 0; i < FRAME_TIMING_BUCKETS; i++)
+    {
+        if (buckets[i] > fullest) fullest = buckets[i];
+    }
+
+    SetCursorPosition(row + 1 + FRAME_METRICS, column);
+    printf("  Busy      <%ius ", FRAME_TIMING_FIRST_BUCKET_US);
+    for (int i = 0; i < FRAME_TIMING_BUCKETS; i++)
+    {
+        printf("%s", bars[(buckets[i] * 8 + fullest - 1) / fullest]);
+    }
+    printf(" >%ims", (FRAME_TIMING_FIRST_BUCKET_US << (FRAME_TIMING_BUCKETS - 2)) / 1000);
+}
+#endif
+
+//
+//  Draw Status Screen
+//
+void DrawStatusScreen()
+{
+    // Locate to the right corner of the screen
+    SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
+
+    //  Write Stuff
+    printf("Pixel Buffer Status");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 1, MENU_SCREEN_COLUMN_START);
+    printf("Boot to first frame %lu us, %i pixels restored", (unsigned long) BootToFirstFrameUs,
+           BootFramePixelsRestored);
+
+    //  Screen area was cleared, so the monitor has to resend everything
+    InvalidatePixelMonitor();
+}
+
+//
+//  Underrun counters, and flash playback frames that were still going out when the next was due
+//
+void PrintOutputHealth(int row, int column)
+{
+    struct OutputHealthStruct health = CurrentOutputHealth;
+
+    SetForegroundColor(192,192,192);
+    SetBackgroundColor(0,0,0);
+
+    SetCursorPosition(row, column);
+    PrintScreenLine("Underruns %lu in %lu frames  Last frame %lu  Early latch %lu", (unsigned long) health.underruns,
+                    (unsigned long) health.framesUnderrun, (unsigned long) health.lastFrameUnderruns,
+                    (unsigned long) health.framesLatchedEarly);
+
+    SetCursorPosition(row + 1, column);
+    PrintScreenLine("TXOVER %lu  DMA late %lu", (unsigned long) health.overflows,
+                    (unsigned long) CurrentAnimation.framesLate);
+}
 
 //
 //  Draw Status Screen Active Monitor
 //
 void DrawStatusScreenActive()
 {
-    PrintPixelBufferStatus(MENU_SCREEN_ROW_START + 1, MENU_SCREEN_COLUMN_START, MENU_SCREEN_WIDTH, MENU_SCREEN_HEIGHT, 0);
+    PrintOutputHealth(MENU_SCREEN_ROW_START + STATUS_HEADING_ROWS, MENU_SCREEN_COLUMN_START);
+
+#if PICOPIXOS_FRAME_TIMING
+    PrintFrameTiming(MENU_SCREEN_ROW_START + STATUS_HEADING_ROWS + STATUS_HEALTH_ROWS, MENU_SCREEN_COLUMN_START);
+#endif
+
+    PrintPixelBufferStatus(STATUS_MONITOR_ROW_START, MENU_SCREEN_COLUMN_START, MENU_SCREEN_WIDTH, STATUS_MONITOR_HEIGHT);
 }
 
 
@@ -1344,11 +2142,38 @@ void DrawStatusScreenActive()
 //
 void DrawCommitScreen()
 {
+    SetForegroundColor(255,255,255);
+    SetBackgroundColor(0,0,0);
+
     // Locate to the right corner of the screen
     SetCursorPosition(MENU_SCREEN_ROW_START, MENU_SCREEN_COLUMN_START);
 
     //  Write Stuff
-    printf("Temporary Commit Screen Text!");
+    printf("Commit Settings");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 2, MENU_SCREEN_COLUMN_START);
+    if (CurrentSettingsStore.found)
+    {
+        printf("Stored: record %lu (sector %i, slot %i)", (unsigned long) CurrentSettingsStore.sequence,
+               CurrentSettingsStore.sector, CurrentSettingsStore.slot);
+    }
+    else
+    {
+        printf("Stored: none, running on defaults");
+    }
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 3, MENU_SCREEN_COLUMN_START);
+    printf("This boot: %lu commits, %lu sector erases", (unsigned long) CurrentSettingsStore.commits,
+           (unsigned long) CurrentSettingsStore.erases);
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 5, MENU_SCREEN_COLUMN_START);
+    printf("Enter - Write current settings to flash.");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 6, MENU_SCREEN_COLUMN_START);
+    printf("F - Save the current frame as the boot frame.");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 8, MENU_SCREEN_COLUMN_START);
+    printf("%s", LastCommitResult);
 }
 
 //
@@ -1374,9 +2199,198 @@ void DrawHelpScreen()
 
     SetCursorPosition(MENU_SCREEN_ROW_START + 4, MENU_SCREEN_COLUMN_START);
     printf("R - Redraw Screen entirely.");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 5, MENU_SCREEN_COLUMN_START);
+    printf("Status - Left/Right page, Up/Down zoom, M sample mode.");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 6, MENU_SCREEN_COLUMN_START);
+    printf("Binary frames go to the second (data) USB serial port.");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 7, MENU_SCREEN_COLUMN_START);
+    printf("T - Dump the event trace to the data port (tools/pixtrace).");
+
+    SetCursorPosition(MENU_SCREEN_ROW_START + 8, MENU_SCREEN_COLUMN_START);
+    printf("Config - Up/Down timing, Left/Right brightness, F format.");
+}
+
+
+
+//
+//
+//  Frame Stream Mode
+//
+//
+
+//  Return to the previous effect after this long without stream data
+const uint64_t STREAM_IDLE_TIMEOUT_US = 1000000;
+
+//  Bytes pulled from the data interface per parser call
+#define STREAM_CHUNK_SIZE 256
+
+struct StreamParserStruct CurrentStream;
+
+//  Separate from the flash image's, the cores decode at the same time
+struct ImageDecoderStruct StreamImageDecoder;
+bool StreamModeActive = false;
+uint64_t StreamLastByteTime = 0;
+int StreamPreviousEffect = RANDOM;
+
+//  Data read from USB but not yet taken by the parser
+uint8_t StreamChunk[STREAM_CHUNK_SIZE];
+int StreamChunkLength = 0;
+int StreamChunkUsed = 0;
+
+void InitStreamMode()
+{
+    StreamParserInit(&CurrentStream);
+    StreamParserSetImage(&CurrentStream, &StreamImageDecoder, &CurrentMatrix);
+    StreamModeActive = false;
+    StreamChunkLength = 0;
+    StreamChunkUsed = 0;
+}
+
+//
+//  Hand the finished back buffer over to core 0
+//
+void PresentBackBuffer()
+{
+    TraceRecord(TRACE_STREAM_FRAME, CurrentStream.sequence);
+    FramePresentPending = true;
+}
+
+//
+//  Swap the back buffer to the front, core 0 only
+//
+void SwapPixelBuffers()
+{
+    int* data = CurrentPixelBuffer.data;
+    CurrentPixelBuffer.data = BackPixelBuffer.data;
+    BackPixelBuffer.data = data;
+
+    FramePresentPending = false;
+}
+
+void EnterStreamMode()
+{
+    StreamModeActive = true;
+
+    //  Effects stop writing the pixel buffer while frames are streaming
+    StreamPreviousEffect = currentEffect;
+    currentEffect = STREAM;
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_STREAM << 8 | 1);
+}
+
+void ExitStreamMode()
+{
+    StreamModeActive = false;
+
+    //  The effect draws over the last frame, and whatever was cut off mustn't swallow the next session's first
+    StreamParserReset(&CurrentStream);
+    currentEffect = StreamPreviousEffect;
+    TraceRecord(TRACE_COMMAND, TRACE_COMMAND_STREAM << 8 | 0);
+}
+
+//
+//  Feed data interface bytes to the stream parser, never blocks
+//
+void ServiceStreamMode()
+{
+    //  Back buffer belongs to core 0 until it picks up the last frame, USB holds off the host meanwhile
+    while (!FramePresentPending)
+    {
+        //  So does the ticker message until core 0 has laid it out
+        if (CurrentStream.textReady)
+        {
+            if (TickerMessagePending)
+            {
+                return;
+            }
+
+            StringCopy(CurrentSettings.tickerMessage, CurrentStream.text);
+            TickerMessagePending = true;
+            CurrentStream.textReady = false;
+        }
+
+        if (StreamChunkUsed == StreamChunkLength)
+        {
+            StreamChunkLength = UsbDataRead(StreamChunk, STREAM_CHUNK_SIZE);
+            StreamChunkUsed = 0;
+
+            if (StreamChunkLength == 0)
+            {
+                if (StreamModeActive && HalTimeUs() - StreamLastByteTime > STREAM_IDLE_TIMEOUT_US)
+                {
+                    ExitStreamMode();
+                }
+                return;
+            }
+
+            if (!StreamModeActive)
+            {
+                EnterStreamMode();
+            }
+            StreamLastByteTime = HalTimeUs();
+        }
+
+        StreamParserSetTarget(&CurrentStream, BackPixelBuffer.data, BackPixelBuffer.size);
+        StreamParserSetReference(&CurrentStream, CurrentPixelBuffer.data);
+        StreamChunkUsed += StreamParserFeed(&CurrentStream, StreamChunk + StreamChunkUsed, StreamChunkLength - StreamChunkUsed);
+
+        if (CurrentStream.frameReady)
+        {
+            PresentBackBuffer();
+            CurrentStream.frameReady = false;
+        }
+    }
 }
 
 
+//
+//
+//  Event Trace Dump
+//
+//
+
+//  Give up if the host stops reading for this long
+const uint64_t TRACE_DUMP_STALL_US = 1000000;
+
+uint64_t TraceDumpLastProgress = 0;
+
+void StartTraceDump()
+{
+    if (TraceDumpStart())
+    {
+        TraceDumpLastProgress = HalTimeUs();
+    }
+}
+
+//
+//  Move as much of the dump as the data interface will take without dropping, never blocks
+//
+void ServiceTraceDump()
+{
+    uint8_t chunk[64];
+
+    if (!TraceDumpActive())
+    {
+        return;
+    }
+
+    int room = UsbDataWriteAvailable();
+    if (room == 0)
+    {
+        if (HalTimeUs() - TraceDumpLastProgress > TRACE_DUMP_STALL_US)
+        {
+            TraceDumpStop();
+        }
+        return;
+    }
+
+    int length = TraceDumpRead(chunk, room < (int) sizeof(chunk) ? room : (int) sizeof(chunk));
+    UsbDataWrite(chunk, length);
+    TraceDumpLastProgress = HalTimeUs();
+}
+
 
 //
 //
@@ -1385,7 +2399,13 @@ void DrawHelpScreen()
 //
 void ProcessInput()
 {
-    char input = getchar_timeout_us(0);
+    int key = HalConsoleRead();
+    if (key >= 0)
+    {
+        TraceRecord(TRACE_INPUT, key);
+    }
+
+    char input = key;
 
     switch (input)
     {
@@ -1396,18 +2416,37 @@ void ProcessInput()
             //
             //  Check to see if there's a '[' following for a proper escape sequence
             //
-            if (getchar_timeout_us(0) != '[')
+            if (HalConsoleRead() != '[')
             {
                 return;
             }
 
-            input = getchar_timeout_us(0);
+            input = HalConsoleRead();
             switch (input)
             {
                 //  Process Up
                 case 'A':
                     if (CurrentSerial.screenActive)
                     {
+                        //  Previous effect
+                        if (CurrentSerial.menuSelection == 1)
+                        {
+                            SelectEffect(-1);
+                            CurrentSerial.updateMenuChoice = true;
+                        }
+
+                        //  Zoom the pixel monitor in
+                        if (CurrentSerial.menuSelection == 3)
+                        {
+                            PixelMonitorZoom(1);
+                        }
+
+                        //  Previous timing profile
+                        if (CurrentSerial.menuSelection == 0)
+                        {
+                            SelectTimingProfile(-1);
+                            CurrentSerial.updateMenuChoice = true;
+                        }
                     }
                     else
                     {
@@ -1426,6 +2465,25 @@ void ProcessInput()
                 case 'B':
                     if (CurrentSerial.screenActive)
                     {
+                        //  Next effect
+                        if (CurrentSerial.menuSelection == 1)
+                        {
+                            SelectEffect(1);
+                            CurrentSerial.updateMenuChoice = true;
+                        }
+
+                        //  Zoom the pixel monitor out
+                        if (CurrentSerial.menuSelection == 3)
+                        {
+                            PixelMonitorZoom(-1);
+                        }
+
+                        //  Next timing profile
+                        if (CurrentSerial.menuSelection == 0)
+                        {
+                            SelectTimingProfile(1);
+                            CurrentSerial.updateMenuChoice = true;
+                        }
                     }
                     else
                     {
@@ -1441,8 +2499,36 @@ void ProcessInput()
                     break;
 
                //  Process Left
+                case 'D':
+                    if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 3)
+                    {
+                        //  Previous pixel monitor page
+                        PixelMonitorPage(-1);
+                    }
+
+                    //  Dimmer clocked LEDs
+                    if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 0)
+                    {
+                        StepGlobalBrightness(-1);
+                        CurrentSerial.updateMenuChoice = true;
+                    }
+                    break;
 
                //  Process Right
+                case 'C':
+                    if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 3)
+                    {
+                        //  Next pixel monitor page
+                        PixelMonitorPage(1);
+                    }
+
+                    //  Brighter clocked LEDs
+                    if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 0)
+                    {
+                        StepGlobalBrightness(1);
+                        CurrentSerial.updateMenuChoice = true;
+                    }
+                    break;
 
                //  Default Catchall
                 default:
@@ -1466,6 +2552,40 @@ void ProcessInput()
 
             break;
 
+        //
+        //  Enter, act on the active screen
+        //
+        case '\r':
+            if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 4)
+            {
+                CommitSettings();
+
+                //  Show the result
+                CurrentSerial.updateMenuChoice = true;
+            }
+            break;
+
+        //
+        //  Save Boot Frame
+        //
+        case 'f':
+        case 'F':
+            if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 4)
+            {
+                SaveBootFrame();
+
+                //  Show the result
+                CurrentSerial.updateMenuChoice = true;
+            }
+
+            //  Next pixel format on the Config screen
+            if (CurrentSerial.screenActive && CurrentSerial.menuSelection == 0)
+            {
+                SelectPixelFormat(1);
+                CurrentSerial.updateMenuChoice = true;
+            }
+            break;
+
         //
         //  Redraw Screen
         //
@@ -1490,6 +2610,26 @@ void ProcessInput()
             {
                 PauseEffect = true;
             }
+            TraceRecord(TRACE_COMMAND, TRACE_COMMAND_PAUSE << 8 | PauseEffect);
+            break;
+
+        //
+        //  Dump the Event Trace down the data interface
+        //
+        case 't':
+        case 'T':
+            if (UsbDataConnected())
+            {
+                StartTraceDump();
+            }
+            break;
+
+        //
+        //  Pixel Monitor Sample Mode
+        //
+        case 'm':
+        case 'M':
+            PixelMonitorCycleSampleMode();
             break;
 
         //
@@ -1497,14 +2637,7 @@ void ProcessInput()
         //
         case 's':
         case 'S':
-            if (CurrentSettings.ProgramRunning)
-            {
-                StopPIOPixelProgram();
-            }
-            else
-            {
-                StartPIOPixelProgram();
-            }
+            PixelProgramTogglePending = true;
             break;
 
         //  Default Catchall
@@ -1516,6 +2649,46 @@ void ProcessInput()
 
 
 //
+//
+//  Analyse the next audio block if there is one, and publish it.  One a call, so USB never waits long.
+//
+void ServiceAudio()
+{
+    if (!AudioInputRunning)
+    {
+        return;
+    }
+
+    uint32_t completed = HalAudioBlocks();
+
+    //  Fallen far enough behind that the DMA is writing over what's next, skip to the newest finished block
+    if (completed - AudioBlocksTaken > HAL_AUDIO_BLOCKS - 1)
+    {
+        AudioOverruns += completed - 1 - AudioBlocksTaken;
+        AudioBlocksTaken = completed - 1;
+    }
+
+    if (AudioBlocksTaken == completed)
+    {
+        return;
+    }
+
+    uint64_t start = HalTimeUs();
+
+    AudioAnalyse(&AudioAnalyser, HalAudioRing() + AudioBlocksTaken % HAL_AUDIO_BLOCKS * HAL_AUDIO_BLOCK_SAMPLES);
+    AudioPublish(&AudioAnalyser.levels);
+    AudioBlocksTaken++;
+
+    uint32_t elapsed = (uint32_t) (HalTimeUs() - start);
+    AudioBlockLastUs = elapsed;
+    AudioBlockAverageUs16 = AudioBlockAverageUs16 == 0 ? elapsed * 16 :
+                            AudioBlockAverageUs16 - AudioBlockAverageUs16 / 16 + elapsed;
+    if (elapsed > AudioBlockMaxUs)
+    {
+        AudioBlockMaxUs = elapsed;
+    }
+}
+
 //
 //  Serial Interface Function - Second Core Used
 //
@@ -1523,12 +2696,37 @@ void ProcessInput()
 void serialUSBInterface()
 {
     int logoColorIndex = 0;
+    uint64_t lastUpdate = 0;
+
+    //  USB belongs to this core
+    UsbCdcInit();
+
+    //  So does audio, its block interrupt and its analysis
+    AudioAnalyserInit(&AudioAnalyser);
+    AudioInputRunning = HalAudioStart(AUDIO_INPUT_PIN, AUDIO_SAMPLE_RATE);
 
     //
     //  Main Loop
     //
     while (true)
     {
+        //
+        //  Keep USB, the frame stream and the audio analysis moving between screen updates
+        //
+        UsbCdcTask();
+        ServiceStreamMode();
+        ServiceTraceDump();
+        ServiceAudio();
+
+        //
+        //  Update Rate for Serial System
+        //
+        if (HalTimeUs() - lastUpdate < SERIAL_UPDATE_PERIOD_US)
+        {
+            continue;
+        }
+        lastUpdate = HalTimeUs();
+
         //
         //  Background Layer
         //
@@ -1644,6 +2842,13 @@ void serialUSBInterface()
             DrawMainLogo(1, 2, logoColorIndex);
             logoColorIndex = (logoColorIndex + 1) % 16;
 
+            //  If Inputs Screen
+            if (CurrentSerial.menuSelection == 2)
+            {
+                //  Draw the band levels and analysis timing
+                DrawInputsScreenActive();
+            }
+
             //  If Status Screen
             if (CurrentSerial.menuSelection == 3)
             {
@@ -1651,11 +2856,6 @@ void serialUSBInterface()
                 DrawStatusScreenActive();
             }
 
-        //
-        //  Update Rate for Serial System
-        //
-        sleep_ms(100);
-
         //
         //  Poll and Process Input
         //
@@ -1667,6 +2867,9 @@ void InitPixelBuffer()
 {
     CurrentPixelBuffer.data = NULL;
     CurrentPixelBuffer.size = 0;
+
+    BackPixelBuffer.data = NULL;
+    BackPixelBuffer.size = 0;
 }
 
 void NewPixelBuffer(int size)
@@ -1674,6 +2877,19 @@ void NewPixelBuffer(int size)
     //Check current pixel buffer
     CurrentPixelBuffer.data = malloc(sizeof(int) * size);
     CurrentPixelBuffer.size = size;
+
+    //  Back buffer for streamed frames
+    BackPixelBuffer.data = malloc(sizeof(int) * size);
+    BackPixelBuffer.size = size;
+
+    //  A layout that doesn't fit the string falls back to one long row
+    if (!PixelMatrixInit(&CurrentMatrix, &CurrentSettings.matrix, size))
+    {
+        DefaultMatrixLayout(&CurrentSettings.matrix, size);
+        PixelMatrixInit(&CurrentMatrix, &CurrentSettings.matrix, size);
+    }
+
+    MatrixCanvas = malloc(sizeof(int) * CurrentMatrix.width * CurrentMatrix.height);
 }
 
 
@@ -1686,6 +2902,9 @@ void NewPixelBuffer(int size)
 //
 int main()
 {
+    //  Let core 1 pause this core while it writes flash
+    HalCoreLockoutVictimInit();
+
     //
     //  Check and Load Settings
     //
@@ -1694,42 +2913,238 @@ int main()
     //  Init the Pixel Buffer
     InitPixelBuffer();
 
-    //Get the second core running the USB Serial handling code
-    multicore_launch_core1(serialUSBInterface);
+    //  Noise and palettes for the effects
+    EffectsInit(FAST_RANDOM_SEED);
+    EffectTickerSetMessage(CurrentSettings.tickerMessage);
 
-    //Initialize all stdio io stuff
-    stdio_init_all();
+    //  Init the Pixel Monitor
+    InitPixelMonitor();
 
-    //  Start the PIO stuff for LED driving
-    StartPIOPixelProgram();
+    //  Init the Frame Stream
+    InitStreamMode();
+
+    //
+    //  Fast start, get light on the string before anything slow like USB
+    //
 
     // Size out a new pixel buffer
     NewPixelBuffer(CurrentSettings.pixelBufferSize);
 
+    //  Start the PIO stuff for LED driving
+    StartPIOPixelProgram();
+
+    //  Show the stored boot frame
+    ShowBootFrame();
+
+    //Get the second core running the USB Serial handling code
+    HalLaunchCore1(serialUSBInterface);
+
+    //Initialize all stdio io stuff
+    HalConsoleInit();
+
+    //  See if there's an animation or a show in flash
+    AnimationAvailable = AnimationPlayerInit(&CurrentAnimation);
+    ShowAvailable = ShowOpen(&CurrentShow, HalFlashRead(ANIMATION_FLASH_OFFSET), ANIMATION_FLASH_SIZE);
+    ImageAvailable = ImageOpen(&CurrentImage, HalFlashRead(ANIMATION_FLASH_OFFSET), ANIMATION_FLASH_SIZE);
+
+    //  Effect the output is currently set up for
+    int runningEffect = currentEffect;
+
+    //  Show time only runs while the effect isn't paused
+    uint64_t effectClockUs = 0;
+    uint64_t lastFrameTime = HalTimeUs();
+    uint64_t nextFrameTime = lastFrameTime;
+
+    //  Boot frame and start up don't count
+    FRAME_PROBE_BEGIN();
+
     while (1)
     {
+        //  Pick up a frame presented by the stream
+        if (FramePresentPending)
+        {
+            SwapPixelBuffers();
+        }
+
+        //  And a new ticker message
+        if (TickerMessagePending)
+        {
+            EffectTickerSetMessage(CurrentSettings.tickerMessage);
+            TickerMessagePending = false;
+        }
+
+        //  Reload the program with a new timing profile, or start or stop it for the 'S' key, playback's DMA has to
+        //  let go of it first
+        if (PixelProgramRestartPending || PixelProgramTogglePending)
+        {
+            bool running = CurrentSettings.ProgramRunning != PixelProgramTogglePending;
+
+            if (runningEffect == PLAYBACK)
+            {
+                AnimationPlayerStop(&CurrentAnimation);
+
+                //  Picked back up below
+                runningEffect = -1;
+            }
+
+            if (CurrentSettings.ProgramRunning)
+            {
+                StopPIOPixelProgram();
+            }
+            if (running)
+            {
+                StartPIOPixelProgram();
+            }
+
+            PixelProgramRestartPending = false;
+            PixelProgramTogglePending = false;
+        }
+
+        //  Start and stop effects that drive the PIO themselves
+        if (currentEffect != runningEffect)
+        {
+            if (runningEffect == PLAYBACK)
+            {
+                AnimationPlayerStop(&CurrentAnimation);
+            }
+
+            if (currentEffect == PLAYBACK &&
+                !AnimationPlayerStart(&CurrentAnimation, CurrentPixelFormat))
+            {
+                //  Nothing valid in flash, or packed for another pixel format
+                currentEffect = RANDOM;
+            }
+
+            if (EffectIsAnimated(currentEffect))
+            {
+                effectClockUs = 0;
+                nextFrameTime = HalTimeUs();
+
+                if (currentEffect == SHOW && !ShowAvailable)
+                {
+                    currentEffect = RANDOM;
+                }
+
+                if (currentEffect == IMAGE && (!ImageAvailable || CurrentMatrix.table == NULL))
+                {
+                    currentEffect = RANDOM;
+                }
+
+                //  Images start over from their first frame
+                ImageRewind(&CurrentImage);
+                ImageFrameDueUs = 0;
+            }
+
+            runningEffect = currentEffect;
+        }
+
+        //  Flash playback feeds the PIO by DMA, nothing to render or write out
+        if (runningEffect == PLAYBACK)
+        {
+            AnimationPlayerService(&CurrentAnimation, PauseEffect, 10000);
+            continue;
+        }
+
+        uint64_t frameTime = HalTimeUs();
+        if (!PauseEffect)
+        {
+            effectClockUs += frameTime - lastFrameTime;
+        }
+        lastFrameTime = frameTime;
+
         //  Do the current Effect
+        TraceRecord(TRACE_FRAME_START, currentEffect);
+        FRAME_PROBE_START(renderStart);
         if (!PauseEffect)
         {
             switch (currentEffect)
             {
                 case RANDOM:
-                    for (int i = 0; i < CurrentPixelBuffer.size; i++)
+                    EffectRandom(CurrentPixelBuffer.data, CurrentPixelBuffer.size);
+                    PixelBrightnessMask(CurrentPixelBuffer.data, CurrentPixelBuffer.size, CurrentBrightnessMask);
+                    break;
+
+                //  Frames come in from core 1
+                case STREAM:
+                    break;
+
+                //  Handled above
+                case PLAYBACK:
+                    break;
+
+                case SHOW:
+                    ShowRender(&CurrentShow, effectClockUs, CurrentPixelBuffer.data, CurrentPixelBuffer.size);
+                    break;
+
+                //  Frames stay in the buffer until the next is due, at most one a frame so none get skipped
+                case IMAGE:
+                    if (effectClockUs >= ImageFrameDueUs)
                     {
-                        CurrentPixelBuffer.data[i] = rand()% 0xFFFFFF & (CurrentBrightnessMask | CurrentBrightnessMask << 8 | CurrentBrightnessMask << 16);
+                        uint32_t delayMs = ImageRenderNext(&CurrentImage, &ImageDecoder, CurrentPixelBuffer.data,
+                                                           CurrentPixelBuffer.size, &CurrentMatrix);
+                        PixelBrightnessMask(CurrentPixelBuffer.data, CurrentPixelBuffer.size, CurrentBrightnessMask);
+
+                        ImageFrameDueUs += (uint64_t) delayMs * 1000;
+                        if (ImageFrameDueUs < effectClockUs)
+                        {
+                            ImageFrameDueUs = effectClockUs;
+                        }
                     }
+                    break;
+
+                //  2D effects
+                default:
+                    MatrixEffectRenderers[currentEffect - MATRIX_TEST](MatrixCanvas, CurrentMatrix.width,
+                                                                       CurrentMatrix.height,
+                                                                       (uint32_t) (effectClockUs / 1000));
+                    PixelMatrixPresent(&CurrentMatrix, MatrixCanvas, CurrentPixelBuffer.data);
+                    PixelBrightnessMask(CurrentPixelBuffer.data, CurrentPixelBuffer.size, CurrentBrightnessMask);
+                    break;
             }
         }
+        FRAME_PROBE_END(FRAME_RENDER, renderStart);
+
 
+        //  Write stuff out, unless 'S' stopped the program, the FIFO would never drain
+        FRAME_PROBE_START(outputStart);
+        if (CurrentSettings.ProgramRunning)
+        {
+            WritePixels(CurrentPixelBuffer.data, CurrentPixelBuffer.size);
+        }
+        FRAME_PROBE_END(FRAME_OUTPUT, outputStart);
+        TraceRecord(TRACE_FRAME_PRESENT, CurrentPixelBuffer.size > 0xFFFF ? 0xFFFF : CurrentPixelBuffer.size);
 
-        //  Write stuff out
-        for (int i = 0; i < CurrentPixelBuffer.size; i++)
+        FRAME_PROBE_START(slackStart);
+        if (currentEffect == STREAM)
+        {
+            //  Go as fast as frames arrive, but keep refreshing the string if they stop
+            uint64_t waitStart = HalTimeUs();
+            while (!FramePresentPending && currentEffect == STREAM && HalTimeUs() - waitStart < 100000)
+            {
+                HalIdle();
+            }
+        }
+        else if (EffectIsAnimated(currentEffect))
+        {
+            //  Hold the output rate, rendering and writing out come out of the frame time
+            nextFrameTime += SHOW_FRAME_INTERVAL_US;
+            uint64_t now = HalTimeUs();
+            if (nextFrameTime > now)
+            {
+                HalSleepUs(nextFrameTime - now);
+            }
+            else
+            {
+                nextFrameTime = now;
+            }
+        }
+        else
         {
-            // Write the pattern out
-            put_pixel(CurrentPixelBuffer.data[i]);
+            HalSleepMs(100);
         }
+        FRAME_PROBE_END(FRAME_SLACK, slackStart);
 
-        sleep_ms(100);
+        FRAME_PROBE_FRAME();
     }
 return 0;
 
@@ -0,0 +1,224 @@
+#include "noise.h"
+#include "fast_random.h"
+
+#define NOISE_FRACTION_MASK (NOISE_ONE - 1)
+
+static uint8_t NoisePermutation[256];
+static uint8_t NoiseFade[256];
+
+//  Edges of the cube, padded to 16 with repeats so a hash picks one with a mask
+static const int8_t NoiseGradients3D[16][3] =
+        {
+                {1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0},
+                {1, 0, 1}, {-1, 0, 1}, {1, 0, -1}, {-1, 0, -1},
+                {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1},
+                {1, 1, 0}, {0, -1, 1}, {-1, 1, 0}, {0, -1, -1}
+        };
+
+static const int8_t NoiseGradients2D[8][2] =
+        {
+                {1, 1}, {-1, 1}, {1, -1}, {-1, -1},
+                {1, 0}, {-1, 0}, {0, 1}, {0, -1}
+        };
+
+//  Raw results to 0 to 255 by multiplying then shifting, set so 98% of values land between about 15 and 240
+//  and under 1% clamp.  1D gradients go up to 8, so its sums run four times larger.
+#define NOISE_SCALE_1D 5
+#define NOISE_SHIFT_1D 5
+#define NOISE_SCALE_2D 3
+#define NOISE_SHIFT_2D 2
+#define NOISE_SCALE_3D 3
+#define NOISE_SHIFT_3D 2
+
+void NoiseInit(uint32_t seed)
+{
+    uint32_t state = seed != 0 ? seed : FAST_RANDOM_SEED;
+
+    for (int i = 0; i < 256; i++)
+    {
+        NoisePermutation[i] = (uint8_t) i;
+    }
+
+    for (int i = 255; i > 0; i--)
+    {
+        int j = (int) FastRandomRange(&state, i + 1);
+        uint8_t swap = NoisePermutation[i];
+        NoisePermutation[i] = NoisePermutation[j];
+        NoisePermutation[j] = swap;
+    }
+
+    //  t^3 (6t^2 - 15t + 10) with t in 256ths
+    for (int64_t t = 0; t < 256; t++)
+    {
+        NoiseFade[t] = (uint8_t) (t * t * t * (6 * t * t - 15 * 256 * t + 10 * 65536) >> 32);
+    }
+}
+
+static inline uint8_t NoiseHash(uint32_t i)
+{
+    return NoisePermutation[i & 0xFF];
+}
+
+static inline int NoiseLerp(int from, int to, int fade)
+{
+    return from + (((to - from) * fade) >> NOISE_FRACTION_BITS);
+}
+
+static inline uint8_t NoiseByte(int value, int scale, int shift)
+{
+    value = 128 + ((value * scale) >> shift);
+
+    if (value < 0)
+    {
+        return 0;
+    }
+    if (value > 255)
+    {
+        return 255;
+    }
+    return (uint8_t) value;
+}
+
+static inline int NoiseGradient1D(uint8_t hash, int fx)
+{
+    int gradient = (hash & 7) + 1;
+
+    return hash & 8 ? -gradient * fx : gradient * fx;
+}
+
+static inline int NoiseGradient2D(uint8_t hash, int fx, int fy)
+{
+    const int8_t* gradient = NoiseGradients2D[hash & 7];
+
+    return gradient[0] * fx + gradient[1] * fy;
+}
+
+static inline int NoiseGradient3D(uint8_t hash, int fx, int fy, int fz)
+{
+    const int8_t* gradient = NoiseGradients3D[hash & 15];
+
+    return gradient[0] * fx + gradient[1] * fy + gradient[2] * fz;
+}
+
+void Noise1DRow(uint8_t* values, int count, uint32_t x, uint32_t dx)
+{
+    //  Anything but the first cell
+    uint32_t cellX = ~(x >> NOISE_FRACTION_BITS);
+    uint8_t hash0 = 0;
+    uint8_t hash1 = 0;
+
+    for (int i = 0; i < count; i++, x += dx)
+    {
+        if (x >> NOISE_FRACTION_BITS != cellX)
+        {
+            cellX = x >> NOISE_FRACTION_BITS;
+            hash0 = NoiseHash(cellX);
+            hash1 = NoiseHash(cellX + 1);
+        }
+
+        int fx = x & NOISE_FRACTION_MASK;
+        int value = NoiseLerp(NoiseGradient1D(hash0, fx), NoiseGradient1D(hash1, fx - NOISE_ONE), NoiseFade[fx]);
+
+        values[i] = NoiseByte(value, NOISE_SCALE_1D, NOISE_SHIFT_1D);
+    }
+}
+
+void Noise2DRow(uint8_t* values, int count, uint32_t x, uint32_t dx, uint32_t y)
+{
+    uint32_t cellY = y >> NOISE_FRACTION_BITS;
+    int fy = y & NOISE_FRACTION_MASK;
+    int fadeY = NoiseFade[fy];
+
+    uint32_t cellX = ~(x >> NOISE_FRACTION_BITS);
+    uint8_t hash00 = 0;
+    uint8_t hash10 = 0;
+    uint8_t hash01 = 0;
+    uint8_t hash11 = 0;
+
+    for (int i = 0; i < count; i++, x += dx)
+    {
+        if (x >> NOISE_FRACTION_BITS != cellX)
+        {
+            cellX = x >> NOISE_FRACTION_BITS;
+            uint8_t column0 = NoiseHash(cellX);
+            uint8_t column1 = NoiseHash(cellX + 1);
+            hash00 = NoiseHash(column0 + cellY);
+            hash10 = NoiseHash(column1 + cellY);
+            hash01 = NoiseHash(column0 + cellY + 1);
+            hash11 = NoiseHash(column1 + cellY + 1);
+        }
+
+        int fx = x & NOISE_FRACTION_MASK;
+        int fadeX = NoiseFade[fx];
+
+        int top = NoiseLerp(NoiseGradient2D(hash00, fx, fy), NoiseGradient2D(hash10, fx - NOISE_ONE, fy), fadeX);
+        int bottom = NoiseLerp(NoiseGradient2D(hash01, fx, fy - NOISE_ONE),
+                               NoiseGradient2D(hash11, fx - NOISE_ONE, fy - NOISE_ONE), fadeX);
+
+        values[i] = NoiseByte(NoiseLerp(top, bottom, fadeY), NOISE_SCALE_2D, NOISE_SHIFT_2D);
+    }
+}
+
+void Noise3DRow(uint8_t* values, int count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z)
+{
+    uint32_t cellY = y >> NOISE_FRACTION_BITS;
+    uint32_t cellZ = z >> NOISE_FRACTION_BITS;
+    int fy = y & NOISE_FRACTION_MASK;
+    int fz = z & NOISE_FRACTION_MASK;
+    int fadeY = NoiseFade[fy];
+    int fadeZ = NoiseFade[fz];
+
+    //  Corner hashes, bit 0 is x, bit 1 y and bit 2 z
+    uint32_t cellX = ~(x >> NOISE_FRACTION_BITS);
+    uint8_t hash[8] = {0};
+
+    for (int i = 0; i < count; i++, x += dx)
+    {
+        if (x >> NOISE_FRACTION_BITS != cellX)
+        {
+            cellX = x >> NOISE_FRACTION_BITS;
+            for (int corner = 0; corner < 8; corner++)
+            {
+                uint8_t column = NoiseHash(cellX + (corner & 1));
+                uint8_t plane = NoiseHash(column + cellY + ((corner >> 1) & 1));
+                hash[corner] = NoiseHash(plane + cellZ + (corner >> 2));
+            }
+        }
+
+        int fx = x & NOISE_FRACTION_MASK;
+        int fadeX = NoiseFade[fx];
+        int gx = fx - NOISE_ONE;
+        int gy = fy - NOISE_ONE;
+        int gz = fz - NOISE_ONE;
+
+        int near = NoiseLerp(NoiseLerp(NoiseGradient3D(hash[0], fx, fy, fz), NoiseGradient3D(hash[1], gx, fy, fz), fadeX),
+                             NoiseLerp(NoiseGradient3D(hash[2], fx, gy, fz), NoiseGradient3D(hash[3], gx, gy, fz), fadeX),
+                             fadeY);
+        int far = NoiseLerp(NoiseLerp(NoiseGradient3D(hash[4], fx, fy, gz), NoiseGradient3D(hash[5], gx, fy, gz), fadeX),
+                            NoiseLerp(NoiseGradient3D(hash[6], fx, gy, gz), NoiseGradient3D(hash[7], gx, gy, gz), fadeX),
+                            fadeY);
+
+        values[i] = NoiseByte(NoiseLerp(near, far, fadeZ), NOISE_SCALE_3D, NOISE_SHIFT_3D);
+    }
+}
+
+uint8_t Noise1D(uint32_t x)
+{
+    uint8_t value;
+    Noise1DRow(&value, 1, x, 0);
+    return value;
+}
+
+uint8_t Noise2D(uint32_t x, uint32_t y)
+{
+    uint8_t value;
+    Noise2DRow(&value, 1, x, 0, y);
+    return value;
+}
+
+uint8_t Noise3D(uint32_t x, uint32_t y, uint32_t z)
+{
+    uint8_t value;
+    Noise3DRow(&value, 1, x, 0, y, z);
+    return value;
+}
@@ -0,0 +1,33 @@
+#ifndef PICOPIXOS_NOISE_H
+#define PICOPIXOS_NOISE_H
+
+#include <stdint.h>
+
+//
+//  Gradient Noise
+//
+//  Perlin noise in integer maths for the M0+, which has no FPU.  Coordinates have NOISE_FRACTION_BITS of
+//  fraction, so NOISE_ONE is one lattice cell.  Gradients come from a table indexed by a hash of the corner,
+//  the hash is a 256 entry permutation shuffled from a seed, and the fade curve 6t^5 - 15t^4 + 10t^3 is a 256
+//  entry table too.  Results are 0 to 255, around 128.
+//
+//  The row functions fill count values stepping x by dx, with everything that depends on y and z worked out
+//  once for the row and the corner hashes once per cell rather than once per value.  Effects should use them
+//  a canvas row at a time, the single value functions are the same code with a count of one.
+//
+
+#define NOISE_FRACTION_BITS 8
+#define NOISE_ONE (1 << NOISE_FRACTION_BITS)
+
+//  Shuffle the permutation and build the fade table
+void NoiseInit(uint32_t seed);
+
+void Noise1DRow(uint8_t* values, int count, uint32_t x, uint32_t dx);
+void Noise2DRow(uint8_t* values, int count, uint32_t x, uint32_t dx, uint32_t y);
+void Noise3DRow(uint8_t* values, int count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z);
+
+uint8_t Noise1D(uint32_t x);
+uint8_t Noise2D(uint32_t x, uint32_t y);
+uint8_t Noise3D(uint32_t x, uint32_t y, uint32_t z);
+
+#endif
@@ -0,0 +1,100 @@
+#include "particles.h"
+#include "pixel_format.h"
+
+void ParticleSystemInit(struct ParticleSystem* system, int16_t gravity)
+{
+    system->count = 0;
+    system->gravity = gravity;
+}
+
+int ParticleSpawn(struct ParticleSystem* system, int32_t x, int32_t y, int16_t vx, int16_t vy, int colour,
+                  uint16_t life)
+{
+    if (system->count == PARTICLE_CAPACITY)
+    {
+        return -1;
+    }
+
+    int index = system->count++;
+    system->x[index] = x;
+    system->y[index] = y;
+    system->vx[index] = vx;
+    system->vy[index] = vy;
+    system->colour[index] = colour;
+    system->life[index] = life;
+
+    return index;
+}
+
+void ParticleKill(struct ParticleSystem* system, int index)
+{
+    int last = --system->count;
+
+    system->x[index] = system->x[last];
+    system->y[index] = system->y[last];
+    system->vx[index] = system->vx[last];
+    system->vy[index] = system->vy[last];
+    system->colour[index] = system->colour[last];
+    system->life[index] = system->life[last];
+}
+
+void ParticleUpdate(struct ParticleSystem* system, int width, int height)
+{
+    int count = system->count;
+
+    //  One pass per field
+    for (int i = 0; i < count; i++)
+    {
+        system->x[i] += system->vx[i];
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        system->y[i] += system->vy[i];
+        system->vy[i] += system->gravity;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        system->life[i]--;
+    }
+
+    //  Kill from the back, so whatever moves into a gap has already been checked
+    uint32_t right = (uint32_t) width * PARTICLE_ONE;
+    uint32_t bottom = (uint32_t) height * PARTICLE_ONE;
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        //  Negative positions wrap to large unsigned ones, one compare covers both edges
+        if (system->life[i] == 0 || (uint32_t) system->x[i] >= right || (uint32_t) system->y[i] >= bottom)
+        {
+            ParticleKill(system, i);
+        }
+    }
+}
+
+void ParticleSplat(const struct ParticleSystem* system, int* canvas, int width, int height)
+{
+    uint32_t right = (uint32_t) width * PARTICLE_ONE;
+    uint32_t bottom = (uint32_t) height * PARTICLE_ONE;
+
+    for (int i = 0; i < system->count; i++)
+    {
+        uint32_t x = (uint32_t) system->x[i];
+        uint32_t y = (uint32_t) system->y[i];
+
+        //  Only just spawned ones can be off the canvas
+        if (x >= right || y >= bottom)
+        {
+            continue;
+        }
+
+        int cell = (y / PARTICLE_ONE) * width + x / PARTICLE_ONE;
+
+        int life = system->life[i];
+        int colour = life >= PARTICLE_FADE_STEPS ? system->colour[i]
+                                                 : PixelScale(system->colour[i], life * 256 / PARTICLE_FADE_STEPS);
+
+        canvas[cell] = PixelAddSaturate(canvas[cell], colour);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PICOPIXOS_PARTICLES_H
+#define PICOPIXOS_PARTICLES_H
+
+#include <stdint.h>
+
+//
+//  Particle System
+//
+//  A fixed pool of PARTICLE_CAPACITY particles, no allocation once it's declared.  Each field is its own array so
+//  the update loops each run down one or two arrays.  Live particles are kept packed at the front: spawning
+//  appends, killing moves the last live particle into the gap, both O(1), and the loops never have to skip dead
+//  ones.  The spare capacity past the count is the free list.
+//
+//  Positions and velocities are in 256ths of a canvas pixel, velocities per step.  A particle dies when its life
+//  runs out or it leaves the canvas, and fades out over its last PARTICLE_FADE_STEPS steps.  Splatting adds each
+//  particle's colour onto its canvas pixel, saturating, so overlapping particles brighten.
+//
+
+#define PARTICLE_CAPACITY 2048
+#define PARTICLE_FADE_STEPS 32
+
+//  One canvas pixel in position units
+#define PARTICLE_ONE 256
+
+struct ParticleSystem
+{
+    int count;
+
+    //  Added to every particle's vertical velocity each step
+    int16_t gravity;
+
+    int32_t x[PARTICLE_CAPACITY];
+    int32_t y[PARTICLE_CAPACITY];
+    int16_t vx[PARTICLE_CAPACITY];
+    int16_t vy[PARTICLE_CAPACITY];
+
+    //  GRB at full brightness
+    int colour[PARTICLE_CAPACITY];
+
+    //  Steps left
+    uint16_t life[PARTICLE_CAPACITY];
+};
+
+void ParticleSystemInit(struct ParticleSystem* system, int16_t gravity);
+
+//  Index of the new particle, or -1 when the pool is full
+int ParticleSpawn(struct ParticleSystem* system, int32_t x, int32_t y, int16_t vx, int16_t vy, int colour,
+                  uint16_t life);
+
+void ParticleKill(struct ParticleSystem* system, int index);
+
+//  Move everything one step and drop the particles that died or left a width by height canvas
+void ParticleUpdate(struct ParticleSystem* system, int width, int height);
+
+//  Add every particle onto a width by height canvas
+void ParticleSplat(const struct ParticleSystem* system, int* canvas, int width, int height);
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdbool.h>
+#include "pixel_format.h"
+
+const char* PixelFormatNames[PIXEL_FORMATS] = {"GRB", "RGB", "BRG", "BGR", "RBG", "GBR", "GRBW", "RGBW"};
+
+//
+//  Frame loops, PixelPackFrameGRB and so on
+//
+#define PIXEL_FORMAT_FRAME_PACKER(order)                                                                            \
+    static void PixelPackFrame##order(const int* pixels, uint32_t* words, int count)                                \
+    {                                                                                                               \
+        for (int i = 0; i < count; i++)                                                                             \
+        {                                                                                                           \
+            words[i] = PixelPack##order(pixels[i]);                                                                 \
+        }                                                                                                           \
+    }
+
+PIXEL_FORMAT_FRAME_PACKER(GRB)
+PIXEL_FORMAT_FRAME_PACKER(RGB)
+PIXEL_FORMAT_FRAME_PACKER(BRG)
+PIXEL_FORMAT_FRAME_PACKER(BGR)
+PIXEL_FORMAT_FRAME_PACKER(RBG)
+PIXEL_FORMAT_FRAME_PACKER(GBR)
+PIXEL_FORMAT_FRAME_PACKER(GRBW)
+PIXEL_FORMAT_FRAME_PACKER(RGBW)
+
+static const PixelFormatPacker PixelFormatPackers[PIXEL_FORMATS] =
+        {
+                PixelPackFrameGRB,
+                PixelPackFrameRGB,
+                PixelPackFrameBRG,
+                PixelPackFrameBGR,
+                PixelPackFrameRBG,
+                PixelPackFrameGBR,
+                PixelPackFrameGRBW,
+                PixelPackFrameRGBW
+        };
+
+//  Where each channel lands in the packed word
+struct PixelFormatLayout
+{
+    uint8_t redShift;
+    uint8_t greenShift;
+    uint8_t blueShift;
+    bool white;
+};
+
+static const struct PixelFormatLayout PixelFormatLayouts[PIXEL_FORMATS] =
+        {
+                {16, 24, 8, false},
+                {24, 16, 8, false},
+                {16, 8, 24, false},
+                {8, 16, 24, false},
+                {24, 8, 16, false},
+                {8, 24, 16, false},
+                {16, 24, 8, true},
+                {24, 16, 8, true}
+        };
+
+int PixelFormatBits(int format)
+{
+    return PixelFormatLayouts[format].white ? 32 : 24;
+}
+
+PixelFormatPacker PixelFormatGetPacker(int format)
+{
+    return format >= 0 && format < PIXEL_FORMATS ? PixelFormatPackers[format] : PixelFormatPackers[PIXEL_FORMAT_GRB];
+}
+
+int PixelFormatUnpack(int format, uint32_t word)
+{
+    const struct PixelFormatLayout* layout = &PixelFormatLayouts[format];
+    uint32_t white = layout->white ? word & 0xFF : 0;
+
+    uint32_t red = ((word >> layout->redShift) & 0xFF) + white;
+    uint32_t green = ((word >> layout->greenShift) & 0xFF) + white;
+    uint32_t blue = ((word >> layout->blueShift) & 0xFF) + white;
+
+    return (int) (green << 16 | red << 8 | blue);
+}
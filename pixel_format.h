@@ -0,0 +1,117 @@
+#ifndef PICOPIXOS_PIXEL_FORMAT_H
+#define PICOPIXOS_PIXEL_FORMAT_H
+
+#include <stdint.h>
+
+//
+//  Pixel Formats
+//
+//  The pixel buffer holds GRB ints.  A format packs one into the word the PIO shifts out, left justified, with the
+//  channels in the order the string wants them: 24 bits for three channel strings, 32 for RGBW ones, where the
+//  white channel takes the part all three colours share.
+//
+//  Every format gets its own inlined packer and its own frame loop, generated from the macros below, so picking
+//  the format is one lookup a frame and the loop over the pixels has no branches in it.
+//
+
+enum PixelFormats
+{
+    //  WS2812 family
+    PIXEL_FORMAT_GRB = 0,
+
+    PIXEL_FORMAT_RGB = 1,
+    PIXEL_FORMAT_BRG = 2,
+
+    //  APA102 and SK9822
+    PIXEL_FORMAT_BGR = 3,
+
+    PIXEL_FORMAT_RBG = 4,
+    PIXEL_FORMAT_GBR = 5,
+
+    //  SK6812 RGBW
+    PIXEL_FORMAT_GRBW = 6,
+
+    PIXEL_FORMAT_RGBW = 7,
+
+    PIXEL_FORMATS = 8
+};
+
+extern const char* PixelFormatNames[PIXEL_FORMATS];
+
+//  24 or 32
+int PixelFormatBits(int format);
+
+//  Channels of a pixel buffer value
+#define PIXEL_RED(pixel) (((uint32_t) (pixel) >> 8) & 0xFF)
+#define PIXEL_GREEN(pixel) (((uint32_t) (pixel) >> 16) & 0xFF)
+#define PIXEL_BLUE(pixel) ((uint32_t) (pixel) & 0xFF)
+
+//  Smaller of two channel values, the sign of the difference masks it in without a branch
+static inline uint32_t PixelChannelMin(uint32_t first, uint32_t second)
+{
+    int32_t difference = (int32_t) first - (int32_t) second;
+
+    return second + (difference & (difference >> 31));
+}
+
+//  Add two GRB values a channel at a time, clamping at 255, without unpacking them
+static inline int PixelAddSaturate(int first, int second)
+{
+    uint32_t outer = (uint32_t) (first & 0xFF00FF) + (uint32_t) (second & 0xFF00FF);
+    uint32_t middle = (uint32_t) (first & 0x00FF00) + (uint32_t) (second & 0x00FF00);
+
+    //  A carry out of a channel becomes all ones in it
+    uint32_t outerCarry = outer & 0x1000100;
+    uint32_t middleCarry = middle & 0x10000;
+    outer |= outerCarry - (outerCarry >> 8);
+    middle |= middleCarry - (middleCarry >> 8);
+
+    return (int) ((outer & 0xFF00FF) | (middle & 0x00FF00));
+}
+
+//  Scale the channels of a GRB value by scale / 256, scale up to 256
+static inline int PixelScale(int pixel, uint32_t scale)
+{
+    uint32_t outer = (((uint32_t) pixel & 0xFF00FF) * scale >> 8) & 0xFF00FF;
+    uint32_t middle = (((uint32_t) pixel & 0x00FF00) * scale >> 8) & 0x00FF00;
+
+    return (int) (outer | middle);
+}
+
+//
+//  Packers, PixelPackGRB(pixel) and so on
+//
+#define PIXEL_FORMAT_PACKER(order, first, second, third)                                                            \
+    static inline uint32_t PixelPack##order(int pixel)                                                              \
+    {                                                                                                               \
+        return PIXEL_##first(pixel) << 24 | PIXEL_##second(pixel) << 16 | PIXEL_##third(pixel) << 8;                \
+    }
+
+#define PIXEL_FORMAT_PACKER_WHITE(order, first, second, third)                                                      \
+    static inline uint32_t PixelPack##order(int pixel)                                                              \
+    {                                                                                                               \
+        uint32_t white = PixelChannelMin(PixelChannelMin(PIXEL_RED(pixel), PIXEL_GREEN(pixel)), PIXEL_BLUE(pixel)); \
+                                                                                                                    \
+        return (PIXEL_##first(pixel) - white) << 24 | (PIXEL_##second(pixel) - white) << 16 |                       \
+               (PIXEL_##third(pixel) - white) << 8 | white;                                                         \
+    }
+
+PIXEL_FORMAT_PACKER(GRB, GREEN, RED, BLUE)
+PIXEL_FORMAT_PACKER(RGB, RED, GREEN, BLUE)
+PIXEL_FORMAT_PACKER(BRG, BLUE, RED, GREEN)
+PIXEL_FORMAT_PACKER(BGR, BLUE, GREEN, RED)
+PIXEL_FORMAT_PACKER(RBG, RED, BLUE, GREEN)
+PIXEL_FORMAT_PACKER(GBR, GREEN, BLUE, RED)
+PIXEL_FORMAT_PACKER_WHITE(GRBW, GREEN, RED, BLUE)
+PIXEL_FORMAT_PACKER_WHITE(RGBW, RED, GREEN, BLUE)
+
+//  Pack count pixels into words
+typedef void (*PixelFormatPacker)(const int* pixels, uint32_t* words, int count);
+
+//  The frame loop for format, look it up once a frame
+PixelFormatPacker PixelFormatGetPacker(int format);
+
+//  A packed word back to a pixel buffer value, white mixed back into the colours
+int PixelFormatUnpack(int format, uint32_t word);
+
+#endif
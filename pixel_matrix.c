@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include "pixel_matrix.h"
+
+static int PixelMatrixPanelWidth(const struct PixelMatrixLayout* layout)
+{
+    return layout->tileWidth * layout->tilesAcross;
+}
+
+static int PixelMatrixPanelHeight(const struct PixelMatrixLayout* layout)
+{
+    return layout->tileHeight * layout->tilesDown;
+}
+
+int PixelMatrixWidth(const struct PixelMatrixLayout* layout)
+{
+    return layout->rotation & 1 ? PixelMatrixPanelHeight(layout) : PixelMatrixPanelWidth(layout);
+}
+
+int PixelMatrixHeight(const struct PixelMatrixLayout* layout)
+{
+    return layout->rotation & 1 ? PixelMatrixPanelWidth(layout) : PixelMatrixPanelHeight(layout);
+}
+
+int PixelMatrixIndex(const struct PixelMatrixLayout* layout, int x, int y)
+{
+    int panelWidth = PixelMatrixPanelWidth(layout);
+    int panelHeight = PixelMatrixPanelHeight(layout);
+
+    //  Canvas to panel
+    int panelX;
+    int panelY;
+    switch (layout->rotation & 3)
+    {
+        case 0:
+            panelX = x;
+            panelY = y;
+            break;
+
+        case 1:
+            panelX = panelWidth - 1 - y;
+            panelY = x;
+            break;
+
+        case 2:
+            panelX = panelWidth - 1 - x;
+            panelY = panelHeight - 1 - y;
+            break;
+
+        default:
+            panelX = y;
+            panelY = panelHeight - 1 - x;
+            break;
+    }
+
+    //  Which tile, and where in it
+    int tileX = panelX / layout->tileWidth;
+    int tileY = panelY / layout->tileHeight;
+    int localX = panelX % layout->tileWidth;
+    int localY = panelY % layout->tileHeight;
+
+    if ((layout->flags & PIXEL_MATRIX_TILE_SERPENTINE) && (tileY & 1))
+    {
+        tileX = layout->tilesAcross - 1 - tileX;
+    }
+
+    int tile = tileY * layout->tilesAcross + tileX;
+
+    //  Along the wire inside the tile
+    int line = localY;
+    int along = localX;
+    int lineLength = layout->tileWidth;
+    if (layout->flags & PIXEL_MATRIX_COLUMNS)
+    {
+        line = localX;
+        along = localY;
+        lineLength = layout->tileHeight;
+    }
+
+    if ((layout->flags & PIXEL_MATRIX_SERPENTINE) && (line & 1))
+    {
+        along = lineLength - 1 - along;
+    }
+
+    return tile * layout->tileWidth * layout->tileHeight + line * lineLength + along;
+}
+
+bool PixelMatrixInit(struct PixelMatrixStruct* matrix, const struct PixelMatrixLayout* layout, int pixelCount)
+{
+    matrix->table = NULL;
+    matrix->width = 0;
+    matrix->height = 0;
+
+    int cells = PixelMatrixWidth(layout) * PixelMatrixHeight(layout);
+    if (cells == 0 || cells > pixelCount || cells > PIXEL_MATRIX_MAX_CELLS)
+    {
+        return false;
+    }
+
+    matrix->table = malloc(sizeof(uint16_t) * cells);
+    if (matrix->table == NULL)
+    {
+        return false;
+    }
+
+    matrix->layout = *layout;
+    matrix->width = PixelMatrixWidth(layout);
+    matrix->height = PixelMatrixHeight(layout);
+
+    for (int y = 0; y < matrix->height; y++)
+    {
+        for (int x = 0; x < matrix->width; x++)
+        {
+            matrix->table[y * matrix->width + x] = (uint16_t) PixelMatrixIndex(layout, x, y);
+        }
+    }
+
+    return true;
+}
+
+void PixelMatrixFree(struct PixelMatrixStruct* matrix)
+{
+    free(matrix->table);
+    matrix->table = NULL;
+    matrix->width = 0;
+    matrix->height = 0;
+}
+
+void PixelMatrixPresent(const struct PixelMatrixStruct* matrix, const int* canvas, int* pixels)
+{
+    const uint16_t* table = matrix->table;
+    int cells = matrix->width * matrix->height;
+
+    //  Reads run along the canvas, the table only scatters the writes
+    for (int i = 0; i < cells; i++)
+    {
+        pixels[table[i]] = canvas[i];
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef PICOPIXOS_PIXEL_MATRIX_H
+#define PICOPIXOS_PIXEL_MATRIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Pixel Matrix
+//
+//  Lays the string out as a panel of tiles so effects can draw in x and y.  Effects render into a canvas, a
+//  width by height array of GRB ints in row order with (0, 0) top left, and PixelMatrixPresent scatters it into
+//  the pixel buffer in wire order through a table worked out once when the layout is set.
+//
+//  Tiles are wired one after another along rows of tiles from the top left.  Inside a tile the wire runs along
+//  rows from its top left, or down columns with PIXEL_MATRIX_COLUMNS.  Rotation turns the picture on the panel,
+//  a quarter turn swaps the canvas width and height.
+//
+//  A plain strip is one tile, the string's length wide and one high.
+//
+
+//  Every other row (or column) of a tile runs back the other way
+#define PIXEL_MATRIX_SERPENTINE 0x01
+
+//  The wire runs down the columns of a tile instead of along its rows
+#define PIXEL_MATRIX_COLUMNS 0x02
+
+//  Every other row of tiles runs back right to left
+#define PIXEL_MATRIX_TILE_SERPENTINE 0x04
+
+//  Table entries are 16 bit
+#define PIXEL_MATRIX_MAX_CELLS 65535
+
+struct PixelMatrixLayout
+{
+    //  LEDs in one tile
+    uint16_t tileWidth;
+    uint16_t tileHeight;
+
+    //  Tiles in the panel
+    uint8_t tilesAcross;
+    uint8_t tilesDown;
+
+    //  PIXEL_MATRIX_ flags
+    uint8_t flags;
+
+    //  Quarter turns clockwise of the picture, 0 to 3
+    uint8_t rotation;
+};
+
+struct PixelMatrixStruct
+{
+    struct PixelMatrixLayout layout;
+
+    //  Canvas size, after rotation
+    int width;
+    int height;
+
+    //  Wire index of each canvas cell, in canvas order
+    uint16_t* table;
+};
+
+//  Canvas size of a layout
+int PixelMatrixWidth(const struct PixelMatrixLayout* layout);
+int PixelMatrixHeight(const struct PixelMatrixLayout* layout);
+
+//  Wire index of canvas cell x, y worked out from scratch, what the table holds
+int PixelMatrixIndex(const struct PixelMatrixLayout* layout, int x, int y);
+
+//  Build the table for a layout over pixelCount pixels, false if the panel doesn't fit the string
+bool PixelMatrixInit(struct PixelMatrixStruct* matrix, const struct PixelMatrixLayout* layout, int pixelCount);
+
+void PixelMatrixFree(struct PixelMatrixStruct* matrix);
+
+//  Wire index of canvas cell x, y, for drawing straight into the pixel buffer
+static inline int PixelMatrixIndexAt(const struct PixelMatrixStruct* matrix, int x, int y)
+{
+    return matrix->table[y * matrix->width + x];
+}
+
+//  Copy a canvas into the pixel buffer in wire order, pixels past the panel are left alone
+void PixelMatrixPresent(const struct PixelMatrixStruct* matrix, const int* canvas, int* pixels);
+
+#endif
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pixel_monitor.h"
+
+const char* PixelMonitorSampleNames[3] = {"AVG", "MIN", "MAX"};
+
+//  Largest escape sequence + glyph emitted for a single cell
+const int PIXEL_MONITOR_MAX_CELL_BYTES = 64;
+
+//  Shadow value for a cell that has never been drawn
+const uint32_t PIXEL_MONITOR_INVALID = 0xFFFFFFFF;
+
+void PixelMonitorInit(struct PixelMonitorSettings* monitor)
+{
+    monitor->pageOffset = 0;
+    monitor->zoomLevel = 0;
+    monitor->sampleMode = MONITOR_SAMPLE_AVG;
+
+    monitor->nextCell = 0;
+    monitor->shadowCells = 0;
+    monitor->shadow = NULL;
+    monitor->invalidate = true;
+}
+
+int PixelMonitorSpanFor(const struct PixelMonitorSettings* monitor, int pixelCount, int halfCells)
+{
+    //  Zoom level 0 fits the whole buffer on one page
+    int span = (pixelCount + halfCells - 1) / halfCells;
+
+    span >>= monitor->zoomLevel;
+
+    if (span < 1)
+    {
+        span = 1;
+    }
+
+    return span;
+}
+
+//
+//  Scale a masked buffer channel up to something visible on the terminal
+//
+static inline uint32_t PixelMonitorScale(uint32_t channel, int brightLevel)
+{
+    channel <<= brightLevel;
+    return (channel > 0xFF) ? 0xFF : channel;
+}
+
+uint32_t PixelMonitorSample(const struct PixelMonitorSettings* monitor, const int* pixels, int pixelCount,
+                            int start, int span, int brightLevel)
+{
+    int end = start + span;
+    if (end > pixelCount)
+    {
+        end = pixelCount;
+    }
+
+    //  Past the end of the string shows as black
+    if (start >= end)
+    {
+        return 0;
+    }
+
+    uint32_t redResult = (monitor->sampleMode == MONITOR_SAMPLE_MIN) ? 0xFF : 0;
+    uint32_t greenResult = redResult;
+    uint32_t blueResult = redResult;
+
+    for (int i = start; i < end; i++)
+    {
+        //  Buffer values are GRB
+        uint32_t red = (pixels[i] & 0x00FF00) >> 8;
+        uint32_t green = (pixels[i] & 0xFF0000) >> 16;
+        uint32_t blue = (pixels[i] & 0x0000FF);
+
+        switch (monitor->sampleMode)
+        {
+            case MONITOR_SAMPLE_MIN:
+                if (red < redResult) redResult = red;
+                if (green < greenResult) greenResult = green;
+                if (blue < blueResult) blueResult = blue;
+                break;
+
+            case MONITOR_SAMPLE_MAX:
+                if (red > redResult) redResult = red;
+                if (green > greenResult) greenResult = green;
+                if (blue > blueResult) blueResult = blue;
+                break;
+
+            default:
+                redResult += red;
+                greenResult += green;
+                blueResult += blue;
+                break;
+        }
+    }
+
+    if (monitor->sampleMode == MONITOR_SAMPLE_AVG)
+    {
+        redResult /= (end - start);
+        greenResult /= (end - start);
+        blueResult /= (end - start);
+    }
+
+    return  (PixelMonitorScale(redResult, brightLevel) << 16)   |
+            (PixelMonitorScale(greenResult, brightLevel) << 8)  |
+            (PixelMonitorScale(blueResult, brightLevel));
+}
+
+int BuildPixelMonitorFrame(struct PixelMonitorSettings* monitor, const int* pixels, int pixelCount, int brightLevel,
+                           char* buffer, int bufferSize, int row, int column, int width, int height)
+{
+    int length = 0;
+
+    //  First row is the view information, the rest are pixel cells
+    int cellRows = height - 1;
+    int cells = width * cellRows;
+    int halfCells = cells * 2;
+
+    if (cellRows < 1 || width < 1 || pixels == NULL)
+    {
+        return 0;
+    }
+
+    //  Size the shadow buffer to the monitor area
+    if (monitor->shadowCells != cells)
+    {
+        free(monitor->shadow);
+        monitor->shadow = malloc(sizeof(uint32_t) * cells * 2);
+        monitor->shadowCells = cells;
+        monitor->invalidate = true;
+    }
+
+    int span = PixelMonitorSpanFor(monitor, pixelCount, halfCells);
+
+    //  Redraw everything, including the information line
+    if (monitor->invalidate)
+    {
+        for (int i = 0; i < cells * 2; i++)
+        {
+            monitor->shadow[i] = PIXEL_MONITOR_INVALID;
+        }
+
+        int lastPixel = monitor->pageOffset + span * halfCells;
+        if (lastPixel > pixelCount)
+        {
+            lastPixel = pixelCount;
+        }
+
+        //  Padded out to the monitor's width rather than erasing the line, which would take the borders and
+        //  anything beside the monitor with it
+        char info[80];
+        snprintf(info, sizeof(info), "Pixels %i-%i of %i  %i:1 %s", monitor->pageOffset, lastPixel - 1,
+                 pixelCount, span, PixelMonitorSampleNames[monitor->sampleMode]);
+        length += snprintf(buffer + length, bufferSize - length, "\x1b[%u;%uH\x1b[0m%-*.*s", row, column, width, width,
+                           info);
+
+        monitor->nextCell = 0;
+        monitor->invalidate = false;
+    }
+
+    //  Colors currently set on the terminal, and where the cursor was left
+    uint32_t lastForeground = PIXEL_MONITOR_INVALID;
+    uint32_t lastBackground = PIXEL_MONITOR_INVALID;
+    int lastCell = -2;
+
+    //  Walk the cells once, starting from where the last refresh ran out of budget
+    for (int n = 0; n < cells; n++)
+    {
+        int cell = (monitor->nextCell + n) % cells;
+        int cellRow = cell / width;
+        int cellColumn = cell % width;
+
+        //  Each cell row shows two lines of the string, top half then bottom half
+        int topStart = monitor->pageOffset + (cellRow * 2 * width + cellColumn) * span;
+        int bottomStart = topStart + width * span;
+
+        uint32_t top = PixelMonitorSample(monitor, pixels, pixelCount, topStart, span, brightLevel);
+        uint32_t bottom = PixelMonitorSample(monitor, pixels, pixelCount, bottomStart, span, brightLevel);
+
+        if (monitor->shadow[cell * 2] == top && monitor->shadow[cell * 2 + 1] == bottom)
+        {
+            continue;
+        }
+
+        //  Out of budget, pick up from here on the next refresh
+        if (length + PIXEL_MONITOR_MAX_CELL_BYTES > bufferSize)
+        {
+            monitor->nextCell = cell;
+            break;
+        }
+
+        if (cell != lastCell + 1 || cellColumn == 0)
+        {
+            length += snprintf(buffer + length, bufferSize - length, "\x1b[%u;%uH", row + 1 + cellRow, column + cellColumn);
+        }
+
+        if (top != lastForeground)
+        {
+            length += snprintf(buffer + length, bufferSize - length, "\x1b[38;2;%u;%u;%um",
+                               (unsigned int) (top >> 16), (unsigned int) (top >> 8) & 0xFF, (unsigned int) top & 0xFF);
+            lastForeground = top;
+        }
+
+        if (bottom != lastBackground)
+        {
+            length += snprintf(buffer + length, bufferSize - length, "\x1b[48;2;%u;%u;%um",
+                               (unsigned int) (bottom >> 16), (unsigned int) (bottom >> 8) & 0xFF, (unsigned int) bottom & 0xFF);
+            lastBackground = bottom;
+        }
+
+        length += snprintf(buffer + length, bufferSize - length, "▀");
+
+        monitor->shadow[cell * 2] = top;
+        monitor->shadow[cell * 2 + 1] = bottom;
+        lastCell = cell;
+    }
+
+    return length;
+}
@@ -0,0 +1,59 @@
+#ifndef PICOPIXOS_PIXEL_MONITOR_H
+#define PICOPIXOS_PIXEL_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Pixel Monitor
+//
+//  Shows the pixel buffer using half-block glyphs, two pixels per character cell (top pixel in the foreground,
+//  bottom pixel in the background).  Strings longer than the screen are downsampled, and each refresh only
+//  sends cells that changed, capped at PIXEL_MONITOR_BYTE_BUDGET bytes so long strings can't flood the serial link.
+//
+
+//  Downsampling modes for when several pixels land in one half cell
+enum PixelMonitorSampleModes
+{
+    MONITOR_SAMPLE_AVG = 0,
+    MONITOR_SAMPLE_MIN = 1,
+    MONITOR_SAMPLE_MAX = 2
+};
+
+extern const char* PixelMonitorSampleNames[3];
+
+//  Bytes allowed per monitor refresh, includes escape codes
+#define PIXEL_MONITOR_BYTE_BUDGET 2048
+
+struct PixelMonitorSettings
+{
+    //
+    //  View Controls
+    //
+    int pageOffset;
+    int zoomLevel;
+    int sampleMode;
+
+    //
+    //  Refresh State
+    //
+    int nextCell;
+    int shadowCells;
+    uint32_t* shadow;
+    bool invalidate;
+};
+
+void PixelMonitorInit(struct PixelMonitorSettings* monitor);
+
+//  Pixels covered by a single half cell at the monitor's zoom level
+int PixelMonitorSpanFor(const struct PixelMonitorSettings* monitor, int pixelCount, int halfCells);
+
+//  Reduce span pixels starting at start into one displayable 0xRRGGBB value, channels scaled up by brightLevel bits
+uint32_t PixelMonitorSample(const struct PixelMonitorSettings* monitor, const int* pixels, int pixelCount,
+                            int start, int span, int brightLevel);
+
+//  Build one refresh worth of monitor output for the area at row, column into buffer, returns number of bytes written
+int BuildPixelMonitorFrame(struct PixelMonitorSettings* monitor, const int* pixels, int pixelCount, int brightLevel,
+                           char* buffer, int bufferSize, int row, int column, int width, int height);
+
+#endif
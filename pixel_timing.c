@@ -0,0 +1,90 @@
+#include "pixel_timing.h"
+
+//  Only the instructions are wanted here, not the SDK side of the header
+#ifndef PICO_NO_HARDWARE
+#define PICO_NO_HARDWARE 1
+#endif
+#include "ws2812/generated/ws2812.pio.h"
+#include "apa102/generated/apa102.pio.h"
+
+//
+//  Splits at the bit rate give (T0H, T1H, T0L, T1L):
+//
+//      WS2812B         375, 875, 875, 375 ns
+//      WS2811 400k     500, 1250, 2000, 1250 ns
+//      SK6812          250, 625, 1000, 625 ns
+//      WS2813          375, 875, 875, 375 ns
+//      WS2812B fast    250, 625, 750, 375 ns, 1 us a bit, 20% less wire time
+//
+//  WS2812B's 0.4 us T0H is taken as three cycles rather than two: at 125 MHz the divider isn't whole, and two
+//  cycles jitter a couple of ns under the datasheet's 250 ns floor.
+//
+//  WS2812B fast can't meet the datasheet at 1 MHz with any split, a 250 ns T0H leaves T0L under its 700 ns floor.
+//  It's held to what WS2812 and WS2812B parts have been measured to read instead (pixwave's "ws2812b-measured"):
+//  a high over about 550 ns is a one and under about 500 ns a zero, and a low only has to end before the ~5 us
+//  the LED takes as a latch.  Characterise the parts on the string before using it.
+//
+//  A clocked pixel is its 8 bit header and 24 bits of colour at two state machine cycles a bit, plus a cycle
+//  waiting for the next: 3.25 us at 10 MHz against 30 us for a WS2812B.
+//
+const struct PixelTimingProfile PixelTimingProfiles[PIXEL_TIMING_PROFILES] =
+        {
+                {"WS2812B", 800000, 3, 4, 3, 50, PIXEL_PROTOCOL_WS2812, PIXEL_FORMAT_GRB},
+                {"WS2811 400k", 400000, 2, 3, 5, 50, PIXEL_PROTOCOL_WS2812, PIXEL_FORMAT_RGB},
+                {"SK6812", 800000, 2, 3, 5, 80, PIXEL_PROTOCOL_WS2812, PIXEL_FORMAT_GRB},
+                {"WS2813", 800000, 3, 4, 3, 280, PIXEL_PROTOCOL_WS2812, PIXEL_FORMAT_GRB},
+                {"WS2812B fast", 1000000, 2, 3, 3, 50, PIXEL_PROTOCOL_WS2812, PIXEL_FORMAT_GRB},
+                {"APA102", 10000000, 0, 0, 0, 0, PIXEL_PROTOCOL_APA102, PIXEL_FORMAT_BGR},
+                {"APA102 20M", 20000000, 0, 0, 0, 0, PIXEL_PROTOCOL_APA102, PIXEL_FORMAT_BGR}
+        };
+
+//  Delay field, under the one side-set bit
+#define PIXEL_TIMING_DELAY_MASK 0x0F00
+#define PIXEL_TIMING_DELAY_SHIFT 8
+
+static uint16_t PixelTimingDelay(uint16_t instruction, int cycles)
+{
+    return (instruction & ~PIXEL_TIMING_DELAY_MASK) | ((cycles - 1) << PIXEL_TIMING_DELAY_SHIFT);
+}
+
+void PixelTimingProgram(const struct PixelTimingProfile* profile, uint16_t instructions[PIXEL_TIMING_PROGRAM_LENGTH])
+{
+    //  out [T3 - 1], jmp !x [T1 - 1], jmp [T2 - 1], nop [T2 - 1]
+    instructions[0] = PixelTimingDelay(ws2812_program_instructions[0], profile->t3);
+    instructions[1] = PixelTimingDelay(ws2812_program_instructions[1], profile->t1);
+    instructions[2] = PixelTimingDelay(ws2812_program_instructions[2], profile->t2);
+    instructions[3] = PixelTimingDelay(ws2812_program_instructions[3], profile->t2);
+}
+
+void PixelTimingClockedProgram(uint32_t brightness, uint16_t instructions[PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH])
+{
+    for (int i = 0; i < PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH; i++)
+    {
+        instructions[i] = apa102_program_instructions[i];
+    }
+
+    //  set pins, bit in the low 5 bits of each SET
+    for (int bit = 0; bit < 5; bit++)
+    {
+        uint16_t* set = &instructions[apa102_offset_brightness + 2 * bit];
+        *set = (*set & ~0x1F) | ((brightness >> (4 - bit)) & 1);
+    }
+}
+
+uint32_t PixelTimingClockedFrameBits(uint32_t pixelCount)
+{
+    //  Data runs half a clock later at each LED, so the end frame needs a clock for every two pixels.  The 32 zeros
+    //  before it are the SK9822's reset frame, the 32 after are the next start frame.
+    return 32 + (pixelCount + 1) / 2 + 32;
+}
+
+uint32_t PixelTimingPixelNs(const struct PixelTimingProfile* profile, int bits)
+{
+    if (profile->protocol == PIXEL_PROTOCOL_APA102)
+    {
+        //  Header, then two cycles a bit and one between pixels
+        return (uint32_t) (1000000000ull * (2 * (8 + bits) + 1) / (2ull * profile->bitHz));
+    }
+
+    return (uint32_t) (1000000000ull * bits / profile->bitHz);
+}
@@ -0,0 +1,90 @@
+#ifndef PICOPIXOS_PIXEL_TIMING_H
+#define PICOPIXOS_PIXEL_TIMING_H
+
+#include <stdint.h>
+#include "pixel_format.h"
+
+//
+//  Pixel Timing Profiles
+//
+//  Each bit of the ws2812 program is t1 + t2 + t3 state machine cycles: t1 high for every bit, t2 more high
+//  for a one (low for a zero), then t3 low.  A profile picks the split and the bit rate, the clock divider
+//  follows from them, and the split is patched into the program's delay fields when it's loaded.  Each of
+//  t1, t2 and t3 has to be 1 to 16.
+//
+//  Clocked chips (APA102, SK9822) run apa102.pio instead, with the data on the LED pin and the clock on the next
+//  one up.  Their bit rate is the clock rate, the split doesn't apply and there's no reset time, a frame ends
+//  with clocks rather than an idle line.
+//
+//  tools/pixwave -P runs a profile through the PIO simulator against the LED's timing limits, ctest runs every one.
+//
+
+enum PixelTimingProfiles
+{
+    //  800 kHz 3/4/3, a cycle more T0H than ws2812.pio as shipped to stay over the datasheet floor
+    PIXEL_TIMING_WS2812B = 0,
+
+    //  WS2811 in its low speed mode
+    PIXEL_TIMING_WS2811_400K = 1,
+
+    PIXEL_TIMING_SK6812 = 2,
+
+    //  Longer T0H, and a 280 us reset
+    PIXEL_TIMING_WS2813 = 3,
+
+    //  WS2812B at 1 MHz, shortest pulses characterised parts still read reliably.  Outside the datasheet, see pixel_timing.c.
+    PIXEL_TIMING_WS2812B_FAST = 4,
+
+    //  APA102 and SK9822 clocked at 10 MHz, good for long strings
+    PIXEL_TIMING_APA102 = 5,
+
+    //  20 MHz, short strings with short wires only
+    PIXEL_TIMING_APA102_20M = 6,
+
+    PIXEL_TIMING_PROFILES = 7
+};
+
+enum PixelProtocols
+{
+    //  One wire, bits told apart by pulse width, latches on an idle line
+    PIXEL_PROTOCOL_WS2812 = 0,
+
+    //  Data and clock, 32 bit LED frames between a start and an end frame
+    PIXEL_PROTOCOL_APA102 = 1
+};
+
+struct PixelTimingProfile
+{
+    const char* name;
+    uint32_t bitHz;
+    uint8_t t1;
+    uint8_t t2;
+    uint8_t t3;
+
+    //  Low time the LEDs latch on, 0 when they don't
+    uint32_t resetUs;
+
+    int protocol;
+
+    //  Channel order the chips usually take, what choosing the profile sets the format to
+    int pixelFormat;
+};
+
+extern const struct PixelTimingProfile PixelTimingProfiles[PIXEL_TIMING_PROFILES];
+
+#define PIXEL_TIMING_PROGRAM_LENGTH 4
+
+//  The ws2812 program with the profile's cycle split in its delays
+void PixelTimingProgram(const struct PixelTimingProfile* profile, uint16_t instructions[PIXEL_TIMING_PROGRAM_LENGTH]);
+
+//  The apa102 program with brightness, 0 to 31, in its LED frame header
+#define PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH 25
+void PixelTimingClockedProgram(uint32_t brightness, uint16_t instructions[PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH]);
+
+//  Zero bits around a frame of pixelCount clocked pixels, the end of that frame and the start of the next
+uint32_t PixelTimingClockedFrameBits(uint32_t pixelCount);
+
+//  Wire time of a pixel of bits bits, in ns
+uint32_t PixelTimingPixelNs(const struct PixelTimingProfile* profile, int bits);
+
+#endif
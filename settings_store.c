@@ -0,0 +1,371 @@
+#include <stddef.h>
+#include <string.h>
+#include "hal.h"
+#include "crc.h"
+#include "settings_store.h"
+
+//  'PPXS'
+#define SETTINGS_RECORD_MAGIC 0x53585050u
+
+//  Sequence numbers of erased flash
+#define SETTINGS_ERASED 0xFFFFFFFFu
+
+struct SettingsRecordHeader
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t format;
+    uint16_t length;
+    uint32_t crc;
+};
+
+//  Records are padded to whole pages so each one is a single program operation
+#define SETTINGS_RECORD_SIZE ((sizeof(struct SettingsRecordHeader) + SETTINGS_STORE_MAX_PAYLOAD + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE * HAL_FLASH_PAGE_SIZE)
+#define SETTINGS_RECORDS_PER_SECTOR ((int) (HAL_FLASH_SECTOR_SIZE / SETTINGS_RECORD_SIZE))
+
+struct SettingsStoreStatus CurrentSettingsStore;
+
+uint32_t SettingsStoreFlashOffset()
+{
+    return HAL_FLASH_SIZE - SETTINGS_STORE_SECTORS * HAL_FLASH_SECTOR_SIZE;
+}
+
+static inline const struct SettingsRecordHeader* SettingsRecordAt(int sector, int slot)
+{
+    return (const struct SettingsRecordHeader*) HalFlashRead(SettingsStoreFlashOffset() +
+                                                             sector * HAL_FLASH_SECTOR_SIZE + slot * SETTINGS_RECORD_SIZE);
+}
+
+static uint32_t SettingsRecordCrc(const struct SettingsRecordHeader* record)
+{
+    //  Everything but the CRC field itself
+    uint32_t crc = Crc32Update(CRC32_INITIAL, (const uint8_t*) record, offsetof(struct SettingsRecordHeader, crc));
+    crc = Crc32Update(crc, (const uint8_t*) (record + 1), record->length);
+    return Crc32Final(crc);
+}
+
+static bool SettingsRecordValid(const struct SettingsRecordHeader* record)
+{
+    return  record->magic == SETTINGS_RECORD_MAGIC &&
+            record->format == SETTINGS_RECORD_FORMAT &&
+            record->length <= SETTINGS_STORE_MAX_PAYLOAD &&
+            record->crc == SettingsRecordCrc(record);
+}
+
+//
+//  Latest intact record in a sector, or -1.  Slots fill in order so the scan stops at the first erased one.
+//
+static int SettingsNewestSlot(int sector)
+{
+    int newest = -1;
+
+    for (int slot = 0; slot < SETTINGS_RECORDS_PER_SECTOR; slot++)
+    {
+        const struct SettingsRecordHeader* record = SettingsRecordAt(sector, slot);
+
+        if (record->sequence == SETTINGS_ERASED && record->magic == SETTINGS_ERASED)
+        {
+            break;
+        }
+
+        if (SettingsRecordValid(record))
+        {
+            newest = slot;
+        }
+    }
+
+    return newest;
+}
+
+//
+//  Highest sequence number written into a sector, damaged records included
+//
+static uint32_t SettingsHighestSequence(int sector)
+{
+    uint32_t highest = 0;
+
+    for (int slot = 0; slot < SETTINGS_RECORDS_PER_SECTOR; slot++)
+    {
+        const struct SettingsRecordHeader* record = SettingsRecordAt(sector, slot);
+
+        if (record->sequence == SETTINGS_ERASED && record->magic == SETTINGS_ERASED)
+        {
+            break;
+        }
+
+        if (record->magic == SETTINGS_RECORD_MAGIC && record->sequence != SETTINGS_ERASED &&
+            record->sequence > highest)
+        {
+            highest = record->sequence;
+        }
+    }
+
+    return highest;
+}
+
+const void* SettingsStoreLoad(uint16_t* length)
+{
+    CurrentSettingsStore.found = false;
+    CurrentSettingsStore.sequence = 0;
+    CurrentSettingsStore.sector = SETTINGS_STORE_SECTORS - 1;
+    CurrentSettingsStore.slot = SETTINGS_RECORDS_PER_SECTOR - 1;
+    CurrentSettingsStore.nextSequence = 0;
+
+    //  The sector whose first record has the highest sequence holds the newest records
+    int order[SETTINGS_STORE_SECTORS];
+    int count = 0;
+
+    for (int sector = 0; sector < SETTINGS_STORE_SECTORS; sector++)
+    {
+        const struct SettingsRecordHeader* first = SettingsRecordAt(sector, 0);
+
+        if (first->magic != SETTINGS_RECORD_MAGIC || first->sequence == SETTINGS_ERASED)
+        {
+            continue;
+        }
+
+        //  Insert by descending first sequence
+        int position = count++;
+        while (position > 0 && SettingsRecordAt(order[position - 1], 0)->sequence < first->sequence)
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = sector;
+    }
+
+    //  Whatever is found, new records carry on from the newest sector with higher sequence numbers, so a damaged
+    //  sector can never come back out ahead of them at the next boot.  Unless that sector turns out to hold the
+    //  record loaded, writing starts in the sector after it.
+    if (count > 0)
+    {
+        CurrentSettingsStore.sector = order[0];
+        CurrentSettingsStore.nextSequence = SettingsHighestSequence(order[0]) + 1;
+    }
+
+    //  Newest sector first, falling back to older ones if it only has damaged records
+    for (int i = 0; i < count; i++)
+    {
+        int slot = SettingsNewestSlot(order[i]);
+
+        if (slot >= 0)
+        {
+            const struct SettingsRecordHeader* record = SettingsRecordAt(order[i], slot);
+
+            CurrentSettingsStore.found = true;
+            CurrentSettingsStore.sequence = record->sequence;
+
+            //  New records go after the newest sector's last used slot, intact or not
+            if (i == 0)
+            {
+                CurrentSettingsStore.slot = slot;
+                while (CurrentSettingsStore.slot + 1 < SETTINGS_RECORDS_PER_SECTOR &&
+                       SettingsRecordAt(order[0], CurrentSettingsStore.slot + 1)->magic != SETTINGS_ERASED)
+                {
+                    CurrentSettingsStore.slot++;
+                }
+            }
+
+            *length = record->length;
+            return record + 1;
+        }
+    }
+
+    return NULL;
+}
+
+bool SettingsStoreCommit(const void* data, uint16_t length)
+{
+    static uint8_t page[SETTINGS_RECORD_SIZE];
+
+    if (length > SETTINGS_STORE_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    //  Next slot in the ring
+    int sector = CurrentSettingsStore.sector;
+    int slot = CurrentSettingsStore.slot + 1;
+    bool erase = false;
+
+    if (slot >= SETTINGS_RECORDS_PER_SECTOR)
+    {
+        sector = (sector + 1) % SETTINGS_STORE_SECTORS;
+        slot = 0;
+        erase = true;
+    }
+
+    //  Build the record
+    struct SettingsRecordHeader* record = (struct SettingsRecordHeader*) page;
+    memset(page, 0xFF, sizeof(page));
+    record->magic = SETTINGS_RECORD_MAGIC;
+    record->sequence = CurrentSettingsStore.nextSequence++;
+    record->format = SETTINGS_RECORD_FORMAT;
+    record->length = length;
+    memcpy(record + 1, data, length);
+    record->crc = SettingsRecordCrc(record);
+
+    //  Only program as many pages as the record needs
+    uint32_t programLength = (sizeof(struct SettingsRecordHeader) + length + HAL_FLASH_PAGE_SIZE - 1) / HAL_FLASH_PAGE_SIZE * HAL_FLASH_PAGE_SIZE;
+    uint32_t offset = SettingsStoreFlashOffset() + sector * HAL_FLASH_SECTOR_SIZE + slot * SETTINGS_RECORD_SIZE;
+
+    //  Nothing can run from flash while it's busy
+    HalCoreLockoutStart();
+
+    if (erase)
+    {
+        HalFlashErase(SettingsStoreFlashOffset() + sector * HAL_FLASH_SECTOR_SIZE, HAL_FLASH_SECTOR_SIZE);
+    }
+    HalFlashProgram(offset, page, programLength);
+
+    HalCoreLockoutEnd();
+
+    if (erase)
+    {
+        CurrentSettingsStore.erases++;
+    }
+
+    //  Read it back
+    if (!SettingsRecordValid(SettingsRecordAt(sector, slot)))
+    {
+        //  Skip the bad slot next time
+        CurrentSettingsStore.sector = sector;
+        CurrentSettingsStore.slot = slot;
+        return false;
+    }
+
+    CurrentSettingsStore.found = true;
+    CurrentSettingsStore.sequence = record->sequence;
+    CurrentSettingsStore.sector = sector;
+    CurrentSettingsStore.slot = slot;
+    CurrentSettingsStore.commits++;
+
+    return true;
+}
+
+//
+//  Boot Frame
+//
+
+//  'PPXB'
+#define BOOT_FRAME_MAGIC 0x42585050u
+
+struct BootFrameHeader
+{
+    uint32_t magic;
+    uint32_t pixelCount;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+static inline uint32_t BootFrameFlashOffset()
+{
+    return SettingsStoreFlashOffset() - BOOT_FRAME_SECTORS * HAL_FLASH_SECTOR_SIZE;
+}
+
+//
+//  Stored boot frame header, or NULL if there isn't an intact one
+//
+static const struct BootFrameHeader* BootFrameFind()
+{
+    const struct BootFrameHeader* header = (const struct BootFrameHeader*) HalFlashRead(BootFrameFlashOffset());
+
+    if (header->magic != BOOT_FRAME_MAGIC || header->pixelCount > BOOT_FRAME_MAX_PIXELS ||
+        header->crc != Crc32((const uint8_t*) (header + 1), header->pixelCount * 3))
+    {
+        return NULL;
+    }
+
+    return header;
+}
+
+int BootFrameLoad(int* pixels, int size)
+{
+    const struct BootFrameHeader* header = BootFrameFind();
+
+    if (header == NULL)
+    {
+        return 0;
+    }
+
+    //  Packed G, R, B, the same order as the pixel buffer values
+    const uint8_t* data = (const uint8_t*) (header + 1);
+
+    int count = (header->pixelCount < (uint32_t) size) ? (int) header->pixelCount : size;
+
+    for (int i = 0; i < count; i++, data += 3)
+    {
+        pixels[i] = (data[0] << 16) | (data[1] << 8) | data[2];
+    }
+
+    return count;
+}
+
+bool BootFrameSave(const int* pixels, int count)
+{
+    static uint8_t page[HAL_FLASH_PAGE_SIZE];
+
+    if (count > BOOT_FRAME_MAX_PIXELS)
+    {
+        count = BOOT_FRAME_MAX_PIXELS;
+    }
+
+    uint32_t length = sizeof(struct BootFrameHeader) + count * 3;
+    uint32_t eraseLength = (length + HAL_FLASH_SECTOR_SIZE - 1) / HAL_FLASH_SECTOR_SIZE * HAL_FLASH_SECTOR_SIZE;
+
+    //  Other core is held from here on, so the pixels can't change under us
+    HalCoreLockoutStart();
+
+    //  CRC over the packed pixels, it goes in the header which is written first
+    uint32_t crc = CRC32_INITIAL;
+    for (int i = 0; i < count; i++)
+    {
+        crc = Crc32UpdateByte(crc, (pixels[i] >> 16) & 0xFF);
+        crc = Crc32UpdateByte(crc, (pixels[i] >> 8) & 0xFF);
+        crc = Crc32UpdateByte(crc, pixels[i] & 0xFF);
+    }
+
+    HalFlashErase(BootFrameFlashOffset(), eraseLength);
+
+    //  Program a page at a time, packing pixels as we go
+    uint32_t written = 0;
+    int pixel = 0;
+    int channel = 0;
+
+    while (written < length)
+    {
+        memset(page, 0xFF, sizeof(page));
+        uint32_t fill = 0;
+
+        if (written == 0)
+        {
+            struct BootFrameHeader* header = (struct BootFrameHeader*) page;
+            header->magic = BOOT_FRAME_MAGIC;
+            header->pixelCount = count;
+            header->crc = Crc32Final(crc);
+            header->reserved = 0;
+            fill = sizeof(struct BootFrameHeader);
+        }
+
+        for (; fill < HAL_FLASH_PAGE_SIZE && pixel < count; fill++)
+        {
+            page[fill] = (pixels[pixel] >> (16 - 8 * channel)) & 0xFF;
+            if (++channel == 3)
+            {
+                channel = 0;
+                pixel++;
+            }
+        }
+
+        HalFlashProgram(BootFrameFlashOffset() + written, page, HAL_FLASH_PAGE_SIZE);
+
+        written += HAL_FLASH_PAGE_SIZE;
+    }
+
+    HalCoreLockoutEnd();
+
+    //  Read it back
+    const struct BootFrameHeader* header = BootFrameFind();
+
+    return header != NULL && header->pixelCount == (uint32_t) count;
+}
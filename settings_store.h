@@ -0,0 +1,68 @@
+#ifndef PICOPIXOS_SETTINGS_STORE_H
+#define PICOPIXOS_SETTINGS_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Flash Settings Store
+//
+//  Settings are appended as records to a ring of sectors reserved at the end of flash.  Each record takes a
+//  whole number of flash pages and carries a sequence number and CRC, so a commit only programs one record and
+//  a sector is only erased when the ring moves into it.  The newest intact record wins at boot.
+//
+
+//  Sectors reserved for the ring, at the very end of flash
+#define SETTINGS_STORE_SECTORS 4
+
+//  Bump when the record header layout changes
+#define SETTINGS_RECORD_FORMAT 1
+
+//  Largest payload a record can hold, keeps a record to one flash page
+#define SETTINGS_STORE_MAX_PAYLOAD 240
+
+struct SettingsStoreStatus
+{
+    bool found;
+    uint32_t sequence;
+    int sector;
+    int slot;
+
+    //  Carried by the next record, one past the highest in the ring whether that record was intact or not
+    uint32_t nextSequence;
+
+    uint32_t commits;
+    uint32_t erases;
+};
+
+extern struct SettingsStoreStatus CurrentSettingsStore;
+
+//  Scan the ring for the newest intact record, returns its payload (read straight from flash) or NULL
+const void* SettingsStoreLoad(uint16_t* length);
+
+//  Append a record.  Locks out the other core while flash is busy, which must have called
+//  HalCoreLockoutVictimInit().
+bool SettingsStoreCommit(const void* data, uint16_t length);
+
+//  Offset from the start of flash where the ring begins, anything reserved after the firmware goes below it
+uint32_t SettingsStoreFlashOffset();
+
+//
+//  Boot Frame
+//
+//  A single frame kept just below the settings ring and shown the moment the PIO is running at boot.  Saving
+//  it erases the sectors it needs, so it's written on request rather than with every settings commit.
+//
+
+#define BOOT_FRAME_SECTORS 8
+
+//  Stored 3 bytes per pixel behind a small header
+#define BOOT_FRAME_MAX_PIXELS ((BOOT_FRAME_SECTORS * 4096 - 16) / 3)
+
+//  Copy the stored boot frame into pixels (GRB values), returns the number of pixels restored, 0 if none
+int BootFrameLoad(int* pixels, int size);
+
+//  Store pixels (GRB values) as the boot frame, locks out the other core like SettingsStoreCommit
+bool BootFrameSave(const int* pixels, int count);
+
+#endif
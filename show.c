@@ -0,0 +1,216 @@
+#include <stddef.h>
+#include "show.h"
+#include "crc.h"
+
+//  Interpolation is done with 16 bit fractions
+#define SHOW_ONE 65536u
+
+static uint32_t ShowHeaderCrc(const struct ShowHeader* header)
+{
+    return Crc32((const uint8_t*) header, offsetof(struct ShowHeader, headerCrc));
+}
+
+static bool ShowTrackValid(const struct ShowStruct* show, const struct ShowTrack* track)
+{
+    const struct ShowHeader* header = show->header;
+
+    if (track->keyCount == 0 || (uint32_t) track->firstKey + track->keyCount > header->keyCount ||
+        (uint32_t) track->firstPixel + track->pixelCount > header->pixelCount)
+    {
+        return false;
+    }
+
+    //  Keys have to be in order for the search
+    const struct ShowKey* keys = show->keys + track->firstKey;
+    for (int i = 1; i < track->keyCount; i++)
+    {
+        if (keys[i].timeMs < keys[i - 1].timeMs)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ShowOpen(struct ShowStruct* show, const void* data, uint32_t available)
+{
+    const struct ShowHeader* header = (const struct ShowHeader*) data;
+
+    if (available < sizeof(struct ShowHeader))
+    {
+        return false;
+    }
+
+    if (header->magic != SHOW_MAGIC || header->format != SHOW_FORMAT ||
+        header->headerLength != sizeof(struct ShowHeader) || header->headerCrc != ShowHeaderCrc(header))
+    {
+        return false;
+    }
+
+    uint64_t dataLength = (uint64_t) header->trackCount * sizeof(struct ShowTrack) +
+                          (uint64_t) header->keyCount * sizeof(struct ShowKey);
+
+    if (header->durationMs == 0 || header->dataLength != dataLength ||
+        header->headerLength + dataLength > available)
+    {
+        return false;
+    }
+
+    const uint8_t* body = (const uint8_t*) data + header->headerLength;
+    if (Crc32(body, header->dataLength) != header->dataCrc)
+    {
+        return false;
+    }
+
+    show->header = header;
+    show->tracks = (const struct ShowTrack*) body;
+    show->keys = (const struct ShowKey*) (body + header->trackCount * sizeof(struct ShowTrack));
+
+    for (int i = 0; i < header->trackCount; i++)
+    {
+        if (!ShowTrackValid(show, &show->tracks[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ShowHeaderInit(struct ShowHeader* header, uint16_t pixelCount, uint32_t durationMs,
+                    const struct ShowTrack* tracks, uint16_t trackCount, const struct ShowKey* keys, uint32_t keyCount)
+{
+    header->magic = SHOW_MAGIC;
+    header->format = SHOW_FORMAT;
+    header->headerLength = sizeof(struct ShowHeader);
+    header->pixelCount = pixelCount;
+    header->trackCount = trackCount;
+    header->durationMs = durationMs;
+    header->keyCount = keyCount;
+    header->dataLength = trackCount * sizeof(struct ShowTrack) + keyCount * sizeof(struct ShowKey);
+
+    //  Tracks and keys are laid out back to back, so the CRC runs over both
+    uint32_t crc = Crc32Update(CRC32_INITIAL, (const uint8_t*) tracks, trackCount * sizeof(struct ShowTrack));
+    crc = Crc32Update(crc, (const uint8_t*) keys, keyCount * sizeof(struct ShowKey));
+    header->dataCrc = Crc32Final(crc);
+
+    header->headerCrc = ShowHeaderCrc(header);
+}
+
+//
+//  Shape a 0..SHOW_ONE progress by the easing curve
+//
+static uint32_t ShowEase(uint8_t easing, uint32_t progress)
+{
+    uint64_t p = progress;
+
+    switch (easing)
+    {
+        case SHOW_EASE_STEP:
+            return 0;
+
+        case SHOW_EASE_IN:
+            return (uint32_t) ((p * p) >> 16);
+
+        case SHOW_EASE_OUT:
+            return SHOW_ONE - (uint32_t) (((SHOW_ONE - p) * (SHOW_ONE - p)) >> 16);
+
+        //  Smoothstep, 3p^2 - 2p^3
+        case SHOW_EASE_IN_OUT:
+            return (uint32_t) ((p * p * (3 * SHOW_ONE - 2 * p)) >> 32);
+
+        default:
+            return progress;
+    }
+}
+
+static inline int ShowMix(uint8_t from, uint8_t to, uint32_t amount)
+{
+    return (int) ((from * (SHOW_ONE - amount) + to * amount) >> 16);
+}
+
+//
+//  Colour of a track at a time in the loop
+//
+static int ShowTrackColour(const struct ShowKey* keys, int keyCount, uint64_t timeUs)
+{
+    //  Last key at or before the time
+    int low = 0, high = keyCount - 1;
+
+    if (timeUs < (uint64_t) keys[0].timeMs * 1000)
+    {
+        high = 0;
+    }
+
+    while (low < high)
+    {
+        int middle = (low + high + 1) / 2;
+        if ((uint64_t) keys[middle].timeMs * 1000 <= timeUs)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    const struct ShowKey* from = &keys[low];
+    uint64_t fromUs = (uint64_t) from->timeMs * 1000;
+
+    //  Holding, either side of the keys or a step
+    if (low == keyCount - 1 || timeUs <= fromUs || from->easing == SHOW_EASE_STEP)
+    {
+        return from->red << 8 | from->green << 16 | from->blue;
+    }
+
+    const struct ShowKey* to = &keys[low + 1];
+    uint64_t spanUs = (uint64_t) to->timeMs * 1000 - fromUs;
+    uint32_t amount = ShowEase(from->easing, (uint32_t) (((timeUs - fromUs) << 16) / spanUs));
+
+    return ShowMix(from->red, to->red, amount) << 8 | ShowMix(from->green, to->green, amount) << 16 |
+           ShowMix(from->blue, to->blue, amount);
+}
+
+void ShowRender(const struct ShowStruct* show, uint64_t timeUs, int* pixels, int pixelCount)
+{
+    int64_t durationUs = (int64_t) show->header->durationMs * 1000;
+    int64_t loopUs = (int64_t) (timeUs % (uint64_t) durationUs);
+
+    for (int t = 0; t < show->header->trackCount; t++)
+    {
+        const struct ShowTrack* track = &show->tracks[t];
+        const struct ShowKey* keys = show->keys + track->firstKey;
+
+        int first = track->firstPixel;
+        int last = first + track->pixelCount;
+        if (last > pixelCount)
+        {
+            last = pixelCount;
+        }
+
+        //  Whole segment the same colour, work it out once
+        if (track->spreadMs == 0)
+        {
+            int colour = ShowTrackColour(keys, track->keyCount, (uint64_t) loopUs);
+            for (int i = first; i < last; i++)
+            {
+                pixels[i] = colour;
+            }
+            continue;
+        }
+
+        int64_t spreadUs = (int64_t) track->spreadMs * 1000;
+        for (int i = first; i < last; i++)
+        {
+            int64_t pixelUs = (loopUs - (i - first) * spreadUs) % durationUs;
+            if (pixelUs < 0)
+            {
+                pixelUs += durationUs;
+            }
+
+            pixels[i] = ShowTrackColour(keys, track->keyCount, (uint64_t) pixelUs);
+        }
+    }
+}
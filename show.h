@@ -0,0 +1,94 @@
+#ifndef PICOPIXOS_SHOW_H
+#define PICOPIXOS_SHOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Keyframe Show
+//
+//  A compact alternative to storing every frame: colours are keyed at points in time and everything in between
+//  is interpolated on the device at the output frame rate.
+//
+//      Offset  Size    Field
+//      0       32      struct ShowHeader (little endian)
+//      32      12 * n  trackCount struct ShowTrack
+//      ...     8 * n   keyCount struct ShowKey, each track's keys together and in time order
+//
+//  A track drives a run of pixels from one list of keys, so a single pixel or a whole segment costs the same.
+//  spreadMs delays each pixel along the run by that much, which turns one fade into a chase.  Shows loop every
+//  durationMs.  A track holds its first colour before its first key and its last after its last key.
+//  Pixels no track covers are left alone.
+//
+//  It goes in the same flash slot as a pre-rendered animation (ANIMATION_FLASH_OFFSET), the magic says which.
+//
+
+//  'PPXK'
+#define SHOW_MAGIC 0x4B585050u
+#define SHOW_FORMAT 1
+
+//  How a key eases into the one after it
+enum ShowEasing
+{
+    SHOW_EASE_STEP = 0,
+    SHOW_EASE_LINEAR = 1,
+    SHOW_EASE_IN = 2,
+    SHOW_EASE_OUT = 3,
+    SHOW_EASE_IN_OUT = 4
+};
+
+struct ShowHeader
+{
+    uint32_t magic;
+    uint16_t format;
+    uint16_t headerLength;
+    uint16_t pixelCount;
+    uint16_t trackCount;
+    uint32_t durationMs;
+    uint32_t keyCount;
+
+    //  Tracks and keys, and their CRC-32
+    uint32_t dataLength;
+    uint32_t dataCrc;
+
+    //  CRC-32 of everything above
+    uint32_t headerCrc;
+};
+
+struct ShowTrack
+{
+    uint16_t firstPixel;
+    uint16_t pixelCount;
+    uint16_t firstKey;
+    uint16_t keyCount;
+    int16_t spreadMs;
+    uint16_t reserved;
+};
+
+struct ShowKey
+{
+    uint32_t timeMs;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t easing;
+};
+
+struct ShowStruct
+{
+    const struct ShowHeader* header;
+    const struct ShowTrack* tracks;
+    const struct ShowKey* keys;
+};
+
+//  Checks a show held in available bytes at data, and points show at its parts
+bool ShowOpen(struct ShowStruct* show, const void* data, uint32_t available);
+
+//  Fill in a header for tracks and keys laid out after it, including both CRCs
+void ShowHeaderInit(struct ShowHeader* header, uint16_t pixelCount, uint32_t durationMs,
+                    const struct ShowTrack* tracks, uint16_t trackCount, const struct ShowKey* keys, uint32_t keyCount);
+
+//  Render the show at timeUs into pixels (GRB ints, as the pixel buffer holds them)
+void ShowRender(const struct ShowStruct* show, uint64_t timeUs, int* pixels, int pixelCount);
+
+#endif
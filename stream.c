@@ -0,0 +1,679 @@
+#include <string.h>
+#include "stream.h"
+#include "crc.h"
+
+static const uint8_t STREAM_SYNC[STREAM_SYNC_LENGTH] = {STREAM_SYNC_0, STREAM_SYNC_1, STREAM_SYNC_2, STREAM_SYNC_3};
+
+static inline uint16_t ReadLE16(const uint8_t* data)
+{
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+static inline uint32_t ReadLE32(const uint8_t* data)
+{
+    return  ((uint32_t) data[0])        |
+            ((uint32_t) data[1] << 8)   |
+            ((uint32_t) data[2] << 16)  |
+            ((uint32_t) data[3] << 24);
+}
+
+void StreamParserInit(struct StreamParserStruct* parser)
+{
+    parser->target = 0;
+    parser->targetSize = 0;
+    parser->reference = 0;
+    parser->image = 0;
+    parser->matrix = 0;
+
+    StreamParserReset(parser);
+    parser->text[0] = 0;
+
+    parser->framesGood = 0;
+    parser->framesBadCrc = 0;
+    parser->framesBadHeader = 0;
+    parser->framesBadDecode = 0;
+    parser->framesLost = 0;
+    parser->bytesReceived = 0;
+}
+
+void StreamParserReset(struct StreamParserStruct* parser)
+{
+    parser->state = STREAM_STATE_SYNC;
+    parser->syncMatched = 0;
+    parser->headerReceived = 0;
+    parser->decodeState = STREAM_DECODE_CONTROL;
+    parser->frameReady = false;
+    parser->textReady = false;
+    parser->deltaAllowed = false;
+
+    parser->sequenceValid = false;
+    parser->lastSequence = 0;
+}
+
+void StreamParserSetTarget(struct StreamParserStruct* parser, int* target, int targetSize)
+{
+    parser->target = target;
+    parser->targetSize = targetSize;
+}
+
+void StreamParserSetReference(struct StreamParserStruct* parser, const int* reference)
+{
+    parser->reference = reference;
+}
+
+void StreamParserSetImage(struct StreamParserStruct* parser, struct ImageDecoderStruct* image,
+                          const struct PixelMatrixStruct* matrix)
+{
+    parser->image = image;
+    parser->matrix = matrix;
+}
+
+//
+//  Check a freshly received header, returns false if the frame can't be accepted
+//
+static bool StreamAcceptHeader(struct StreamParserStruct* parser)
+{
+    parser->frameType = parser->header[4];
+    parser->sequence = ReadLE16(&parser->header[6]);
+    parser->payloadLength = ReadLE32(&parser->header[8]);
+
+    if (parser->target == 0)
+    {
+        return false;
+    }
+
+    switch (parser->frameType)
+    {
+        case STREAM_FRAME_RAW:
+            //  Whole pixels only, and no more than fit
+            if (parser->payloadLength % 3 != 0 || parser->payloadLength > (uint32_t) parser->targetSize * 3)
+            {
+                return false;
+            }
+            break;
+
+        case STREAM_FRAME_DELTA:
+            //  Needs an intact previous frame to build on
+            if (!parser->deltaAllowed || parser->reference == 0 ||
+                parser->sequence != (uint16_t) (parser->lastSequence + 1))
+            {
+                return false;
+            }
+            if (parser->payloadLength > STREAM_RLE_MAX_PAYLOAD((uint32_t) parser->targetSize))
+            {
+                return false;
+            }
+            break;
+
+        case STREAM_FRAME_KEY:
+            if (parser->payloadLength > STREAM_RLE_MAX_PAYLOAD((uint32_t) parser->targetSize))
+            {
+                return false;
+            }
+            break;
+
+        case STREAM_FRAME_IMAGE:
+            //  Needs a matrix to draw through that fits the target
+            if (parser->image == 0 || parser->matrix == 0 || parser->matrix->table == 0 ||
+                parser->matrix->width * parser->matrix->height > parser->targetSize)
+            {
+                return false;
+            }
+            if (parser->payloadLength < STREAM_IMAGE_HEADER_LENGTH || parser->payloadLength > STREAM_IMAGE_MAX_PAYLOAD)
+            {
+                return false;
+            }
+            break;
+
+        case STREAM_FRAME_TEXT:
+            if (parser->payloadLength > STREAM_TEXT_MAX_LENGTH)
+            {
+                return false;
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    //  CRC covers the header after the sync word
+    parser->crc = Crc32Update(CRC32_INITIAL, &parser->header[STREAM_SYNC_LENGTH], STREAM_HEADER_LENGTH - STREAM_SYNC_LENGTH);
+
+    parser->payloadReceived = 0;
+    parser->pixelIndex = 0;
+    parser->pixelChannel = 0;
+    parser->pixelValue = 0;
+    parser->decodeState = STREAM_DECODE_CONTROL;
+    parser->decodeCount = 0;
+    parser->decodeOverflow = false;
+    parser->receivedCrc = 0;
+    parser->crcReceived = 0;
+
+    //  The image only draws what it covers, everything else is off
+    if (parser->frameType == STREAM_FRAME_IMAGE)
+    {
+        for (int i = 0; i < parser->targetSize; i++)
+        {
+            parser->target[i] = 0;
+        }
+        parser->decodeState = STREAM_DECODE_IMAGE_HEADER;
+    }
+
+    return true;
+}
+
+//
+//  Frame passed its CRC
+//
+static void StreamCompleteFrame(struct StreamParserStruct* parser)
+{
+    parser->framesGood++;
+
+    //  Text can come from another sender mid stream, it stays out of the sequence numbers and leaves the pixels,
+    //  and what a DELTA builds on, alone
+    if (parser->frameType == STREAM_FRAME_TEXT)
+    {
+        parser->text[parser->payloadLength] = 0;
+        parser->textReady = true;
+        return;
+    }
+
+    //  Count anything the sequence numbers say we missed
+    if (parser->sequenceValid)
+    {
+        parser->framesLost += (uint16_t) (parser->sequence - parser->lastSequence - 1);
+    }
+    parser->lastSequence = parser->sequence;
+    parser->sequenceValid = true;
+
+    if (parser->frameType == STREAM_FRAME_DELTA)
+    {
+        //  Anything past the end of a delta is unchanged
+        for (int i = parser->pixelIndex; i < parser->targetSize; i++)
+        {
+            parser->target[i] = parser->reference[i];
+        }
+    }
+    else if (parser->frameType != STREAM_FRAME_IMAGE)
+    {
+        //  Short frames leave the rest of the string off
+        for (int i = parser->pixelIndex; i < parser->targetSize; i++)
+        {
+            parser->target[i] = 0;
+        }
+    }
+
+    parser->frameReady = true;
+    parser->deltaAllowed = true;
+}
+
+//
+//  Write one decoded R, G, B pixel, repeated count times
+//
+static inline void StreamDecodePixels(struct StreamParserStruct* parser, int value, int count)
+{
+    int* target = parser->target;
+    int pixel = parser->pixelIndex;
+
+    if (count > parser->targetSize - pixel)
+    {
+        count = parser->targetSize - pixel;
+        parser->decodeOverflow = true;
+    }
+
+    if (parser->frameType == STREAM_FRAME_DELTA)
+    {
+        const int* reference = parser->reference;
+        for (int i = 0; i < count; i++, pixel++)
+        {
+            target[pixel] = reference[pixel] ^ value;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < count; i++, pixel++)
+        {
+            target[pixel] = value;
+        }
+    }
+
+    parser->pixelIndex = pixel;
+}
+
+//
+//  Run length decode payload bytes straight into the target
+//
+static void StreamDecodeRle(struct StreamParserStruct* parser, const uint8_t* data, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t byte = data[i];
+
+        switch (parser->decodeState)
+        {
+            case STREAM_DECODE_CONTROL:
+                if (byte < 0x80)
+                {
+                    parser->decodeCount = byte + 1;
+                    parser->decodeState = STREAM_DECODE_LITERAL;
+                }
+                else if (byte < 0xC0)
+                {
+                    parser->decodeCount = (byte & 0x3F) + 1;
+                    parser->decodeState = STREAM_DECODE_RUN;
+                }
+                else
+                {
+                    parser->decodeCount = (byte & 0x3F) << 8;
+                    parser->decodeState = STREAM_DECODE_LONG_COUNT;
+                }
+                parser->pixelChannel = 0;
+                break;
+
+            case STREAM_DECODE_LONG_COUNT:
+                parser->decodeCount = (parser->decodeCount | byte) + 1;
+                parser->decodeState = STREAM_DECODE_RUN;
+                break;
+
+            default:
+                //  R, G, B on the wire into GRB in the buffer
+                if (parser->pixelChannel == 0)
+                {
+                    parser->pixelValue = byte << 8;
+                    parser->pixelChannel = 1;
+                    break;
+                }
+                else if (parser->pixelChannel == 1)
+                {
+                    parser->pixelValue |= byte << 16;
+                    parser->pixelChannel = 2;
+                    break;
+                }
+
+                parser->pixelValue |= byte;
+                parser->pixelChannel = 0;
+
+                if (parser->decodeState == STREAM_DECODE_RUN)
+                {
+                    StreamDecodePixels(parser, parser->pixelValue, parser->decodeCount);
+                    parser->decodeState = STREAM_DECODE_CONTROL;
+                }
+                else
+                {
+                    StreamDecodePixels(parser, parser->pixelValue, 1);
+                    if (--parser->decodeCount == 0)
+                    {
+                        parser->decodeState = STREAM_DECODE_CONTROL;
+                    }
+                }
+                break;
+        }
+    }
+}
+
+//
+//  Collect an IMAGE payload's header and palette, then hand the codes to the image decoder
+//
+static void StreamDecodeImage(struct StreamParserStruct* parser, const uint8_t* data, uint32_t count)
+{
+    struct ImageDecoderStruct* image = parser->image;
+    uint32_t i = 0;
+
+    while (i < count)
+    {
+        switch (parser->decodeState)
+        {
+            case STREAM_DECODE_IMAGE_HEADER:
+            {
+                parser->imageHeader[parser->decodeCount++] = data[i++];
+
+                if (parser->decodeCount < STREAM_IMAGE_HEADER_LENGTH)
+                {
+                    break;
+                }
+
+                const uint8_t* header = parser->imageHeader;
+                int width = ReadLE16(&header[0]);
+                int height = ReadLE16(&header[2]);
+
+                //  A bad header leaves the decoder in error, which eats the rest of the payload
+                if (!ImageDecoderBegin(image, width, height, header[4], -1, parser->target, parser->matrix) ||
+                    width == 0 || height == 0)
+                {
+                    image->result = IMAGE_DECODE_ERROR;
+                    parser->decodeOverflow = true;
+                }
+
+                ImageDecoderSetPalette(image, 0, 0);
+                parser->imageColours = header[5] + 1;
+                parser->decodeCount = 0;
+                parser->pixelChannel = 0;
+                parser->decodeState = STREAM_DECODE_IMAGE_PALETTE;
+                break;
+            }
+
+            case STREAM_DECODE_IMAGE_PALETTE:
+            {
+                uint8_t byte = data[i++];
+
+                //  R, G, B on the wire into GRB in the palette
+                if (parser->pixelChannel == 0)
+                {
+                    parser->pixelValue = byte << 8;
+                    parser->pixelChannel = 1;
+                    break;
+                }
+                else if (parser->pixelChannel == 1)
+                {
+                    parser->pixelValue |= byte << 16;
+                    parser->pixelChannel = 2;
+                    break;
+                }
+
+                image->colours[parser->decodeCount++] = parser->pixelValue | byte;
+                parser->pixelChannel = 0;
+
+                if (parser->decodeCount == parser->imageColours)
+                {
+                    parser->decodeState = STREAM_DECODE_IMAGE_CODES;
+                }
+                break;
+            }
+
+            default:
+                ImageDecoderFeed(image, data + i, (int) (count - i));
+                i = count;
+                break;
+        }
+    }
+}
+
+//
+//  Payload ended on a block boundary, or for an image on its end code
+//
+static bool StreamDecodeComplete(const struct StreamParserStruct* parser)
+{
+    if (parser->frameType == STREAM_FRAME_IMAGE)
+    {
+        return parser->decodeState == STREAM_DECODE_IMAGE_CODES && parser->image->result == IMAGE_DECODE_DONE;
+    }
+
+    return parser->decodeState == STREAM_DECODE_CONTROL;
+}
+
+int StreamParserFeed(struct StreamParserStruct* parser, const uint8_t* data, int length)
+{
+    int used = 0;
+
+    while (used < length && !parser->frameReady && !parser->textReady)
+    {
+        switch (parser->state)
+        {
+            //
+            //  Hunt for the sync word
+            //
+            case STREAM_STATE_SYNC:
+            {
+                uint8_t byte = data[used++];
+
+                if (byte == STREAM_SYNC[parser->syncMatched])
+                {
+                    parser->header[parser->syncMatched++] = byte;
+                }
+                else
+                {
+                    //  A mismatch can still be the start of a new sync word
+                    parser->syncMatched = (byte == STREAM_SYNC[0]) ? 1 : 0;
+                }
+
+                if (parser->syncMatched == STREAM_SYNC_LENGTH)
+                {
+                    parser->syncMatched = 0;
+                    parser->headerReceived = STREAM_SYNC_LENGTH;
+                    parser->state = STREAM_STATE_HEADER;
+                }
+                break;
+            }
+
+            //
+            //  Collect the rest of the header
+            //
+            case STREAM_STATE_HEADER:
+                parser->header[parser->headerReceived++] = data[used++];
+
+                if (parser->headerReceived == STREAM_HEADER_LENGTH)
+                {
+                    if (!StreamAcceptHeader(parser))
+                    {
+                        parser->framesBadHeader++;
+                        parser->state = STREAM_STATE_SYNC;
+                    }
+                    else if (parser->payloadLength == 0)
+                    {
+                        parser->state = STREAM_STATE_CRC;
+                    }
+                    else
+                    {
+                        parser->state = STREAM_STATE_PAYLOAD;
+                    }
+                }
+                break;
+
+            //
+            //  Write the payload straight into the target buffer
+            //
+            case STREAM_STATE_PAYLOAD:
+            {
+                uint32_t available = (uint32_t) (length - used);
+                uint32_t remaining = parser->payloadLength - parser->payloadReceived;
+                uint32_t count = (available < remaining) ? available : remaining;
+
+                if (parser->frameType != STREAM_FRAME_RAW)
+                {
+                    parser->crc = Crc32Update(parser->crc, data + used, count);
+                    if (parser->frameType == STREAM_FRAME_IMAGE)
+                    {
+                        StreamDecodeImage(parser, data + used, count);
+                    }
+                    else if (parser->frameType == STREAM_FRAME_TEXT)
+                    {
+                        memcpy(parser->text + parser->payloadReceived, data + used, count);
+                    }
+                    else
+                    {
+                        StreamDecodeRle(parser, data + used, count);
+                    }
+
+                    parser->payloadReceived += count;
+                    used += count;
+
+                    if (parser->payloadReceived == parser->payloadLength)
+                    {
+                        parser->state = STREAM_STATE_CRC;
+                    }
+                    break;
+                }
+
+                uint32_t crc = parser->crc;
+                int pixel = parser->pixelIndex;
+                int channel = parser->pixelChannel;
+                int* target = parser->target;
+
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    uint8_t byte = data[used + i];
+                    crc = Crc32UpdateByte(crc, byte);
+
+                    //  R, G, B on the wire into GRB in the buffer
+                    if (channel == 0)
+                    {
+                        target[pixel] = byte << 8;
+                        channel = 1;
+                    }
+                    else if (channel == 1)
+                    {
+                        target[pixel] |= byte << 16;
+                        channel = 2;
+                    }
+                    else
+                    {
+                        target[pixel] |= byte;
+                        channel = 0;
+                        pixel++;
+                    }
+                }
+
+                parser->crc = crc;
+                parser->pixelIndex = pixel;
+                parser->pixelChannel = channel;
+                parser->payloadReceived += count;
+                used += count;
+
+                if (parser->payloadReceived == parser->payloadLength)
+                {
+                    parser->state = STREAM_STATE_CRC;
+                }
+                break;
+            }
+
+            //
+            //  Check the trailing CRC
+            //
+            case STREAM_STATE_CRC:
+                parser->receivedCrc |= (uint32_t) data[used++] << (8 * parser->crcReceived);
+                parser->crcReceived++;
+
+                if (parser->crcReceived == STREAM_CRC_LENGTH)
+                {
+                    if (parser->receivedCrc != Crc32Final(parser->crc))
+                    {
+                        parser->framesBadCrc++;
+                        parser->deltaAllowed = false;
+                    }
+                    else if (parser->decodeOverflow || !StreamDecodeComplete(parser))
+                    {
+                        //  Intact but doesn't describe a whole frame that fits
+                        parser->framesBadDecode++;
+                        parser->deltaAllowed = false;
+                    }
+                    else
+                    {
+                        StreamCompleteFrame(parser);
+                    }
+
+                    parser->state = STREAM_STATE_SYNC;
+                }
+                break;
+        }
+    }
+
+    parser->bytesReceived += used;
+
+    return used;
+}
+
+int StreamWriteHeader(uint8_t* output, uint8_t frameType, uint16_t sequence, uint32_t payloadLength)
+{
+    output[0] = STREAM_SYNC_0;
+    output[1] = STREAM_SYNC_1;
+    output[2] = STREAM_SYNC_2;
+    output[3] = STREAM_SYNC_3;
+    output[4] = frameType;
+    output[5] = 0;
+    output[6] = sequence & 0xFF;
+    output[7] = (sequence >> 8) & 0xFF;
+    output[8] = payloadLength & 0xFF;
+    output[9] = (payloadLength >> 8) & 0xFF;
+    output[10] = (payloadLength >> 16) & 0xFF;
+    output[11] = (payloadLength >> 24) & 0xFF;
+
+    return STREAM_HEADER_LENGTH;
+}
+
+//
+//  Encoder, used by the host tools
+//
+
+static inline uint32_t ReadRgb(const uint8_t* pixels, int index)
+{
+    return ((uint32_t) pixels[index * 3] << 16) | ((uint32_t) pixels[index * 3 + 1] << 8) | pixels[index * 3 + 2];
+}
+
+static inline int WriteRgb(uint8_t* output, uint32_t value)
+{
+    output[0] = (value >> 16) & 0xFF;
+    output[1] = (value >> 8) & 0xFF;
+    output[2] = value & 0xFF;
+    return 3;
+}
+
+int StreamEncodeRle(uint8_t* output, const uint8_t* pixels, const uint8_t* previous, int pixelCount)
+{
+    int length = 0;
+    int literalStart = 0;
+    int literalCount = 0;
+    int i = 0;
+
+    while (i < pixelCount)
+    {
+        uint32_t value = ReadRgb(pixels, i) ^ (previous ? ReadRgb(previous, i) : 0);
+
+        //  Measure the run starting here
+        int run = 1;
+        while (i + run < pixelCount && run < STREAM_RLE_MAX_LONG_RUN &&
+               (ReadRgb(pixels, i + run) ^ (previous ? ReadRgb(previous, i + run) : 0)) == value)
+        {
+            run++;
+        }
+
+        //  Runs of two or more are never bigger as a run block
+        if (run >= 2 || literalCount == STREAM_RLE_MAX_LITERAL)
+        {
+            if (literalCount > 0)
+            {
+                output[length++] = literalCount - 1;
+                for (int j = literalStart; j < literalStart + literalCount; j++)
+                {
+                    length += WriteRgb(output + length,
+                                       ReadRgb(pixels, j) ^ (previous ? ReadRgb(previous, j) : 0));
+                }
+                literalCount = 0;
+            }
+        }
+
+        if (run >= 2)
+        {
+            if (run <= STREAM_RLE_MAX_RUN)
+            {
+                output[length++] = 0x80 | (run - 1);
+            }
+            else
+            {
+                output[length++] = 0xC0 | ((run - 1) >> 8);
+                output[length++] = (run - 1) & 0xFF;
+            }
+            length += WriteRgb(output + length, value);
+            i += run;
+        }
+        else
+        {
+            if (literalCount == 0)
+            {
+                literalStart = i;
+            }
+            literalCount++;
+            i++;
+        }
+    }
+
+    if (literalCount > 0)
+    {
+        output[length++] = literalCount - 1;
+        for (int j = literalStart; j < literalStart + literalCount; j++)
+        {
+            length += WriteRgb(output + length, ReadRgb(pixels, j) ^ (previous ? ReadRgb(previous, j) : 0));
+        }
+    }
+
+    return length;
+}
@@ -0,0 +1,195 @@
+#ifndef PICOPIXOS_STREAM_H
+#define PICOPIXOS_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "image.h"
+
+//
+//  Binary Frame Stream Protocol
+//
+//  Every frame on the wire is laid out as (all multi-byte fields little endian):
+//
+//      Offset  Size    Field
+//      0       4       Sync word, A5 5A 50 58
+//      4       1       Frame type
+//      5       1       Flags, reserved, send 0
+//      6       2       Sequence number, increments by one per frame
+//      8       4       Payload length in bytes
+//      12      n       Payload
+//      12+n    4       CRC-32 of everything from the frame type through the end of the payload
+//
+//  RAW payloads are 3 bytes per pixel in R, G, B order starting at pixel 0.  Pixels past the end of a
+//  short payload are turned off.
+//
+//  KEY and DELTA payloads are run length coded pixels.  Each block starts with a control byte:
+//
+//      0x00-0x7F       Literal, (c + 1) pixels of R, G, B follow
+//      0x80-0xBF       Run, one R, G, B pixel follows and repeats ((c & 0x3F) + 1) times
+//      0xC0-0xFF       Long run, one more count byte n, then one pixel repeating ((c & 0x3F) << 8 | n) + 1 times
+//
+//  KEY frames decode to the pixels themselves, pixels past the end are turned off.  DELTA frames decode to
+//  values that get XORed onto the previously presented frame, so unchanged areas are long runs of zero, and
+//  pixels past the end are left as they were.  A DELTA frame is only applied if the frame before it arrived
+//  intact, otherwise they are dropped until the next RAW or KEY frame.
+//
+//  TEXT payloads are up to STREAM_TEXT_MAX_LENGTH characters of ASCII, the message the Ticker effect scrolls.  They
+//  leave the pixels and the sequence numbers alone, so a completed TEXT frame sets textReady rather than frameReady.
+//
+//  IMAGE payloads are an indexed colour picture drawn through the 2D matrix (see image.h), pixels it doesn't
+//  cover are turned off:
+//
+//      Offset  Size    Field
+//      0       2       Width
+//      2       2       Height
+//      4       1       LZW minimum code size, 2 to 8
+//      5       1       Palette colours - 1
+//      6       3 * n   Palette, R, G, B
+//      ...             LZW codes, up to and including the end code
+//
+
+#define STREAM_SYNC_0 0xA5
+#define STREAM_SYNC_1 0x5A
+#define STREAM_SYNC_2 0x50
+#define STREAM_SYNC_3 0x58
+
+#define STREAM_SYNC_LENGTH 4
+#define STREAM_HEADER_LENGTH 12
+#define STREAM_CRC_LENGTH 4
+
+//  Frame Types
+enum StreamFrameTypes
+{
+    STREAM_FRAME_RAW = 0,
+    STREAM_FRAME_KEY = 1,
+    STREAM_FRAME_DELTA = 2,
+    STREAM_FRAME_IMAGE = 3,
+    STREAM_FRAME_TEXT = 4
+};
+
+//  Longest TEXT payload
+#define STREAM_TEXT_MAX_LENGTH 128
+
+//  Run length block limits
+#define STREAM_RLE_MAX_LITERAL 128
+#define STREAM_RLE_MAX_RUN 64
+#define STREAM_RLE_MAX_LONG_RUN 16384
+
+//  Worst case encoded payload for a number of pixels, every pixel in a literal block
+#define STREAM_RLE_MAX_PAYLOAD(pixels) ((pixels) * 3 + ((pixels) + STREAM_RLE_MAX_LITERAL - 1) / STREAM_RLE_MAX_LITERAL)
+
+//  IMAGE payload fields before the palette, and the most a picture the matrix can hold can need
+#define STREAM_IMAGE_HEADER_LENGTH 6
+#define STREAM_IMAGE_MAX_PAYLOAD \
+        (STREAM_IMAGE_HEADER_LENGTH + IMAGE_MAX_COLOURS * 3 + IMAGE_LZW_MAX_LENGTH(PIXEL_MATRIX_MAX_CELLS))
+
+//  Parser States
+enum StreamParserStates
+{
+    STREAM_STATE_SYNC = 0,
+    STREAM_STATE_HEADER,
+    STREAM_STATE_PAYLOAD,
+    STREAM_STATE_CRC
+};
+
+//  Run length decoder states
+enum StreamDecodeStates
+{
+    STREAM_DECODE_CONTROL = 0,
+    STREAM_DECODE_LONG_COUNT,
+    STREAM_DECODE_LITERAL,
+    STREAM_DECODE_RUN,
+
+    //  IMAGE payloads
+    STREAM_DECODE_IMAGE_HEADER,
+    STREAM_DECODE_IMAGE_PALETTE,
+    STREAM_DECODE_IMAGE_CODES
+};
+
+struct StreamParserStruct
+{
+    //
+    //  Target Pixel Buffer (GRB values, same as the pixel buffer)
+    //
+    int* target;
+    int targetSize;
+
+    //  Previously presented frame, DELTA frames are applied on top of it
+    const int* reference;
+
+    //  IMAGE frames are decoded by image through matrix, they're refused without one
+    struct ImageDecoderStruct* image;
+    const struct PixelMatrixStruct* matrix;
+
+    //
+    //  Parser State
+    //
+    int state;
+    int syncMatched;
+    uint8_t header[STREAM_HEADER_LENGTH];
+    int headerReceived;
+    uint8_t frameType;
+    uint16_t sequence;
+    uint32_t payloadLength;
+    uint32_t payloadReceived;
+    int pixelIndex;
+    int pixelChannel;
+    int pixelValue;
+    int decodeState;
+    int decodeCount;
+    bool decodeOverflow;
+    uint8_t imageHeader[STREAM_IMAGE_HEADER_LENGTH];
+    int imageColours;
+    bool deltaAllowed;
+    uint32_t crc;
+    uint32_t receivedCrc;
+    int crcReceived;
+    bool frameReady;
+
+    //  Last TEXT frame received, NUL terminated
+    char text[STREAM_TEXT_MAX_LENGTH + 1];
+    bool textReady;
+
+    //
+    //  Statistics
+    //
+    bool sequenceValid;
+    uint16_t lastSequence;
+    uint32_t framesGood;
+    uint32_t framesBadCrc;
+    uint32_t framesBadHeader;
+    uint32_t framesBadDecode;
+    uint32_t framesLost;
+    uint32_t bytesReceived;
+};
+
+void StreamParserInit(struct StreamParserStruct* parser);
+
+//  Drop any part received frame and start over at the next sync word, as if no frame had come before.  DELTA
+//  frames are refused until a RAW or KEY frame arrives, statistics are kept.
+void StreamParserReset(struct StreamParserStruct* parser);
+
+//  Point the parser at the buffer the next frame gets written into
+void StreamParserSetTarget(struct StreamParserStruct* parser, int* target, int targetSize);
+
+//  Set the previously presented frame DELTA frames are decoded against
+void StreamParserSetReference(struct StreamParserStruct* parser, const int* reference);
+
+//  Set the decoder and matrix IMAGE frames are drawn with
+void StreamParserSetImage(struct StreamParserStruct* parser, struct ImageDecoderStruct* image,
+                          const struct PixelMatrixStruct* matrix);
+
+//  Feed received bytes, returns how many were used.  Stops early once a frame is complete and sets frameReady,
+//  the caller should present the frame, set a new target, clear frameReady and feed the rest.  TEXT frames stop
+//  it the same way with textReady, the caller takes text and clears it.
+int StreamParserFeed(struct StreamParserStruct* parser, const uint8_t* data, int length);
+
+//  Fill in the sync word and header for a frame, returns the number of bytes written (STREAM_HEADER_LENGTH)
+int StreamWriteHeader(uint8_t* output, uint8_t frameType, uint16_t sequence, uint32_t payloadLength);
+
+//  Run length encode R, G, B pixels into a KEY payload, or a DELTA payload when previous is given.
+//  Output needs room for STREAM_RLE_MAX_PAYLOAD(pixels) bytes, returns the payload length.
+int StreamEncodeRle(uint8_t* output, const uint8_t* pixels, const uint8_t* previous, int pixelCount);
+
+#endif
@@ -0,0 +1,222 @@
+//
+//  stream_roundtrip - Encode frames the way pixsend does and check the device's parser gives the pixels back
+//
+//  Covers RAW, KEY and DELTA frames, and that a DELTA frame is refused after a gap in the sequence numbers, a
+//  damaged frame or a reset, until the next KEY frame, and that a reset drops a frame that was cut off.  A TEXT
+//  frame in between leaves the pixels and the sequence alone.  Run by ctest on the host build, exits non-zero on
+//  any failure.
+//
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc.h"
+#include "stream.h"
+
+#define TEST_PIXELS 300
+
+static uint8_t Frame[STREAM_HEADER_LENGTH + STREAM_RLE_MAX_PAYLOAD(TEST_PIXELS) + STREAM_CRC_LENGTH];
+static int Buffers[2][TEST_PIXELS];
+static int Front = 0;
+static struct StreamParserStruct Parser;
+static int Failures = 0;
+
+static void Check(bool condition, const char* what)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "FAIL %s\n", what);
+        Failures++;
+    }
+}
+
+//
+//  Frame type and payload into Frame with its header and CRC, returns the whole length
+//
+static int BuildFrame(uint8_t frameType, uint16_t sequence, const uint8_t* payload, int payloadLength)
+{
+    StreamWriteHeader(Frame, frameType, sequence, (uint32_t) payloadLength);
+    memcpy(Frame + STREAM_HEADER_LENGTH, payload, (size_t) payloadLength);
+
+    uint32_t crc = Crc32(Frame + STREAM_SYNC_LENGTH, STREAM_HEADER_LENGTH - STREAM_SYNC_LENGTH + payloadLength);
+    for (int i = 0; i < STREAM_CRC_LENGTH; i++)
+    {
+        Frame[STREAM_HEADER_LENGTH + payloadLength + i] = (crc >> (8 * i)) & 0xFF;
+    }
+
+    return STREAM_HEADER_LENGTH + payloadLength + STREAM_CRC_LENGTH;
+}
+
+//
+//  Feed a frame into the back buffer the way stream mode does, true if it was accepted and presented
+//
+static bool Receive(int length)
+{
+    int* back = Buffers[Front ^ 1];
+
+    StreamParserSetTarget(&Parser, back, TEST_PIXELS);
+    StreamParserSetReference(&Parser, Buffers[Front]);
+    StreamParserFeed(&Parser, Frame, length);
+
+    if (!Parser.frameReady)
+    {
+        return false;
+    }
+
+    Parser.frameReady = false;
+    Front ^= 1;
+    return true;
+}
+
+//
+//  Whether the presented frame is pixels, R, G, B bytes against GRB values
+//
+static bool Presented(const uint8_t* pixels)
+{
+    for (int i = 0; i < TEST_PIXELS; i++)
+    {
+        int expected = (pixels[i * 3] << 8) | (pixels[i * 3 + 1] << 16) | pixels[i * 3 + 2];
+        if (Buffers[Front][i] != expected)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+//  Runs long enough for long run blocks, a stretch of noise long enough for several literal blocks, and a
+//  moving dot so consecutive frames differ
+//
+static void FillPattern(uint8_t* pixels, int frame)
+{
+    uint32_t state = 0x12345678u + (uint32_t) frame;
+
+    for (int i = 0; i < TEST_PIXELS; i++)
+    {
+        uint8_t* pixel = pixels + i * 3;
+
+        if (i < 100)
+        {
+            pixel[0] = 40;
+            pixel[1] = 0;
+            pixel[2] = (uint8_t) (frame * 10);
+        }
+        else if (i < 250)
+        {
+            state = state * 1664525u + 1013904223u;
+            pixel[0] = (uint8_t) (state >> 24);
+            pixel[1] = (uint8_t) (state >> 16);
+            pixel[2] = (uint8_t) (state >> 8);
+        }
+        else
+        {
+            memset(pixel, i - 250 == frame * 7 % 50 ? 255 : 0, 3);
+        }
+    }
+}
+
+int main()
+{
+    uint8_t previous[TEST_PIXELS * 3];
+    uint8_t pixels[TEST_PIXELS * 3];
+    uint8_t payload[STREAM_RLE_MAX_PAYLOAD(TEST_PIXELS)];
+    uint16_t sequence = 0;
+    int length;
+
+    StreamParserInit(&Parser);
+
+    //  RAW
+    FillPattern(pixels, 0);
+    Check(Receive(BuildFrame(STREAM_FRAME_RAW, sequence++, pixels, TEST_PIXELS * 3)), "raw frame accepted");
+    Check(Presented(pixels), "raw frame round trip");
+
+    //  KEY
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 1);
+    length = StreamEncodeRle(payload, pixels, NULL, TEST_PIXELS);
+    Check(length < TEST_PIXELS * 3, "key frame smaller than raw");
+    Check(Receive(BuildFrame(STREAM_FRAME_KEY, sequence++, payload, length)), "key frame accepted");
+    Check(Presented(pixels), "key frame round trip");
+
+    //  DELTA on top of the KEY frame, and another on top of that
+    for (int frame = 2; frame < 4; frame++)
+    {
+        memcpy(previous, pixels, sizeof(pixels));
+        FillPattern(pixels, frame);
+        length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+        Check(Receive(BuildFrame(STREAM_FRAME_DELTA, sequence++, payload, length)), "delta frame accepted");
+        Check(Presented(pixels), "delta frame round trip");
+    }
+
+    //  A DELTA frame after a gap in the sequence is refused and leaves the presented frame alone
+    uint32_t badHeaders = Parser.framesBadHeader;
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 4);
+    length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+    sequence++;
+    Check(!Receive(BuildFrame(STREAM_FRAME_DELTA, sequence++, payload, length)), "delta after a gap refused");
+    Check(Parser.framesBadHeader == badHeaders + 1, "delta after a gap counted as a bad header");
+    Check(Presented(previous), "refused delta leaves the frame alone");
+
+    //  A KEY frame starts things over, a DELTA can follow it again
+    length = StreamEncodeRle(payload, pixels, NULL, TEST_PIXELS);
+    Check(Receive(BuildFrame(STREAM_FRAME_KEY, sequence++, payload, length)), "key frame after a gap accepted");
+    Check(Presented(pixels), "key frame after a gap round trip");
+
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 5);
+    length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+    Check(Receive(BuildFrame(STREAM_FRAME_DELTA, sequence++, payload, length)), "delta after a new key accepted");
+    Check(Presented(pixels), "delta after a new key round trip");
+
+    //  A damaged frame stops DELTA frames, even one numbered straight after it
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 6);
+    length = BuildFrame(STREAM_FRAME_RAW, sequence++, pixels, TEST_PIXELS * 3);
+    Frame[STREAM_HEADER_LENGTH + 10] ^= 0x01;
+    Check(!Receive(length), "damaged frame refused");
+
+    FillPattern(pixels, 7);
+    length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+    Check(!Receive(BuildFrame(STREAM_FRAME_DELTA, sequence++, payload, length)), "delta after a damaged frame refused");
+    Check(Presented(previous), "frame before the damaged one still presented");
+
+    //  After a reset a DELTA numbered straight on from the last frame is refused, the effects have drawn since
+    length = StreamEncodeRle(payload, pixels, NULL, TEST_PIXELS);
+    Check(Receive(BuildFrame(STREAM_FRAME_KEY, sequence++, payload, length)), "key frame before a reset accepted");
+    StreamParserReset(&Parser);
+
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 8);
+    length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+    Check(!Receive(BuildFrame(STREAM_FRAME_DELTA, sequence++, payload, length)), "delta after a reset refused");
+    Check(Presented(previous), "frame before the reset still presented");
+
+    //  A frame cut off by the idle timeout is dropped by the reset rather than eating the next session's first
+    length = StreamEncodeRle(payload, pixels, NULL, TEST_PIXELS);
+    Check(!Receive(BuildFrame(STREAM_FRAME_KEY, sequence++, payload, length) / 2), "cut off frame not accepted");
+    StreamParserReset(&Parser);
+
+    Check(Receive(BuildFrame(STREAM_FRAME_KEY, 0, payload, length)), "key frame after a reset accepted");
+    Check(Presented(pixels), "key frame after a reset round trip");
+
+    //  TEXT from another sender mid stream, numbered 0 the way pixsend -t sends it, hands over the text and leaves
+    //  the frame and the sequence alone so the next DELTA still builds on it
+    const char* message = "Hello from the stream";
+    Check(!Receive(BuildFrame(STREAM_FRAME_TEXT, 0, (const uint8_t*) message, (int) strlen(message))),
+          "text frame not presented");
+    Check(Parser.textReady && strcmp(Parser.text, message) == 0, "text frame received");
+    Check(Presented(pixels), "text frame leaves the frame alone");
+    Parser.textReady = false;
+
+    memcpy(previous, pixels, sizeof(pixels));
+    FillPattern(pixels, 9);
+    length = StreamEncodeRle(payload, pixels, previous, TEST_PIXELS);
+    Check(Receive(BuildFrame(STREAM_FRAME_DELTA, 1, payload, length)), "delta after a text frame accepted");
+    Check(Presented(pixels), "delta after a text frame round trip");
+
+    printf("stream_roundtrip frames=%u failures=%d\n", (unsigned) Parser.framesGood, Failures);
+    return Failures != 0;
+}
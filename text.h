@@ -0,0 +1,42 @@
+#ifndef PICOPIXOS_TEXT_H
+#define PICOPIXOS_TEXT_H
+
+#include <stdint.h>
+
+//
+//  Bitmap Text
+//
+//  A 5 x 7 font for printable ASCII, held in flash as one byte per column with bit 0 the top row.  Laying out
+//  a message turns it into columns once: glyphs lose their blank edge columns, so text is proportional, and
+//  get one blank column between them.  Drawing is then a blit of whichever columns are on the canvas, there's
+//  no glyph decoding per frame.
+//
+
+#define TEXT_FONT_FIRST ' '
+#define TEXT_FONT_LAST '~'
+#define TEXT_FONT_WIDTH 5
+#define TEXT_FONT_HEIGHT 7
+
+//  Columns of a space
+#define TEXT_SPACE_WIDTH 3
+
+#define TEXT_MAX_COLUMNS 1024
+
+extern const uint8_t TextFont[TEXT_FONT_LAST - TEXT_FONT_FIRST + 1][TEXT_FONT_WIDTH];
+
+struct TextLayout
+{
+    uint8_t columns[TEXT_MAX_COLUMNS];
+    int length;
+};
+
+//  Lay message out into columns, anything past TEXT_MAX_COLUMNS is dropped.  Characters the font doesn't have
+//  come out as '?'.
+void TextLayoutMessage(struct TextLayout* text, const char* message);
+
+//  Draw the text with its column first at canvas column x, rows from top.  Canvas column x takes the colour
+//  palette[(phase + x * 8) & 255], unlit pixels in the text's rows are cleared.
+void TextBlit(const struct TextLayout* text, int first, int* canvas, int width, int height, int top,
+              const int* palette, int phase);
+
+#endif
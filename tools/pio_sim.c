@@ -0,0 +1,504 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pio_sim.h"
+
+enum PioSimOpcodes
+{
+    PIO_OP_JMP = 0,
+    PIO_OP_WAIT = 1,
+    PIO_OP_IN = 2,
+    PIO_OP_OUT = 3,
+    PIO_OP_PUSH_PULL = 4,
+    PIO_OP_MOV = 5,
+    PIO_OP_IRQ = 6,
+    PIO_OP_SET = 7
+};
+
+void PioSimInit(struct PioSimStruct* sim, const uint16_t* instructions, int length, int wrapTarget, int wrap)
+{
+    memset(sim, 0, sizeof(*sim));
+    memcpy(sim->instructions, instructions, length * sizeof(uint16_t));
+    sim->wrapTarget = wrapTarget;
+    sim->wrap = wrap;
+
+    //  pio_get_default_sm_config
+    sim->outShiftRight = true;
+    sim->inShiftRight = true;
+    sim->pullThreshold = 32;
+    sim->pushThreshold = 32;
+    sim->outCount = 32;
+    sim->clockDivider = 1 << 8;
+    sim->fifoDepth = 4;
+
+    //  OSR starts out empty so the first autopull happens straight away
+    sim->osrShifted = 32;
+    sim->dividerCount = 0;
+}
+
+void PioSimSetClockDivider(struct PioSimStruct* sim, float divider)
+{
+    uint32_t whole = (uint32_t) divider;
+    uint32_t fraction = (uint32_t) ((divider - whole) * (1u << 8));
+
+    sim->clockDivider = whole << 8 | fraction;
+}
+
+bool PioSimPush(struct PioSimStruct* sim, uint32_t word)
+{
+    if (sim->txCount == sim->fifoDepth)
+    {
+        return false;
+    }
+
+    sim->txFifo[(sim->txHead + sim->txCount) % PIO_SIM_FIFO_JOINED] = word;
+    sim->txCount++;
+
+    return true;
+}
+
+bool PioSimFifoFull(const struct PioSimStruct* sim)
+{
+    return sim->txCount == sim->fifoDepth;
+}
+
+void PioSimExec(struct PioSimStruct* sim, uint16_t instruction)
+{
+    sim->forced = instruction;
+    sim->forcedPending = true;
+}
+
+static bool PioSimPop(struct PioSimStruct* sim, uint32_t* word)
+{
+    if (sim->txCount == 0)
+    {
+        sim->txStall = true;
+        return false;
+    }
+
+    *word = sim->txFifo[sim->txHead];
+    sim->txHead = (sim->txHead + 1) % PIO_SIM_FIFO_JOINED;
+    sim->txCount--;
+
+    return true;
+}
+
+//
+//  Write count bits of value to the pins starting at base, wrapping past 31 like the hardware
+//
+static void PioSimWritePins(struct PioSimStruct* sim, int base, int count, uint32_t value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t pin = 1u << ((base + i) & 31);
+        sim->pins = (value >> i) & 1 ? sim->pins | pin : sim->pins & ~pin;
+    }
+}
+
+static void PioSimWritePindirs(struct PioSimStruct* sim, int base, int count, uint32_t value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t pin = 1u << ((base + i) & 31);
+        sim->pindirs = (value >> i) & 1 ? sim->pindirs | pin : sim->pindirs & ~pin;
+    }
+}
+
+static uint32_t PioSimReadPins(const struct PioSimStruct* sim)
+{
+    return sim->inBase == 0 ? sim->pins : sim->pins >> sim->inBase | sim->pins << (32 - sim->inBase);
+}
+
+static uint32_t PioSimReverse(uint32_t value)
+{
+    uint32_t reversed = 0;
+
+    for (int i = 0; i < 32; i++)
+    {
+        reversed = reversed << 1 | ((value >> i) & 1);
+    }
+
+    return reversed;
+}
+
+//
+//  Shift count bits out of the OSR
+//
+static uint32_t PioSimShiftOut(struct PioSimStruct* sim, int count)
+{
+    uint32_t data;
+
+    if (count == 32)
+    {
+        data = sim->osr;
+        sim->osr = 0;
+    }
+    else if (sim->outShiftRight)
+    {
+        data = sim->osr & ((1u << count) - 1);
+        sim->osr >>= count;
+    }
+    else
+    {
+        data = sim->osr >> (32 - count);
+        sim->osr <<= count;
+    }
+
+    sim->osrShifted = sim->osrShifted + count > 32 ? 32 : sim->osrShifted + count;
+
+    return data;
+}
+
+static void PioSimShiftIn(struct PioSimStruct* sim, uint32_t data, int count)
+{
+    if (count == 32)
+    {
+        sim->isr = data;
+    }
+    else
+    {
+        data &= (1u << count) - 1;
+        sim->isr = sim->inShiftRight ? sim->isr >> count | data << (32 - count) : sim->isr << count | data;
+    }
+
+    sim->isrShifted = sim->isrShifted + count > 32 ? 32 : sim->isrShifted + count;
+
+    //  No RX FIFO is modelled, pushed words go nowhere
+    if (sim->autopush && sim->isrShifted >= sim->pushThreshold)
+    {
+        sim->isr = 0;
+        sim->isrShifted = 0;
+    }
+}
+
+//
+//  Execute the instruction at pc, returns false if it stalled.  Sets *jumped when it wrote the pc.
+//
+static bool PioSimExecute(struct PioSimStruct* sim, uint16_t instruction, bool* jumped)
+{
+    int opcode = instruction >> 13;
+    int field = (instruction >> 5) & 7;
+    int index = instruction & 0x1F;
+    int count = index == 0 ? 32 : index;
+
+    switch (opcode)
+    {
+        case PIO_OP_JMP:
+        {
+            bool take = false;
+
+            switch (field)
+            {
+                case 0: take = true; break;
+                case 1: take = sim->x == 0; break;
+                case 2: take = sim->x != 0; sim->x--; break;
+                case 3: take = sim->y == 0; break;
+                case 4: take = sim->y != 0; sim->y--; break;
+                case 5: take = sim->x != sim->y; break;
+                case 6: take = (sim->pins >> sim->jmpPin) & 1; break;
+                case 7: take = sim->osrShifted < sim->pullThreshold; break;
+            }
+
+            if (take)
+            {
+                sim->pc = index;
+                *jumped = true;
+            }
+            return true;
+        }
+
+        case PIO_OP_WAIT:
+        {
+            int polarity = (instruction >> 7) & 1;
+            int source = (instruction >> 5) & 3;
+            int level;
+
+            if (source == 0)
+            {
+                level = (sim->pins >> index) & 1;
+            }
+            else if (source == 1)
+            {
+                level = (PioSimReadPins(sim) >> index) & 1;
+            }
+            else
+            {
+                sim->error = "WAIT on IRQ is not simulated";
+                return false;
+            }
+
+            return level == polarity;
+        }
+
+        case PIO_OP_IN:
+        {
+            uint32_t data = 0;
+
+            switch (field)
+            {
+                case 0: data = PioSimReadPins(sim); break;
+                case 1: data = sim->x; break;
+                case 2: data = sim->y; break;
+                case 3: data = 0; break;
+                case 6: data = sim->isr; break;
+                case 7: data = sim->osr; break;
+                default:
+                    sim->error = "IN from a reserved source";
+                    return false;
+            }
+
+            PioSimShiftIn(sim, data, count);
+            return true;
+        }
+
+        case PIO_OP_OUT:
+        {
+            //  Autopull refills an empty OSR before the OUT can go, and stalls it while the FIFO is empty
+            if (sim->autopull && sim->osrShifted >= sim->pullThreshold)
+            {
+                if (!PioSimPop(sim, &sim->osr))
+                {
+                    return false;
+                }
+                sim->osrShifted = 0;
+            }
+
+            uint32_t data = PioSimShiftOut(sim, count);
+
+            switch (field)
+            {
+                case 0: PioSimWritePins(sim, sim->outBase, count < sim->outCount ? count : sim->outCount, data); break;
+                case 1: sim->x = data; break;
+                case 2: sim->y = data; break;
+                case 3: break;
+                case 4: PioSimWritePindirs(sim, sim->outBase, count < sim->outCount ? count : sim->outCount, data); break;
+                case 5: sim->pc = data & 31; *jumped = true; break;
+                case 6: sim->isr = data; sim->isrShifted = count; break;
+                case 7:
+                    sim->error = "OUT EXEC is not simulated";
+                    return false;
+            }
+
+            //  Refill straight after if there's a word waiting
+            if (sim->autopull && sim->osrShifted >= sim->pullThreshold && sim->txCount > 0)
+            {
+                PioSimPop(sim, &sim->osr);
+                sim->osrShifted = 0;
+            }
+            return true;
+        }
+
+        case PIO_OP_PUSH_PULL:
+        {
+            bool pull = (instruction >> 7) & 1;
+            bool conditional = (instruction >> 6) & 1;
+            bool block = (instruction >> 5) & 1;
+
+            if (!pull)
+            {
+                if (!conditional || sim->isrShifted >= sim->pushThreshold)
+                {
+                    sim->isr = 0;
+                    sim->isrShifted = 0;
+                }
+                return true;
+            }
+
+            if (conditional && sim->osrShifted < sim->pullThreshold)
+            {
+                return true;
+            }
+
+            if (sim->txCount == 0)
+            {
+                if (block)
+                {
+                    sim->txStall = true;
+                    return false;
+                }
+
+                //  Non-blocking pull from an empty FIFO copies X
+                sim->osr = sim->x;
+            }
+            else
+            {
+                PioSimPop(sim, &sim->osr);
+            }
+            sim->osrShifted = 0;
+            return true;
+        }
+
+        case PIO_OP_MOV:
+        {
+            int operation = (instruction >> 3) & 3;
+            int source = instruction & 7;
+            uint32_t data = 0;
+
+            switch (source)
+            {
+                case 0: data = PioSimReadPins(sim); break;
+                case 1: data = sim->x; break;
+                case 2: data = sim->y; break;
+                case 3: data = 0; break;
+
+                //  STATUS with the default EXECCTRL, TX level below 0 never holds
+                case 5: data = 0; break;
+
+                case 6: data = sim->isr; break;
+                case 7: data = sim->osr; break;
+                default:
+                    sim->error = "MOV from a reserved source";
+                    return false;
+            }
+
+            if (operation == 1)
+            {
+                data = ~data;
+            }
+            else if (operation == 2)
+            {
+                data = PioSimReverse(data);
+            }
+
+            switch (field)
+            {
+                case 0: PioSimWritePins(sim, sim->outBase, sim->outCount, data); break;
+                case 1: sim->x = data; break;
+                case 2: sim->y = data; break;
+                case 5: sim->pc = data & 31; *jumped = true; break;
+                case 6: sim->isr = data; sim->isrShifted = 0; break;
+                case 7: sim->osr = data; sim->osrShifted = 0; break;
+                default:
+                    sim->error = "MOV EXEC or to a reserved destination is not simulated";
+                    return false;
+            }
+            return true;
+        }
+
+        case PIO_OP_IRQ:
+            sim->error = "IRQ is not simulated";
+            return false;
+
+        case PIO_OP_SET:
+            switch (field)
+            {
+                case 0: PioSimWritePins(sim, sim->setBase, sim->setCount, index); break;
+                case 1: sim->x = index; break;
+                case 2: sim->y = index; break;
+                case 4: PioSimWritePindirs(sim, sim->setBase, sim->setCount, index); break;
+                default:
+                    sim->error = "SET to a reserved destination";
+                    return false;
+            }
+            return true;
+    }
+
+    return true;
+}
+
+//
+//  One state machine clock
+//
+static void PioSimTick(struct PioSimStruct* sim)
+{
+    if (sim->delay > 0 && !sim->forcedPending)
+    {
+        sim->delay--;
+        return;
+    }
+
+    uint16_t instruction = sim->instructions[sim->pc];
+    bool forced = sim->forcedPending;
+
+    //  A forced instruction takes over from a stalled one, and only moves the pc if it jumps
+    if (forced)
+    {
+        instruction = sim->forced;
+        sim->forcedPending = false;
+        sim->delay = 0;
+    }
+
+    int delayBits = 5 - sim->sidesetCount;
+    int delayField = (instruction >> 8) & 0x1F;
+    bool jumped = false;
+
+    bool completed = PioSimExecute(sim, instruction, &jumped);
+
+    //  Side-set happens as the instruction issues, whether or not it stalls, and wins over the instruction's own write
+    if (sim->sidesetCount > 0)
+    {
+        int side = delayField >> delayBits;
+        int sideBits = sim->sidesetCount;
+
+        if (sim->sidesetOptional)
+        {
+            sideBits--;
+            if (!((side >> sideBits) & 1))
+            {
+                sideBits = 0;
+            }
+        }
+
+        if (sideBits > 0)
+        {
+            PioSimWritePins(sim, sim->sidesetBase, sideBits, side);
+        }
+    }
+
+    if (!completed)
+    {
+        return;
+    }
+
+    sim->delay = delayField & ((1 << delayBits) - 1);
+
+    if (!jumped && !forced)
+    {
+        sim->pc = sim->pc == sim->wrap ? sim->wrapTarget : (sim->pc + 1) & 31;
+    }
+}
+
+static void PioSimRecord(struct PioSimStruct* sim)
+{
+    if (sim->transitionCount == sim->transitionCapacity)
+    {
+        sim->transitionCapacity = sim->transitionCapacity ? sim->transitionCapacity * 2 : 4096;
+        sim->transitions = realloc(sim->transitions, sim->transitionCapacity * sizeof(struct PioSimTransition));
+    }
+
+    sim->transitions[sim->transitionCount].cycle = sim->cycle;
+    sim->transitions[sim->transitionCount].pins = sim->pins & sim->watch;
+    sim->transitionCount++;
+}
+
+bool PioSimRun(struct PioSimStruct* sim, uint64_t cycles)
+{
+    for (uint64_t i = 0; i < cycles && sim->error == NULL; i++)
+    {
+        uint32_t before = sim->pins & sim->watch;
+
+        //  One state machine clock every clockDivider / 256 system clocks on average, fractions by dithering
+        sim->dividerCount += 1 << 8;
+        if (sim->dividerCount >= sim->clockDivider)
+        {
+            sim->dividerCount -= sim->clockDivider;
+            PioSimTick(sim);
+        }
+
+        if ((sim->pins & sim->watch) != before || sim->cycle == 0)
+        {
+            PioSimRecord(sim);
+        }
+
+        sim->cycle++;
+    }
+
+    return sim->error == NULL;
+}
+
+void PioSimFree(struct PioSimStruct* sim)
+{
+    free(sim->transitions);
+    sim->transitions = NULL;
+    sim->transitionCount = 0;
+    sim->transitionCapacity = 0;
+}
@@ -0,0 +1,122 @@
+#ifndef PICOPIXOS_PIO_SIM_H
+#define PICOPIXOS_PIO_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  RP2040 PIO State Machine Simulator
+//
+//  One state machine, stepped a system clock cycle at a time: the fractional clock divider, instruction
+//  execution with side-set and delays, the OSR/ISR with autopull and autopush, and the TX FIFO.  Pin levels
+//  are recorded as transitions for pixwave to measure.
+//
+//  Everything pioasm emits for ws2812.pio is covered, plus the rest of the instruction set apart from WAIT
+//  on IRQ and IRQs between state machines.  Anything unsupported stops the simulation with an error rather than
+//  guessing.
+//
+
+#define PIO_SIM_MAX_INSTRUCTIONS 32
+#define PIO_SIM_FIFO_JOINED 8
+
+//  Level change on the watched pins, cycle counts system clocks
+struct PioSimTransition
+{
+    uint64_t cycle;
+    uint32_t pins;
+};
+
+struct PioSimStruct
+{
+    //
+    //  Program and configuration, as the SDK's pio_sm_config would set them
+    //
+    uint16_t instructions[PIO_SIM_MAX_INSTRUCTIONS];
+    int wrapTarget;
+    int wrap;
+
+    //  Side-set bits including the enable bit when optional
+    int sidesetCount;
+    bool sidesetOptional;
+    int sidesetBase;
+
+    int outBase;
+    int outCount;
+    int setBase;
+    int setCount;
+    int inBase;
+    int jmpPin;
+
+    bool outShiftRight;
+    bool autopull;
+    int pullThreshold;
+    bool inShiftRight;
+    bool autopush;
+    int pushThreshold;
+
+    //  16.8 fixed point divider
+    uint32_t clockDivider;
+
+    int fifoDepth;
+
+    //
+    //  State
+    //
+    uint32_t x;
+    uint32_t y;
+    uint32_t osr;
+    int osrShifted;
+    uint32_t isr;
+    int isrShifted;
+    int pc;
+    int delay;
+
+    uint32_t txFifo[PIO_SIM_FIFO_JOINED];
+    int txHead;
+    int txCount;
+
+    uint32_t pins;
+    uint32_t pindirs;
+
+    uint32_t dividerCount;
+    uint64_t cycle;
+
+    //  FDEBUG TXSTALL, set whenever a pull stalls on an empty FIFO
+    bool txStall;
+
+    //  Written to SMx_INSTR, runs on the next state machine clock in place of the program
+    bool forcedPending;
+    uint16_t forced;
+
+    const char* error;
+
+    //
+    //  Waveform, every change of (pins & watch)
+    //
+    uint32_t watch;
+    struct PioSimTransition* transitions;
+    int transitionCount;
+    int transitionCapacity;
+};
+
+//  Load a program at offset 0 with the SDK's default configuration
+void PioSimInit(struct PioSimStruct* sim, const uint16_t* instructions, int length, int wrapTarget, int wrap);
+
+//  Same rounding as sm_config_set_clkdiv
+void PioSimSetClockDivider(struct PioSimStruct* sim, float divider);
+
+//  Queue a word for the state machine, false if the FIFO is full
+bool PioSimPush(struct PioSimStruct* sim, uint32_t word);
+
+bool PioSimFifoFull(const struct PioSimStruct* sim);
+
+//  pio_sm_exec, the instruction runs instead of whatever the state machine is on or stalled at.  One that
+//  stalls itself is dropped rather than held the way EXEC_STALLED would.
+void PioSimExec(struct PioSimStruct* sim, uint16_t instruction);
+
+//  Run for a number of system clock cycles, false once something unsupported has been hit
+bool PioSimRun(struct PioSimStruct* sim, uint64_t cycles);
+
+void PioSimFree(struct PioSimStruct* sim);
+
+#endif
@@ -0,0 +1,215 @@
+//
+//  pixaudio - Make test audio for the host build and run audio through the device's analyser
+//
+//  Files are raw signed 16 bit little endian mono at AUDIO_SAMPLE_RATE, what the host HAL plays as ADC input
+//  when PICOPIXOS_AUDIO names one.  -g writes one:
+//
+//      tone        A sine at -f Hz
+//      sweep       A sine gliding from 50 Hz to the top of the range and back
+//      beat        Kick drum thumps at 120 bpm over a quiet 2 kHz tone
+//      noise       White noise
+//
+//  Otherwise the file is analysed block by block through the same code the device runs, converted to 12 bit ADC
+//  samples the way the host HAL does it, printing the band levels every -e blocks and the time each block took.
+//
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio.h"
+#include "fast_random.h"
+
+static struct AudioAnalyserStruct Analyser;
+
+static double MonotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] file\n"
+            "  -g kind     Write tone, sweep, beat or noise to file instead of analysing it\n"
+            "  -f hz       Tone frequency (default 1000)\n"
+            "  -a percent  Amplitude, of full scale (default 50)\n"
+            "  -s seconds  Length to write (default 10)\n"
+            "  -e blocks   Print levels every this many blocks when analysing (default 16)\n",
+            name);
+}
+
+static int Generate(const char* path, const char* kind, double frequency, double amplitude, double seconds)
+{
+    FILE* output = fopen(path, "wb");
+    if (output == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    long count = (long) (seconds * AUDIO_SAMPLE_RATE);
+    uint32_t state = FAST_RANDOM_SEED;
+    double phase = 0;
+
+    for (long i = 0; i < count; i++)
+    {
+        double t = (double) i / AUDIO_SAMPLE_RATE;
+        double value;
+
+        if (strcmp(kind, "tone") == 0)
+        {
+            value = sin(2 * M_PI * frequency * t);
+        }
+        else if (strcmp(kind, "sweep") == 0)
+        {
+            //  Up and back in log frequency over the whole length
+            double position = t / seconds * 2;
+            if (position > 1)
+            {
+                position = 2 - position;
+            }
+            phase += 2 * M_PI * 50 * pow(AUDIO_SAMPLE_RATE / 2 / 50.0, position) / AUDIO_SAMPLE_RATE;
+            value = sin(phase);
+        }
+        else if (strcmp(kind, "beat") == 0)
+        {
+            //  A 60 Hz thump dying away over 100 ms every half second
+            double since = fmod(t, 0.5);
+            value = sin(2 * M_PI * 60 * since) * exp(-since * 30) + 0.05 * sin(2 * M_PI * 2000 * t);
+        }
+        else if (strcmp(kind, "noise") == 0)
+        {
+            value = FastRandomRange(&state, 65536) / 32768.0 - 1;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown kind %s\n", kind);
+            fclose(output);
+            return 1;
+        }
+
+        int sample = (int) lround(value * amplitude * 32767);
+        sample = sample < -32768 ? -32768 : sample > 32767 ? 32767 : sample;
+        uint8_t bytes[2] = {(uint8_t) sample, (uint8_t) (sample >> 8)};
+        fwrite(bytes, 1, 2, output);
+    }
+
+    fclose(output);
+    printf("Wrote %ld samples (%.1f s at %d Hz) to %s\n", count, seconds, AUDIO_SAMPLE_RATE, path);
+    return 0;
+}
+
+static int Analyse(const char* path, int every)
+{
+    FILE* input = fopen(path, "rb");
+    if (input == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    AudioAnalyserInit(&Analyser);
+
+    printf("block    ms  level");
+    for (int band = 0; band < AUDIO_BANDS; band++)
+    {
+        printf(" %5d", AudioBandEdges[band] * AUDIO_SAMPLE_RATE / AUDIO_BLOCK_SAMPLES);
+    }
+    printf("  beats\n");
+
+    uint8_t bytes[AUDIO_BLOCK_SAMPLES * 2];
+    uint16_t samples[AUDIO_BLOCK_SAMPLES];
+    double totalSeconds = 0;
+    double worstSeconds = 0;
+    long blocks = 0;
+
+    while (fread(bytes, 2, AUDIO_BLOCK_SAMPLES, input) == AUDIO_BLOCK_SAMPLES)
+    {
+        //  As the host HAL hands them over
+        for (int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        {
+            int16_t sample = (int16_t) (bytes[i * 2] | bytes[i * 2 + 1] << 8);
+            samples[i] = (uint16_t) ((sample >> 4) + 2048);
+        }
+
+        double start = MonotonicSeconds();
+        AudioAnalyse(&Analyser, samples);
+        double elapsed = MonotonicSeconds() - start;
+
+        totalSeconds += elapsed;
+        if (elapsed > worstSeconds)
+        {
+            worstSeconds = elapsed;
+        }
+
+        if (blocks % every == 0)
+        {
+            const struct AudioLevels* levels = &Analyser.levels;
+
+            printf("%5ld %5ld  %5d", blocks, blocks * AUDIO_BLOCK_SAMPLES * 1000 / AUDIO_SAMPLE_RATE, levels->level);
+            for (int band = 0; band < AUDIO_BANDS; band++)
+            {
+                printf(" %5d", levels->bands[band]);
+            }
+            printf("  %5lu\n", (unsigned long) levels->beats);
+        }
+        blocks++;
+    }
+
+    fclose(input);
+
+    if (blocks == 0)
+    {
+        fprintf(stderr, "%s is shorter than a block\n", path);
+        return 1;
+    }
+
+    printf("%ld blocks, %lu beats, analysis %.2f us per block on average, %.2f us at worst (a block is %.0f us)\n",
+           blocks, (unsigned long) Analyser.levels.beats, totalSeconds / blocks * 1e6, worstSeconds * 1e6,
+           AUDIO_BLOCK_SAMPLES * 1e6 / AUDIO_SAMPLE_RATE);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* kind = NULL;
+    double frequency = 1000;
+    double amplitude = 50;
+    double seconds = 10;
+    int every = 16;
+    int option;
+
+    while ((option = getopt(argc, argv, "g:f:a:s:e:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'g': kind = optarg; break;
+            case 'f': frequency = atof(optarg); break;
+            case 'a': amplitude = atof(optarg); break;
+            case 's': seconds = atof(optarg); break;
+            case 'e': every = atoi(optarg); break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1 || every < 1 || seconds <= 0 || amplitude < 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (kind != NULL)
+    {
+        return Generate(argv[optind], kind, frequency, amplitude / 100, seconds);
+    }
+
+    return Analyse(argv[optind], every);
+}
@@ -0,0 +1,476 @@
+//
+//  piximage - Pack pictures into a Pico Pix OS indexed colour image
+//
+//  Takes binary PPM (P6) files, one frame each and all the same size, builds a palette of up to 256 colours
+//  across them and LZW codes every frame the way the device decodes it.  Pictures with more colours are
+//  quantised by dropping low bits from every channel until the palette fits.  With -t each frame after the
+//  first only codes the pixels that changed, the rest are transparent and keep the frame before.
+//
+//  The container goes in the flash animation slot for the Flash Image effect.  -s sends the frames to a device
+//  as IMAGE frames over the binary frame stream instead, one every delay.  -v decodes the container back through
+//  the device's decoder and checks every frame against the quantised source.
+//
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "animation.h"
+#include "crc.h"
+#include "image.h"
+#include "stream.h"
+
+#define MAX_FRAMES 4096
+
+struct Picture
+{
+    int width;
+    int height;
+    uint8_t* rgb;
+};
+
+static struct Picture Frames[MAX_FRAMES];
+static struct ImageEncoderStruct Encoder;
+static struct ImageDecoderStruct Decoder;
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] file.ppm...\n"
+            "  -d ms       Time each frame is shown (default 100)\n"
+            "  -t          Code unchanged pixels as transparent after the first frame\n"
+            "  -o file     Output image (default image.ppi)\n"
+            "  -s device   Send the frames as stream IMAGE frames instead of writing an image\n"
+            "  -v          Check every frame decodes back to the quantised source\n",
+            name);
+}
+
+//
+//  Skip whitespace and # comments between PPM header fields
+//
+static int ReadPpmNumber(FILE* input)
+{
+    int c = fgetc(input);
+
+    while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+    {
+        if (c == '#')
+        {
+            while (c != '\n' && c != EOF)
+            {
+                c = fgetc(input);
+            }
+        }
+        c = fgetc(input);
+    }
+
+    int value = -1;
+    while (c >= '0' && c <= '9')
+    {
+        value = (value < 0 ? 0 : value * 10) + (c - '0');
+        c = fgetc(input);
+    }
+
+    return value;
+}
+
+static bool ReadPpm(const char* path, struct Picture* picture)
+{
+    FILE* input = fopen(path, "rb");
+    if (input == NULL)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool valid = fgetc(input) == 'P' && fgetc(input) == '6';
+    picture->width = ReadPpmNumber(input);
+    picture->height = ReadPpmNumber(input);
+    int maximum = ReadPpmNumber(input);
+
+    if (!valid || picture->width <= 0 || picture->height <= 0 || maximum != 255)
+    {
+        fprintf(stderr, "%s isn't an 8 bit binary PPM\n", path);
+        fclose(input);
+        return false;
+    }
+
+    size_t length = (size_t) picture->width * picture->height * 3;
+    picture->rgb = malloc(length);
+
+    if (fread(picture->rgb, length, 1, input) != 1)
+    {
+        fprintf(stderr, "%s is short\n", path);
+        fclose(input);
+        return false;
+    }
+
+    fclose(input);
+    return true;
+}
+
+//
+//  Palette of every distinct colour with channels cut to bits, false if there are more than fit
+//
+static bool BuildPalette(int frameCount, int pixels, int bits, uint8_t* palette, int* paletteSize, int limit)
+{
+    uint8_t mask = (uint8_t) (0xFF << (8 - bits));
+    *paletteSize = 0;
+
+    for (int f = 0; f < frameCount; f++)
+    {
+        const uint8_t* rgb = Frames[f].rgb;
+
+        for (int i = 0; i < pixels * 3; i += 3)
+        {
+            uint8_t red = rgb[i] & mask;
+            uint8_t green = rgb[i + 1] & mask;
+            uint8_t blue = rgb[i + 2] & mask;
+
+            int j = 0;
+            while (j < *paletteSize &&
+                   (palette[j * 3] != red || palette[j * 3 + 1] != green || palette[j * 3 + 2] != blue))
+            {
+                j++;
+            }
+
+            if (j == *paletteSize)
+            {
+                if (*paletteSize == limit)
+                {
+                    return false;
+                }
+                palette[j * 3] = red;
+                palette[j * 3 + 1] = green;
+                palette[j * 3 + 2] = blue;
+                (*paletteSize)++;
+            }
+        }
+    }
+
+    return true;
+}
+
+//
+//  Palette indices of a frame, which is already known to be all palette colours once cut to bits
+//
+static void IndexFrame(const uint8_t* rgb, int pixels, int bits, const uint8_t* palette, int paletteSize,
+                       uint8_t* indices)
+{
+    uint8_t mask = (uint8_t) (0xFF << (8 - bits));
+
+    for (int i = 0; i < pixels; i++)
+    {
+        const uint8_t* pixel = rgb + i * 3;
+        int j = 0;
+
+        while (j < paletteSize - 1 && ((pixel[0] & mask) != palette[j * 3] ||
+                                       (pixel[1] & mask) != palette[j * 3 + 1] ||
+                                       (pixel[2] & mask) != palette[j * 3 + 2]))
+        {
+            j++;
+        }
+        indices[i] = (uint8_t) j;
+    }
+}
+
+static int OpenDevice(const char* path)
+{
+    int fd = open(path, O_WRONLY | O_NOCTTY | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (isatty(fd))
+    {
+        struct termios options;
+        tcgetattr(fd, &options);
+        cfmakeraw(&options);
+        tcsetattr(fd, TCSANOW, &options);
+    }
+
+    return fd;
+}
+
+//
+//  Send every frame whole as a stream IMAGE frame
+//
+static int SendFrames(const char* device, int frameCount, const uint8_t* palette, int paletteSize, int minCodeSize,
+                      uint8_t* const* indices, int delayMs)
+{
+    int fd = OpenDevice(device);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    int pixels = Frames[0].width * Frames[0].height;
+    uint8_t* frame = malloc(STREAM_HEADER_LENGTH + STREAM_IMAGE_HEADER_LENGTH + IMAGE_MAX_COLOURS * 3 +
+                            IMAGE_LZW_MAX_LENGTH(pixels) + STREAM_CRC_LENGTH);
+    uint8_t* payload = frame + STREAM_HEADER_LENGTH;
+    long total = 0;
+
+    for (int f = 0; f < frameCount; f++)
+    {
+        payload[0] = Frames[0].width & 0xFF;
+        payload[1] = (Frames[0].width >> 8) & 0xFF;
+        payload[2] = Frames[0].height & 0xFF;
+        payload[3] = (Frames[0].height >> 8) & 0xFF;
+        payload[4] = (uint8_t) minCodeSize;
+        payload[5] = (uint8_t) (paletteSize - 1);
+        memcpy(payload + STREAM_IMAGE_HEADER_LENGTH, palette, paletteSize * 3);
+
+        size_t payloadLength = STREAM_IMAGE_HEADER_LENGTH + paletteSize * 3;
+        payloadLength += ImageEncodeLzw(&Encoder, payload + payloadLength, indices[f], pixels, minCodeSize);
+
+        StreamWriteHeader(frame, STREAM_FRAME_IMAGE, (uint16_t) f, (uint32_t) payloadLength);
+
+        uint32_t crc = Crc32(frame + STREAM_SYNC_LENGTH, STREAM_HEADER_LENGTH - STREAM_SYNC_LENGTH + payloadLength);
+        for (int i = 0; i < STREAM_CRC_LENGTH; i++)
+        {
+            payload[payloadLength + i] = (crc >> (8 * i)) & 0xFF;
+        }
+
+        size_t frameLength = STREAM_HEADER_LENGTH + payloadLength + STREAM_CRC_LENGTH;
+        if (write(fd, frame, frameLength) != (ssize_t) frameLength)
+        {
+            fprintf(stderr, "Write failed: %s\n", strerror(errno));
+            break;
+        }
+        total += (long) frameLength;
+
+        usleep((useconds_t) delayMs * 1000);
+    }
+
+    printf("Sent %d frames, %ld bytes\n", frameCount, total);
+
+    free(frame);
+    close(fd);
+    return 0;
+}
+
+//
+//  Decode the built image frame by frame and compare with the quantised source
+//
+static long VerifyImage(const uint8_t* image, uint32_t length, int frameCount, int bits)
+{
+    struct ImageStruct opened;
+    if (!ImageOpen(&opened, image, length))
+    {
+        fprintf(stderr, "verify: the image doesn't open\n");
+        return 1;
+    }
+
+    int width = Frames[0].width;
+    int height = Frames[0].height;
+    int pixels = width * height;
+    struct PixelMatrixLayout layout = {(uint16_t) width, (uint16_t) height, 1, 1, 0, 0};
+    struct PixelMatrixStruct matrix;
+
+    if (!PixelMatrixInit(&matrix, &layout, pixels))
+    {
+        fprintf(stderr, "verify: %d x %d is more than a matrix holds, not checked\n", width, height);
+        return 0;
+    }
+
+    int* decoded = calloc(pixels, sizeof(int));
+    uint8_t mask = (uint8_t) (0xFF << (8 - bits));
+    long mismatches = 0;
+
+    for (int f = 0; f < frameCount; f++)
+    {
+        ImageRenderNext(&opened, &Decoder, decoded, pixels, &matrix);
+
+        for (int i = 0; i < pixels; i++)
+        {
+            const uint8_t* pixel = Frames[f].rgb + i * 3;
+            int expected = (pixel[1] & mask) << 16 | (pixel[0] & mask) << 8 | (pixel[2] & mask);
+
+            if (decoded[i] != expected)
+            {
+                fprintf(stderr, "frame %d: pixel %d is %06X, expected %06X\n", f, i, decoded[i], expected);
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    printf("verify frames=%d mismatches=%ld\n", frameCount, mismatches);
+
+    free(decoded);
+    PixelMatrixFree(&matrix);
+    return mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    int delayMs = 100;
+    bool transparent = false;
+    bool verify = false;
+    const char* outputPath = "image.ppi";
+    const char* device = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:to:s:vh")) != -1)
+    {
+        switch (option)
+        {
+            case 'd': delayMs = atoi(optarg); break;
+            case 't': transparent = true; break;
+            case 'o': outputPath = optarg; break;
+            case 's': device = optarg; break;
+            case 'v': verify = true; break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int frameCount = argc - optind;
+    if (frameCount == 0 || frameCount > MAX_FRAMES || delayMs < 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    for (int f = 0; f < frameCount; f++)
+    {
+        if (!ReadPpm(argv[optind + f], &Frames[f]))
+        {
+            return 1;
+        }
+
+        if (Frames[f].width != Frames[0].width || Frames[f].height != Frames[0].height)
+        {
+            fprintf(stderr, "%s isn't the same size as %s\n", argv[optind + f], argv[optind]);
+            return 1;
+        }
+    }
+
+    if (Frames[0].width > 0xFFFF || Frames[0].height > 0xFFFF)
+    {
+        fprintf(stderr, "Frames are too big\n");
+        return 1;
+    }
+
+    //  Keep a palette entry spare for transparency
+    int pixels = Frames[0].width * Frames[0].height;
+    int limit = transparent && frameCount > 1 ? IMAGE_MAX_COLOURS - 1 : IMAGE_MAX_COLOURS;
+    uint8_t palette[IMAGE_MAX_COLOURS * 3];
+    int paletteSize = 0;
+    int bits = 8;
+
+    while (!BuildPalette(frameCount, pixels, bits, palette, &paletteSize, limit))
+    {
+        bits--;
+    }
+
+    if (bits < 8)
+    {
+        printf("More than %d colours, quantised to %d bits per channel\n", limit, bits);
+    }
+
+    int transparentIndex = -1;
+    if (limit < IMAGE_MAX_COLOURS)
+    {
+        transparentIndex = paletteSize;
+        memset(palette + paletteSize * 3, 0, 3);
+        paletteSize++;
+    }
+
+    int minCodeSize = 2;
+    while (1 << minCodeSize < paletteSize)
+    {
+        minCodeSize++;
+    }
+
+    uint8_t** indices = malloc(sizeof(uint8_t*) * frameCount);
+    for (int f = 0; f < frameCount; f++)
+    {
+        indices[f] = malloc(pixels);
+        IndexFrame(Frames[f].rgb, pixels, bits, palette, paletteSize - (transparentIndex >= 0), indices[f]);
+    }
+
+    if (device != NULL)
+    {
+        return SendFrames(device, frameCount, palette, paletteSize, minCodeSize, indices, delayMs);
+    }
+
+    //  Palette then every frame after the header, the header goes in last once the lengths are known
+    size_t capacity = sizeof(struct ImageHeader) + sizeof(palette) +
+                      (size_t) frameCount * (IMAGE_FRAME_HEADER_LENGTH + IMAGE_LZW_MAX_LENGTH(pixels));
+    uint8_t* image = malloc(capacity);
+    uint8_t* frames = image + sizeof(struct ImageHeader) + paletteSize * 3;
+    uint8_t* coded = malloc(pixels);
+    uint32_t framesLength = 0;
+
+    memcpy(image + sizeof(struct ImageHeader), palette, paletteSize * 3);
+
+    for (int f = 0; f < frameCount; f++)
+    {
+        memcpy(coded, indices[f], pixels);
+
+        if (transparentIndex >= 0 && f > 0)
+        {
+            for (int i = 0; i < pixels; i++)
+            {
+                if (indices[f][i] == indices[f - 1][i])
+                {
+                    coded[i] = (uint8_t) transparentIndex;
+                }
+            }
+        }
+
+        uint8_t* frame = frames + framesLength;
+        uint32_t length = (uint32_t) ImageEncodeLzw(&Encoder, frame + IMAGE_FRAME_HEADER_LENGTH, coded, pixels,
+                                                    minCodeSize);
+
+        for (int i = 0; i < 4; i++)
+        {
+            frame[IMAGE_FRAME_LENGTH + i] = (length >> (8 * i)) & 0xFF;
+            frame[IMAGE_FRAME_DELAY + i] = ((uint32_t) delayMs >> (8 * i)) & 0xFF;
+        }
+
+        framesLength += IMAGE_FRAME_HEADER_LENGTH + length;
+    }
+
+    struct ImageHeader header;
+    ImageHeaderInit(&header, (uint16_t) Frames[0].width, (uint16_t) Frames[0].height, (uint16_t) frameCount,
+                    palette, (uint16_t) paletteSize, (uint8_t) minCodeSize, transparentIndex, frames, framesLength);
+    memcpy(image, &header, sizeof(header));
+
+    uint32_t length = sizeof(header) + paletteSize * 3 + framesLength;
+
+    FILE* output = fopen(outputPath, "wb");
+    if (output == NULL || fwrite(image, length, 1, output) != 1 || fclose(output) != 0)
+    {
+        fprintf(stderr, "Can't write %s: %s\n", outputPath, strerror(errno));
+        return 1;
+    }
+
+    printf("%d frames of %d x %d, %d colours, %lu bytes (%.1f%% of RGB)\n", frameCount, Frames[0].width,
+           Frames[0].height, paletteSize, (unsigned long) length, 100.0 * length / ((double) pixels * 3 * frameCount));
+
+    if (length > ANIMATION_FLASH_SIZE)
+    {
+        fprintf(stderr, "Warning: larger than the %d bytes set aside in flash, the effect will refuse it\n",
+                ANIMATION_FLASH_SIZE);
+    }
+
+    printf("Load with: picotool load -o 0x%08X %s\n", 0x10000000 + ANIMATION_FLASH_OFFSET, outputPath);
+
+    int result = 0;
+    if (verify)
+    {
+        result = VerifyImage(image, length, frameCount, bits) ? 2 : 0;
+    }
+
+    return result;
+}
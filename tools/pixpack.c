@@ -0,0 +1,215 @@
+//
+//  pixpack - Pack raw RGB frames into a Pico Pix OS flash animation
+//
+//  Takes raw RGB files (3 bytes per pixel, frames back to back, any number of files) and writes the container
+//  the Flash Playback effect reads straight out of XIP flash.  Pixels are packed for the string's pixel format on
+//  the way in (-f, G, R, B by default), so the device only has to DMA them to the PIO, and the device won't play
+//  them on a string set to any other format.  With no input files a rolling rainbow is generated instead.
+//
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "animation.h"
+#include "pixel_format.h"
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] [file...]\n"
+            "  -n pixels   Pixels per frame (default 24)\n"
+            "  -f format   Pixel format by name or number, GRB, RGB, BRG, BGR, RBG, GBR, GRBW or RGBW (default GRB)\n"
+            "  -r fps      Playback frame rate (default 30)\n"
+            "  -g frames   Frames of test pattern to generate when no files are given (default 256)\n"
+            "  -o file     Output container (default animation.ppa)\n",
+            name);
+}
+
+//
+//  Same rainbow pixsend uses, R, G, B
+//
+static void FillTestPattern(uint8_t* frame, int pixels, long number)
+{
+    for (int i = 0; i < pixels; i++)
+    {
+        int position = (int) ((i * 8 + number * 4) % 768);
+        int level = position % 256;
+        uint8_t red = 0, green = 0, blue = 0;
+
+        if (position < 256)
+        {
+            red = 255 - level;
+            green = level;
+        }
+        else if (position < 512)
+        {
+            green = 255 - level;
+            blue = level;
+        }
+        else
+        {
+            blue = 255 - level;
+            red = level;
+        }
+
+        frame[i * 3] = red;
+        frame[i * 3 + 1] = green;
+        frame[i * 3 + 2] = blue;
+    }
+}
+
+//
+//  R, G, B to the bytes the format's words put on the wire, the same packers the device uses for put_pixel
+//
+static size_t PackFrame(uint8_t* packed, const uint8_t* frame, int pixels, int format)
+{
+    PixelFormatPacker pack = PixelFormatGetPacker(format);
+    int pixelBytes = PixelFormatBits(format) / 8;
+    uint8_t* output = packed;
+
+    for (int i = 0; i < pixels; i++)
+    {
+        int pixel = frame[i * 3 + 1] << 16 | frame[i * 3] << 8 | frame[i * 3 + 2];
+        uint32_t word;
+
+        pack(&pixel, &word, 1);
+        for (int j = 0; j < pixelBytes; j++)
+        {
+            *output++ = (uint8_t) (word >> (24 - 8 * j));
+        }
+    }
+
+    return (size_t) (output - packed);
+}
+
+int main(int argc, char** argv)
+{
+    int pixels = 24;
+    double fps = 30;
+    long generate = 256;
+    const char* outputPath = "animation.ppa";
+    int format = PIXEL_FORMAT_GRB;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:f:r:g:o:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'n': pixels = atoi(optarg); break;
+            case 'f':
+                format = -1;
+                for (int i = 0; i < PIXEL_FORMATS; i++)
+                {
+                    if (strcasecmp(optarg, PixelFormatNames[i]) == 0 || (optarg[0] == '0' + i && optarg[1] == 0))
+                    {
+                        format = i;
+                    }
+                }
+                if (format < 0)
+                {
+                    fprintf(stderr, "No pixel format called %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r': fps = atof(optarg); break;
+            case 'g': generate = atol(optarg); break;
+            case 'o': outputPath = optarg; break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (pixels <= 0 || fps <= 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    FILE* output = fopen(outputPath, "wb");
+    if (output == NULL)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", outputPath, strerror(errno));
+        return 1;
+    }
+
+    //  Header goes in last, once the frame count is known
+    struct AnimationHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, output);
+
+    size_t frameLength = (size_t) pixels * 3;
+    uint8_t* frame = malloc(frameLength);
+    uint8_t* packed = malloc((size_t) pixels * 4);
+    size_t packedLength = 0;
+    long frames = 0;
+
+    if (optind == argc)
+    {
+        for (; frames < generate; frames++)
+        {
+            FillTestPattern(frame, pixels, frames);
+            packedLength = PackFrame(packed, frame, pixels, format);
+            fwrite(packed, packedLength, 1, output);
+        }
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        FILE* input = fopen(argv[i], "rb");
+        if (input == NULL)
+        {
+            fprintf(stderr, "Can't open %s: %s\n", argv[i], strerror(errno));
+            return 1;
+        }
+
+        long fileFrames = 0;
+        while (fread(frame, frameLength, 1, input) == 1)
+        {
+            packedLength = PackFrame(packed, frame, pixels, format);
+            fwrite(packed, packedLength, 1, output);
+            fileFrames++;
+        }
+
+        if (fileFrames == 0)
+        {
+            fprintf(stderr, "%s is shorter than one frame\n", argv[i]);
+        }
+
+        frames += fileFrames;
+        fclose(input);
+    }
+
+    if (frames == 0)
+    {
+        fprintf(stderr, "No frames to pack\n");
+        return 1;
+    }
+
+    AnimationHeaderInit(&header, (uint32_t) pixels, (uint32_t) frames, (uint32_t) (1000000.0 / fps), (uint32_t) format);
+    fseek(output, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output);
+
+    if (fclose(output) != 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    long total = (long) sizeof(header) + frames * (long) header.frameStride;
+    printf("%ld frames of %d %s pixels at %.1f fps, %ld bytes\n", frames, pixels, PixelFormatNames[format], fps, total);
+
+    if (total > ANIMATION_FLASH_SIZE)
+    {
+        fprintf(stderr, "Warning: larger than the %d bytes set aside in flash, playback will refuse it\n",
+                ANIMATION_FLASH_SIZE);
+    }
+
+    printf("Load with: picotool load -o 0x%08X %s\n", 0x10000000 + ANIMATION_FLASH_OFFSET, outputPath);
+
+    return 0;
+}
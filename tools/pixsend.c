@@ -0,0 +1,463 @@
+//
+//  pixsend - Push frames to Pico Pix OS over the binary frame stream
+//
+//  Sends frames built from a raw RGB file (3 bytes per pixel, frames back to back) or a generated test pattern
+//  and reports the achieved frames and bytes per second.  Any writable path works as the device, so a pty or
+//  /dev/null can stand in for the hardware when checking host side throughput.
+//
+//  With -z each frame goes out as whichever of RAW, KEY or DELTA is smallest, with a KEY frame forced every
+//  -k frames.  -v runs every encoded frame back through the device's stream parser and checks it decodes to
+//  the source pixels.
+//
+//  -t sends a single TEXT frame instead, setting the message the Ticker effect scrolls.  Commit the settings on
+//  the device to keep it over a restart.
+//
+#include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crc.h"
+#include "stream.h"
+
+struct SenderSettings
+{
+    const char* device;
+    const char* sourceFile;
+    int pixels;
+    long frames;
+    double targetFps;
+    const char* pattern;
+    bool compress;
+    int keyInterval;
+    bool verify;
+    const char* text;
+};
+
+static double MonotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] device\n"
+            "  -n pixels   Pixels per frame (default 24)\n"
+            "  -c frames   Frames to send, 0 for no limit (default 1000)\n"
+            "  -r fps      Target frame rate, 0 to send as fast as possible (default 0)\n"
+            "  -f file     Raw RGB frames to send instead of the test pattern\n"
+            "  -p pattern  Test pattern, rainbow or chase (default rainbow)\n"
+            "  -z          Compress frames with KEY/DELTA run length coding\n"
+            "  -k frames   Frames between forced KEY frames when compressing (default 60)\n"
+            "  -v          Check every frame decodes back to the source through the stream parser\n"
+            "  -t text     Send text for the Ticker effect instead of frames\n",
+            name);
+}
+
+//
+//  Put the port in raw mode so nothing gets translated on the way out
+//
+static int OpenDevice(const char* path)
+{
+    int fd = open(path, O_WRONLY | O_NOCTTY | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (isatty(fd))
+    {
+        struct termios options;
+        tcgetattr(fd, &options);
+        cfmakeraw(&options);
+        tcsetattr(fd, TCSANOW, &options);
+    }
+
+    return fd;
+}
+
+static int WriteAll(int fd, const uint8_t* data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+//
+//  Rolling rainbow so dropped or torn frames are easy to spot on the string
+//
+static void FillTestPattern(uint8_t* payload, int pixels, long frame)
+{
+    for (int i = 0; i < pixels; i++)
+    {
+        int position = (int) ((i * 8 + frame * 4) % 768);
+        int level = position % 256;
+        uint8_t red = 0, green = 0, blue = 0;
+
+        if (position < 256)
+        {
+            red = 255 - level;
+            green = level;
+        }
+        else if (position < 512)
+        {
+            green = 255 - level;
+            blue = level;
+        }
+        else
+        {
+            blue = 255 - level;
+            red = level;
+        }
+
+        payload[i * 3] = red;
+        payload[i * 3 + 1] = green;
+        payload[i * 3 + 2] = blue;
+    }
+}
+
+//
+//  A few dots moving over black, mostly unchanged between frames like a lot of real content
+//
+static void FillChasePattern(uint8_t* payload, int pixels, long frame)
+{
+    memset(payload, 0, (size_t) pixels * 3);
+
+    for (int dot = 0; dot < 4; dot++)
+    {
+        int position = (int) ((frame * (dot + 1) + dot * pixels / 4) % pixels);
+        payload[position * 3 + dot % 3] = 255;
+    }
+}
+
+//
+//  Verifier, decodes the sent bytes the same way the device does
+//
+struct Verifier
+{
+    struct StreamParserStruct parser;
+    int* buffers[2];
+    int front;
+    long mismatches;
+};
+
+static void VerifierInit(struct Verifier* verifier, int pixels)
+{
+    StreamParserInit(&verifier->parser);
+    verifier->buffers[0] = calloc(pixels, sizeof(int));
+    verifier->buffers[1] = calloc(pixels, sizeof(int));
+    verifier->front = 0;
+    verifier->mismatches = 0;
+}
+
+static void VerifierCheck(struct Verifier* verifier, const uint8_t* frame, size_t frameLength,
+                          const uint8_t* pixels, int pixelCount, long frameNumber)
+{
+    int* back = verifier->buffers[verifier->front ^ 1];
+
+    StreamParserSetTarget(&verifier->parser, back, pixelCount);
+    StreamParserSetReference(&verifier->parser, verifier->buffers[verifier->front]);
+    StreamParserFeed(&verifier->parser, frame, (int) frameLength);
+
+    if (!verifier->parser.frameReady)
+    {
+        fprintf(stderr, "frame %ld: not accepted by the parser\n", frameNumber);
+        verifier->mismatches++;
+        return;
+    }
+    verifier->parser.frameReady = false;
+    verifier->front ^= 1;
+
+    for (int i = 0; i < pixelCount; i++)
+    {
+        int expected = (pixels[i * 3] << 8) | (pixels[i * 3 + 1] << 16) | pixels[i * 3 + 2];
+        if (back[i] != expected)
+        {
+            fprintf(stderr, "frame %ld: pixel %d is %06X, expected %06X\n", frameNumber, i, back[i], expected);
+            verifier->mismatches++;
+            return;
+        }
+    }
+}
+
+//
+//  Ticker message as a single TEXT frame
+//
+static int SendText(int fd, const char* text)
+{
+    uint8_t frame[STREAM_HEADER_LENGTH + STREAM_TEXT_MAX_LENGTH + STREAM_CRC_LENGTH];
+    size_t length = strlen(text);
+
+    if (length > STREAM_TEXT_MAX_LENGTH)
+    {
+        fprintf(stderr, "Text is %zu characters, the most is %d\n", length, STREAM_TEXT_MAX_LENGTH);
+        return 1;
+    }
+
+    StreamWriteHeader(frame, STREAM_FRAME_TEXT, 0, (uint32_t) length);
+    memcpy(frame + STREAM_HEADER_LENGTH, text, length);
+
+    uint32_t crc = Crc32(frame + STREAM_SYNC_LENGTH, STREAM_HEADER_LENGTH - STREAM_SYNC_LENGTH + length);
+    for (int i = 0; i < STREAM_CRC_LENGTH; i++)
+    {
+        frame[STREAM_HEADER_LENGTH + length + i] = (crc >> (8 * i)) & 0xFF;
+    }
+
+    if (WriteAll(fd, frame, STREAM_HEADER_LENGTH + length + STREAM_CRC_LENGTH) < 0)
+    {
+        fprintf(stderr, "Write failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    printf("Sent %zu characters of ticker text\n", length);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    struct SenderSettings settings = {NULL, NULL, 24, 1000, 0.0, "rainbow", false, 60, false, NULL};
+    int option;
+
+    while ((option = getopt(argc, argv, "n:c:r:f:p:zk:vt:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'n': settings.pixels = atoi(optarg); break;
+            case 'c': settings.frames = atol(optarg); break;
+            case 'r': settings.targetFps = atof(optarg); break;
+            case 'f': settings.sourceFile = optarg; break;
+            case 'p': settings.pattern = optarg; break;
+            case 'z': settings.compress = true; break;
+            case 'k': settings.keyInterval = atoi(optarg); break;
+            case 'v': settings.verify = true; break;
+            case 't': settings.text = optarg; break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1 || settings.pixels <= 0 || settings.keyInterval <= 0 ||
+        (strcmp(settings.pattern, "rainbow") != 0 && strcmp(settings.pattern, "chase") != 0))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    settings.device = argv[optind];
+
+    FILE* source = NULL;
+    if (settings.sourceFile != NULL)
+    {
+        source = fopen(settings.sourceFile, "rb");
+        if (source == NULL)
+        {
+            fprintf(stderr, "Can't open %s: %s\n", settings.sourceFile, strerror(errno));
+            return 1;
+        }
+    }
+
+    int fd = OpenDevice(settings.device);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    if (settings.text != NULL)
+    {
+        int result = SendText(fd, settings.text);
+        close(fd);
+        return result;
+    }
+
+    //  Header, payload and CRC go out in a single write
+    size_t pixelBytes = (size_t) settings.pixels * 3;
+    size_t maxPayload = STREAM_RLE_MAX_PAYLOAD(pixelBytes / 3);
+    uint8_t* frame = malloc(STREAM_HEADER_LENGTH + maxPayload + STREAM_CRC_LENGTH);
+    uint8_t* payload = frame + STREAM_HEADER_LENGTH;
+
+    //  Source pixels for this frame and the last one, for deltas
+    uint8_t* pixels = malloc(pixelBytes);
+    uint8_t* previous = malloc(pixelBytes);
+    uint8_t* encoded = malloc(maxPayload);
+
+    struct Verifier verifier;
+    if (settings.verify)
+    {
+        VerifierInit(&verifier, settings.pixels);
+    }
+
+    double start = MonotonicSeconds();
+    double lastReport = start;
+    long reportFrames = 0;
+    uint64_t reportBytes = 0;
+    uint64_t totalBytes = 0;
+    uint64_t totalRawBytes = 0;
+    long typeCounts[3] = {0, 0, 0};
+    long sent;
+
+    for (sent = 0; settings.frames == 0 || sent < settings.frames; sent++)
+    {
+        if (source != NULL)
+        {
+            //  Loop the file
+            if (fread(pixels, 1, pixelBytes, source) != pixelBytes)
+            {
+                rewind(source);
+                if (fread(pixels, 1, pixelBytes, source) != pixelBytes)
+                {
+                    fprintf(stderr, "%s is shorter than one frame\n", settings.sourceFile);
+                    break;
+                }
+            }
+        }
+        else if (strcmp(settings.pattern, "chase") == 0)
+        {
+            FillChasePattern(pixels, settings.pixels, sent);
+        }
+        else
+        {
+            FillTestPattern(pixels, settings.pixels, sent);
+        }
+
+        //  Pick the smallest encoding
+        uint8_t frameType = STREAM_FRAME_RAW;
+        size_t payloadLength = pixelBytes;
+        memcpy(payload, pixels, pixelBytes);
+
+        if (settings.compress)
+        {
+            size_t length = StreamEncodeRle(encoded, pixels, NULL, settings.pixels);
+            if (length < payloadLength)
+            {
+                frameType = STREAM_FRAME_KEY;
+                payloadLength = length;
+                memcpy(payload, encoded, length);
+            }
+
+            if (sent % settings.keyInterval != 0)
+            {
+                length = StreamEncodeRle(encoded, pixels, previous, settings.pixels);
+                if (length < payloadLength)
+                {
+                    frameType = STREAM_FRAME_DELTA;
+                    payloadLength = length;
+                    memcpy(payload, encoded, length);
+                }
+            }
+        }
+
+        uint8_t* swap = previous;
+        previous = pixels;
+        pixels = swap;
+
+        typeCounts[frameType]++;
+        totalRawBytes += pixelBytes;
+
+        StreamWriteHeader(frame, frameType, (uint16_t) sent, (uint32_t) payloadLength);
+
+        uint32_t crc = Crc32(frame + STREAM_SYNC_LENGTH, STREAM_HEADER_LENGTH - STREAM_SYNC_LENGTH + payloadLength);
+        for (int i = 0; i < STREAM_CRC_LENGTH; i++)
+        {
+            payload[payloadLength + i] = (crc >> (8 * i)) & 0xFF;
+        }
+
+        size_t frameLength = STREAM_HEADER_LENGTH + payloadLength + STREAM_CRC_LENGTH;
+
+        if (settings.verify)
+        {
+            VerifierCheck(&verifier, frame, frameLength, previous, settings.pixels, sent);
+        }
+
+        if (WriteAll(fd, frame, frameLength) < 0)
+        {
+            fprintf(stderr, "Write failed: %s\n", strerror(errno));
+            break;
+        }
+
+        reportFrames++;
+        reportBytes += frameLength;
+        totalBytes += frameLength;
+
+        //  Pace to the target rate
+        if (settings.targetFps > 0)
+        {
+            double due = start + (sent + 1) / settings.targetFps;
+            double now = MonotonicSeconds();
+            if (due > now)
+            {
+                usleep((useconds_t) ((due - now) * 1e6));
+            }
+        }
+
+        double now = MonotonicSeconds();
+        if (now - lastReport >= 1.0)
+        {
+            printf("fps=%.1f bytes_per_s=%.0f frames=%ld\n",
+                   reportFrames / (now - lastReport), reportBytes / (now - lastReport), sent + 1);
+            fflush(stdout);
+            lastReport = now;
+            reportFrames = 0;
+            reportBytes = 0;
+        }
+    }
+
+    double elapsed = MonotonicSeconds() - start;
+    if (elapsed <= 0)
+    {
+        elapsed = 1e-9;
+    }
+
+    printf("total frames=%ld bytes=%llu seconds=%.3f fps=%.1f bytes_per_s=%.0f\n",
+           sent, (unsigned long long) totalBytes, elapsed, sent / elapsed, totalBytes / elapsed);
+
+    if (settings.compress)
+    {
+        printf("compression raw=%ld key=%ld delta=%ld ratio=%.3f\n",
+               typeCounts[STREAM_FRAME_RAW], typeCounts[STREAM_FRAME_KEY], typeCounts[STREAM_FRAME_DELTA],
+               totalRawBytes ? (double) totalBytes / totalRawBytes : 0.0);
+    }
+
+    int result = 0;
+    if (settings.verify)
+    {
+        printf("verify frames=%ld mismatches=%ld\n", sent, verifier.mismatches);
+        result = verifier.mismatches ? 2 : 0;
+        free(verifier.buffers[0]);
+        free(verifier.buffers[1]);
+    }
+
+    free(frame);
+    free(pixels);
+    free(previous);
+    free(encoded);
+    close(fd);
+    if (source != NULL)
+    {
+        fclose(source);
+    }
+
+    return result;
+}
@@ -0,0 +1,225 @@
+//
+//  pixshow - Build a Pico Pix OS keyframe show from a text script
+//
+//  The script is one statement per line, # starts a comment:
+//
+//      pixels 60                   Pixels the show is written for
+//      duration 4000               Loop length in ms
+//      track 0 60 [spread 20]      Pixels first..first+count-1 follow the keys below, each spread ms behind the last
+//      key 0 ff0000 [easing]       Colour at a time in ms, easing into the next key is
+//                                  step, linear (default), in, out or inout
+//
+//  Keys belong to the track above them and must be in time order.  -t renders the show at a time on the host
+//  through the same code the device runs, to check a script without loading it.
+//
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "animation.h"
+#include "show.h"
+
+#define MAX_TRACKS 1024
+#define MAX_KEYS 16384
+
+static struct ShowTrack Tracks[MAX_TRACKS];
+static struct ShowKey Keys[MAX_KEYS];
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] script\n"
+            "  -o file     Output show (default show.ppk)\n"
+            "  -t ms       Print the pixels at this time instead of writing the show\n",
+            name);
+}
+
+static int ParseEasing(const char* word)
+{
+    const char* names[] = {"step", "linear", "in", "out", "inout"};
+
+    for (int i = 0; i < 5; i++)
+    {
+        if (strcmp(word, names[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    const char* outputPath = "show.ppk";
+    long previewMs = -1;
+    int option;
+
+    while ((option = getopt(argc, argv, "o:t:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'o': outputPath = optarg; break;
+            case 't': previewMs = atol(optarg); break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    FILE* script = fopen(argv[optind], "r");
+    if (script == NULL)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    unsigned pixels = 0;
+    unsigned long duration = 0;
+    int trackCount = 0;
+    uint32_t keyCount = 0;
+    char line[256];
+    int lineNumber = 0;
+
+    while (fgets(line, sizeof(line), script) != NULL)
+    {
+        lineNumber++;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = 0;
+        }
+
+        char word[32], extra[32];
+        unsigned first, count;
+        unsigned long time, colour;
+        int spread = 0;
+        int fields;
+
+        if (sscanf(line, "%31s", word) != 1)
+        {
+            continue;
+        }
+
+        if (strcmp(word, "pixels") == 0 && sscanf(line, "%*s %u", &pixels) == 1 && pixels <= 0xFFFF)
+        {
+            continue;
+        }
+
+        if (strcmp(word, "duration") == 0 && sscanf(line, "%*s %lu", &duration) == 1)
+        {
+            continue;
+        }
+
+        if (strcmp(word, "track") == 0 && (fields = sscanf(line, "%*s %u %u %31s %d", &first, &count, extra, &spread)) >= 2 &&
+            (fields == 2 || (fields == 4 && strcmp(extra, "spread") == 0)) && trackCount < MAX_TRACKS)
+        {
+            if (first + count > pixels)
+            {
+                fprintf(stderr, "%s:%d: track runs past the %u pixels\n", argv[optind], lineNumber, pixels);
+                return 1;
+            }
+
+            struct ShowTrack* track = &Tracks[trackCount++];
+            track->firstPixel = (uint16_t) first;
+            track->pixelCount = (uint16_t) count;
+            track->firstKey = (uint16_t) keyCount;
+            track->keyCount = 0;
+            track->spreadMs = (int16_t) spread;
+            track->reserved = 0;
+            continue;
+        }
+
+        if (strcmp(word, "key") == 0 && (fields = sscanf(line, "%*s %lu %lx %31s", &time, &colour, extra)) >= 2 &&
+            trackCount > 0 && keyCount < MAX_KEYS)
+        {
+            struct ShowTrack* track = &Tracks[trackCount - 1];
+            int easing = fields == 3 ? ParseEasing(extra) : SHOW_EASE_LINEAR;
+
+            if (easing < 0)
+            {
+                fprintf(stderr, "%s:%d: unknown easing %s\n", argv[optind], lineNumber, extra);
+                return 1;
+            }
+
+            if (track->keyCount > 0 && time < Keys[keyCount - 1].timeMs)
+            {
+                fprintf(stderr, "%s:%d: keys must be in time order\n", argv[optind], lineNumber);
+                return 1;
+            }
+
+            struct ShowKey* key = &Keys[keyCount++];
+            key->timeMs = (uint32_t) time;
+            key->red = (uint8_t) (colour >> 16);
+            key->green = (uint8_t) (colour >> 8);
+            key->blue = (uint8_t) colour;
+            key->easing = (uint8_t) easing;
+            track->keyCount++;
+            continue;
+        }
+
+        fprintf(stderr, "%s:%d: can't make sense of this\n", argv[optind], lineNumber);
+        return 1;
+    }
+
+    fclose(script);
+
+    if (pixels == 0 || duration == 0 || trackCount == 0)
+    {
+        fprintf(stderr, "A show needs pixels, duration and at least one track\n");
+        return 1;
+    }
+
+    //  Header, tracks and keys back to back, the way the device reads them
+    struct ShowHeader header;
+    ShowHeaderInit(&header, (uint16_t) pixels, (uint32_t) duration, Tracks, (uint16_t) trackCount, Keys, keyCount);
+
+    size_t length = sizeof(header) + header.dataLength;
+    uint8_t* image = malloc(length);
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + sizeof(header), Tracks, trackCount * sizeof(struct ShowTrack));
+    memcpy(image + sizeof(header) + trackCount * sizeof(struct ShowTrack), Keys, keyCount * sizeof(struct ShowKey));
+
+    struct ShowStruct show;
+    if (!ShowOpen(&show, image, (uint32_t) length))
+    {
+        fprintf(stderr, "Built show doesn't check out, is every track keyed?\n");
+        return 1;
+    }
+
+    if (previewMs >= 0)
+    {
+        int* rendered = calloc(pixels, sizeof(int));
+        ShowRender(&show, (uint64_t) previewMs * 1000, rendered, (int) pixels);
+
+        for (unsigned i = 0; i < pixels; i++)
+        {
+            //  Back from GRB to RGB
+            printf("%02X%02X%02X%c", (rendered[i] >> 8) & 0xFF, (rendered[i] >> 16) & 0xFF, rendered[i] & 0xFF,
+                   (i % 8 == 7 || i == pixels - 1) ? '\n' : ' ');
+        }
+        return 0;
+    }
+
+    FILE* output = fopen(outputPath, "wb");
+    if (output == NULL || fwrite(image, length, 1, output) != 1 || fclose(output) != 0)
+    {
+        fprintf(stderr, "Can't write %s: %s\n", outputPath, strerror(errno));
+        return 1;
+    }
+
+    printf("%d tracks, %lu keys, %zu bytes\n", trackCount, (unsigned long) keyCount, length);
+    printf("Load with: picotool load -o 0x%08X %s\n", 0x10000000 + ANIMATION_FLASH_OFFSET, outputPath);
+
+    return 0;
+}
@@ -0,0 +1,308 @@
+//
+//  pixtrace - Turn a Pico Pix OS event trace dump into a Chrome trace / Perfetto timeline
+//
+//  Reads the data port (or a file the dump was captured to) until a whole dump has come through, checks its CRC
+//  and writes JSON that chrome://tracing and ui.perfetto.dev open directly.  With a port, start pixtrace first,
+//  then press T on the console.
+//
+//  Each core is a thread.  Core 0's frames show as spans from the start of rendering to the last pixel being
+//  queued, everything else as instant events with the raw argument alongside.
+//
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crc.h"
+#include "trace.h"
+
+//  Largest dump the device can send, with room to spare
+#define TRACE_DUMP_MAX (sizeof(struct TraceDumpHeader) + TRACE_CORES * (4 + TRACE_EVENTS_PER_CORE * sizeof(struct TraceEvent)) + 4)
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] source\n"
+            "  -o file     JSON output (default stdout)\n"
+            "  -w seconds  How long to wait for a dump on a port (default 30)\n",
+            name);
+}
+
+static const char* CommandNames[] = {"", "Effect", "Pause", "Output", "Commit", "Boot frame", "Stream"};
+
+static uint32_t ReadLittle32(const uint8_t* data)
+{
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24;
+}
+
+//
+//  Read until buffer holds a dump starting at its first byte, returns its length or 0
+//
+static size_t ReadDump(int fd, uint8_t* buffer, size_t size, int waitSeconds)
+{
+    size_t length = 0;
+    time_t deadline = time(NULL) + waitSeconds;
+
+    while (time(NULL) < deadline)
+    {
+        struct pollfd input = {fd, POLLIN, 0};
+        if (poll(&input, 1, 200) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t received = read(fd, buffer + length, size - length);
+        if (received <= 0)
+        {
+            //  End of a file
+            if (received == 0 || errno != EAGAIN)
+            {
+                break;
+            }
+            continue;
+        }
+        length += received;
+
+        //  Throw away anything before the magic
+        size_t start = 0;
+        while (start + 4 <= length && ReadLittle32(buffer + start) != TRACE_MAGIC)
+        {
+            start++;
+        }
+        if (start + 4 > length)
+        {
+            start = length > 3 ? length - 3 : 0;
+        }
+        memmove(buffer, buffer + start, length - start);
+        length -= start;
+
+        //  Walk the per core counts to see how long the dump is
+        size_t expected = sizeof(struct TraceDumpHeader);
+        bool complete = length >= expected;
+
+        for (int core = 0; complete && core < TRACE_CORES; core++)
+        {
+            if (length < expected + 4)
+            {
+                complete = false;
+                break;
+            }
+            uint32_t count = ReadLittle32(buffer + expected);
+            if (count > TRACE_EVENTS_PER_CORE)
+            {
+                //  Not really a dump, look for the next one
+                memmove(buffer, buffer + 1, length - 1);
+                length--;
+                complete = false;
+                break;
+            }
+            expected += 4 + count * sizeof(struct TraceEvent);
+        }
+
+        if (complete && length >= expected + 4)
+        {
+            return expected + 4;
+        }
+    }
+
+    return 0;
+}
+
+//
+//  Event time back to microseconds since boot, from how far it is behind the dump
+//
+static uint64_t EventTime(const struct TraceDumpHeader* header, uint32_t timeUs)
+{
+    return header->timeUs - (uint32_t) ((uint32_t) header->timeUs - timeUs);
+}
+
+static void WriteInstant(FILE* output, int core, uint64_t time, const char* name, const char* argumentName, unsigned argument)
+{
+    fprintf(output, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"args\":{\"%s\":%u}}",
+            name, core, (unsigned long long) time, argumentName, argument);
+}
+
+static void WriteJson(FILE* output, const uint8_t* dump)
+{
+    struct TraceDumpHeader header;
+    memcpy(&header, dump, sizeof(header));
+
+    const uint8_t* position = dump + sizeof(header);
+
+    //  Everything after this starts with a comma
+    fprintf(output, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    fprintf(output, "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Pico Pix OS\"}}");
+
+    for (int core = 0; core < header.cores; core++)
+    {
+        uint32_t count = ReadLittle32(position);
+        position += 4;
+
+        fprintf(output, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Core %d\"}}",
+                core, core);
+
+        //  Open frame span, if any
+        bool inFrame = false;
+        uint64_t frameStart = 0;
+        unsigned frameEffect = 0;
+
+        for (uint32_t i = 0; i < count; i++, position += sizeof(struct TraceEvent))
+        {
+            struct TraceEvent event;
+            memcpy(&event, position, sizeof(event));
+            uint64_t time = EventTime(&header, event.timeUs);
+
+            switch (event.type)
+            {
+                case TRACE_FRAME_START:
+                    inFrame = true;
+                    frameStart = time;
+                    frameEffect = event.argument;
+                    break;
+
+                case TRACE_FRAME_PRESENT:
+                    if (inFrame)
+                    {
+                        fprintf(output, ",\n{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu,"
+                                        "\"args\":{\"effect\":%u,\"pixels\":%u}}",
+                                core, (unsigned long long) frameStart, (unsigned long long) (time - frameStart),
+                                frameEffect, event.argument);
+                    }
+                    inFrame = false;
+                    break;
+
+                case TRACE_DMA_DONE:
+                    WriteInstant(output, core, time, "DMA done", "frame", event.argument);
+                    break;
+
+                case TRACE_STREAM_FRAME:
+                    WriteInstant(output, core, time, "Stream frame", "sequence", event.argument);
+                    break;
+
+                case TRACE_COMMAND:
+                {
+                    unsigned command = event.argument >> 8;
+                    fprintf(output, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":%d,\"ts\":%llu,"
+                                    "\"args\":{\"value\":%u}}",
+                            command < sizeof(CommandNames) / sizeof(CommandNames[0]) ? CommandNames[command] : "Command",
+                            core, (unsigned long long) time, event.argument & 0xFF);
+                    break;
+                }
+
+                case TRACE_INPUT:
+                    WriteInstant(output, core, time, "Input", "key", event.argument);
+                    break;
+
+                case TRACE_USB_TX_DROP:
+                    WriteInstant(output, core, time, "USB TX drop", "bytes", event.argument);
+                    break;
+
+                case TRACE_UNDERRUN:
+                    WriteInstant(output, core, time, "Underrun", "count", event.argument);
+                    break;
+
+                case TRACE_DUMP:
+                    WriteInstant(output, core, time, "Trace dump", "core", core);
+                    break;
+
+                default:
+                    WriteInstant(output, core, time, "Unknown", "type", event.type);
+                    break;
+            }
+        }
+    }
+
+    fprintf(output, "\n]}\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* outputPath = NULL;
+    int waitSeconds = 30;
+    int option;
+
+    while ((option = getopt(argc, argv, "o:w:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'o': outputPath = optarg; break;
+            case 'w': waitSeconds = atoi(optarg); break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+
+    if (isatty(fd))
+    {
+        struct termios options;
+        tcgetattr(fd, &options);
+        cfmakeraw(&options);
+        tcsetattr(fd, TCSANOW, &options);
+        fprintf(stderr, "Waiting for a dump, press T on the console\n");
+    }
+
+    static uint8_t dump[TRACE_DUMP_MAX];
+    size_t length = ReadDump(fd, dump, sizeof(dump), waitSeconds);
+    close(fd);
+
+    if (length == 0)
+    {
+        fprintf(stderr, "No complete trace dump in %s\n", argv[optind]);
+        return 1;
+    }
+
+    if (Crc32(dump, length - 4) != ReadLittle32(dump + length - 4))
+    {
+        fprintf(stderr, "Trace dump CRC mismatch\n");
+        return 1;
+    }
+
+    struct TraceDumpHeader header;
+    memcpy(&header, dump, sizeof(header));
+    if (header.format != TRACE_FORMAT || header.cores != TRACE_CORES)
+    {
+        fprintf(stderr, "Trace dump format %u with %u cores, expected format %u\n", header.format, header.cores, TRACE_FORMAT);
+        return 1;
+    }
+
+    FILE* output = outputPath != NULL ? fopen(outputPath, "w") : stdout;
+    if (output == NULL)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", outputPath, strerror(errno));
+        return 1;
+    }
+
+    WriteJson(output, dump);
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    fprintf(stderr, "%u + %u events, ending %.3f s after boot\n", ReadLittle32(dump + sizeof(header)),
+            ReadLittle32(dump + sizeof(header) + 4 + ReadLittle32(dump + sizeof(header)) * sizeof(struct TraceEvent)),
+            header.timeUs / 1e6);
+
+    return 0;
+}
@@ -0,0 +1,807 @@
+//
+//  pixwave - Run the ws2812.pio programs on the PIO simulator and check the waveform they produce
+//
+//  Feeds frames of random pixels through the TX FIFO as fast as it takes them, the way DMA would, records the
+//  pin levels cycle by cycle, then decodes the waveform back into bits and compares them with what was sent.
+//  Every high and low time is checked against the chosen LED's datasheet limits:
+//
+//      PIXWAVE program=ws2812 clock_hz=125000000 bit_hz=800000 divider=15.625 lanes=1 pixels=64 profile=ws2812b
+//      TIMING t0h min_ns=368.0 max_ns=376.0 limit_ns=250-550 samples=1531 violations=0
+//      ...
+//      DECODE frames_sent=2 frames_seen=2 bit_errors=0
+//      RESULT pass
+//
+//  Exits non-zero on any violation or decode mismatch, so a timing change can be checked without a scope.
+//  -g stops feeding the FIFO for a while in the middle of the first frame, to see what an underrun does to the
+//  string once the FIFO has drained.  -o writes the
+//  waveform as a VCD file for GTKWave.
+//
+//  ws2812 runs with the firmware's default WS2812B profile unless -P picks another: the program gets the
+//  profile's delay split and bit rate, the same way hal_pico.c loads it, and is checked against that LED's limits
+//  unless -t says otherwise.  -f runs the program as ws2812.pio has it at another rate.
+//
+//  -p apa102 (or a clocked -P profile) runs the clocked program, with the start and end frames driven the way
+//  hal_pico.c does.  Data is sampled on each rising clock edge and decoded as APA102 frames, and the clock's
+//  high and low times and the data setup before each edge are checked.  A -g gap there only stops the clock.
+//
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "pio_sim.h"
+#include "pixel_timing.h"
+
+#define PICO_NO_HARDWARE 1
+#include "ws2812/generated/ws2812.pio.h"
+#include "apa102/generated/apa102.pio.h"
+
+#define PIXWAVE_FRAMES 2
+#define PIXWAVE_MAX_LANES 32
+
+//
+//  LED timing limits in ns, from the datasheets' nominal +/- tolerance
+//
+struct TimingProfile
+{
+    const char* name;
+    uint32_t t0hMin, t0hMax;
+    uint32_t t1hMin, t1hMax;
+    uint32_t t0lMin, t0lMax;
+    uint32_t t1lMin, t1lMax;
+    uint32_t periodMin, periodMax;
+    uint32_t resetMin;
+};
+
+const struct TimingProfile TimingProfiles[] =
+        {
+                //  0.4/0.8 us high, 0.85/0.45 us low, +/-150 ns, 1.25 us +/-600 ns per bit, reset over 50 us
+                {"ws2812b", 250, 550, 650, 950, 700, 1000, 300, 600, 650, 1850, 50000},
+
+                //  0.3/0.6 us high, 0.9/0.6 us low, +/-150 ns, reset over 80 us
+                {"sk6812", 150, 450, 450, 750, 750, 1050, 450, 750, 650, 1850, 80000},
+
+                //  Low speed mode, 0.5/1.2 us high, 2.0/1.3 us low, +/-150 ns, 2.5 us +/-600 ns per bit
+                {"ws2811", 350, 650, 1050, 1350, 1850, 2150, 1150, 1450, 1900, 3100, 50000},
+
+                //  0.3-0.45/0.75-1.0 us high, lows only have a floor, reset over 280 us
+                {"ws2813", 300, 450, 750, 1000, 300, 100000, 300, 100000, 600, 200000, 280000},
+
+                //  What WS2812B parts have been measured to read, rather than the datasheet: a one is any high over
+                //  about 550 ns, a zero under 500, and a low only has to stay under the ~5 us the LED latches on
+                {"ws2812b-measured", 200, 500, 550, 5000, 300, 5000, 300, 5000, 900, 10000, 50000}
+        };
+
+//  Limits each firmware timing profile is checked against by default
+const char* PixelTimingLimits[PIXEL_TIMING_PROFILES] =
+        {"ws2812b", "ws2811", "sk6812", "ws2813", "ws2812b-measured", "apa102", "apa102"};
+
+//  Clocked chips, shortest clock high and low and data setup before the rising edge, in ns
+#define CLOCKED_HIGH_MIN_NS 20
+#define CLOCKED_LOW_MIN_NS 20
+#define CLOCKED_SETUP_MIN_NS 10
+
+enum TimingChecks
+{
+    CHECK_T0H = 0,
+    CHECK_T1H = 1,
+    CHECK_T0L = 2,
+    CHECK_T1L = 3,
+    CHECK_PERIOD = 4,
+    CHECK_RESET = 5,
+    CHECKS = 6
+};
+
+const char* CheckNames[CHECKS] = {"t0h", "t1h", "t0l", "t1l", "period", "reset"};
+
+struct CheckResult
+{
+    double min;
+    double max;
+    uint32_t limitMin;
+    uint32_t limitMax;
+    uint32_t samples;
+    uint32_t violations;
+};
+
+struct WaveSettings
+{
+    const char* program;
+    double clockHz;
+    double bitHz;
+    int pixels;
+    int lanes;
+    bool rgbw;
+    const struct TimingProfile* profile;
+    const struct PixelTimingProfile* timing;
+    double gapUs;
+    const char* vcdPath;
+    int brightness;
+};
+
+static void Usage(const char* name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -p program  ws2812, ws2812_parallel or apa102 (default ws2812)\n"
+            "  -c hz       System clock (default 125000000)\n"
+            "  -f hz       Bit rate (default 800000)\n"
+            "  -n pixels   Pixels per frame per lane (default 64)\n"
+            "  -l lanes    Strings driven by ws2812_parallel (default 4)\n"
+            "  -w          32 bit RGBW pixels (ws2812 only)\n"
+            "  -t profile  Timing limits, ws2812b, sk6812, ws2811, ws2813 or ws2812b-measured (default ws2812b)\n"
+            "  -P timing   Firmware timing profile by name or number, ws2812 only (default WS2812B)\n"
+            "  -b level    Global brightness for apa102, 0 to 31 (default 31)\n"
+            "  -g us       Stall the feed this long half way through the first frame\n"
+            "  -o file     Write the waveform as VCD\n",
+            name);
+}
+
+static void CheckSample(struct CheckResult* check, double ns)
+{
+    if (check->samples == 0 || ns < check->min) check->min = ns;
+    if (check->samples == 0 || ns > check->max) check->max = ns;
+    check->samples++;
+
+    //  Clock periods rarely come out whole in ns, don't fail on the rounding
+    if (ns + 0.01 < check->limitMin || (check->limitMax != 0 && ns - 0.01 > check->limitMax))
+    {
+        check->violations++;
+    }
+}
+
+//
+//  Words to push for one bit time of every lane, MSB first
+//
+static int BuildWords(const struct WaveSettings* settings, uint32_t pixels[PIXWAVE_MAX_LANES][1024], int pixelBits,
+                      uint32_t* words)
+{
+    int count = 0;
+
+    if (strcmp(settings->program, "ws2812") == 0)
+    {
+        //  Left justified, the program shifts out MSB first
+        for (int i = 0; i < settings->pixels; i++)
+        {
+            words[count++] = pixelBits == 24 ? pixels[0][i] << 8 : pixels[0][i];
+        }
+        return count;
+    }
+
+    //  One word per bit, a bit per lane, the way ws2812_parallel.c lays out its bit planes
+    for (int i = 0; i < settings->pixels; i++)
+    {
+        for (int bit = pixelBits - 1; bit >= 0; bit--)
+        {
+            uint32_t word = 0;
+            for (int lane = 0; lane < settings->lanes; lane++)
+            {
+                word |= ((pixels[lane][i] >> bit) & 1) << lane;
+            }
+            words[count++] = word;
+        }
+    }
+
+    return count;
+}
+
+static void WriteVcd(const char* path, const struct PioSimStruct* sim, int lanes, double clockHz)
+{
+    FILE* vcd = fopen(path, "w");
+    if (vcd == NULL)
+    {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    fprintf(vcd, "$timescale 1ns $end\n$scope module pio $end\n");
+    for (int lane = 0; lane < lanes; lane++)
+    {
+        fprintf(vcd, "$var wire 1 %c gpio%d $end\n", '!' + lane, lane);
+    }
+    fprintf(vcd, "$upscope $end\n$enddefinitions $end\n");
+
+    uint32_t previous = ~0u;
+    for (int i = 0; i < sim->transitionCount; i++)
+    {
+        fprintf(vcd, "#%.0f\n", sim->transitions[i].cycle * 1e9 / clockHz);
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            uint32_t level = (sim->transitions[i].pins >> lane) & 1;
+            if (level != ((previous >> lane) & 1))
+            {
+                fprintf(vcd, "%u%c\n", level, '!' + lane);
+            }
+        }
+        previous = sim->transitions[i].pins;
+    }
+
+    fclose(vcd);
+}
+
+//
+//  apa102: drive frames the way hal_pico.c does and decode what comes out on the clock edges
+//
+static int RunClocked(struct WaveSettings* settings)
+{
+    struct PioSimStruct sim;
+    uint16_t instructions[PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH];
+
+    PixelTimingClockedProgram(settings->brightness, instructions);
+    PioSimInit(&sim, instructions, PIXEL_TIMING_CLOCKED_PROGRAM_LENGTH, apa102_wrap_target, apa102_wrap);
+
+    //  Data on pin 0, clock on pin 1
+    sim.sidesetCount = 1;
+    sim.sidesetBase = 1;
+    sim.outBase = 0;
+    sim.outCount = 1;
+    sim.setBase = 0;
+    sim.setCount = 1;
+    sim.outShiftRight = false;
+    sim.autopull = true;
+    sim.pullThreshold = 24;
+    sim.fifoDepth = PIO_SIM_FIFO_JOINED;
+    sim.watch = 3;
+    PioSimSetClockDivider(&sim, (float) (settings->clockHz / (2 * settings->bitHz)));
+
+    static uint32_t pixels[PIXWAVE_FRAMES][1024];
+    uint64_t gapCycles = (uint64_t) (settings->gapUs / 1e6 * settings->clockHz);
+
+    //  Starts in the frame routine, waiting for the first start frame
+    PioSimPush(&sim, 32 - 1);
+
+    srand(1);
+    for (int frame = 0; frame < PIXWAVE_FRAMES; frame++)
+    {
+        for (int i = 0; i < settings->pixels; i++)
+        {
+            pixels[frame][i] = ((uint32_t) rand() << 16 ^ rand()) & 0xFFFFFF;
+
+            if (frame == 0 && i == settings->pixels / 2 && gapCycles > 0)
+            {
+                PioSimRun(&sim, gapCycles);
+            }
+
+            while (!PioSimPush(&sim, pixels[frame][i] << 8))
+            {
+                PioSimRun(&sim, 1);
+            }
+        }
+
+        //  HalPixelFrameEnd, wait for a stall at pixel with nothing queued then jump into the frame routine
+        sim.txStall = false;
+        while (!sim.txStall || sim.txCount > 0 || sim.pc != apa102_offset_pixel)
+        {
+            PioSimRun(&sim, 1);
+            if (sim.error != NULL)
+            {
+                break;
+            }
+        }
+        PioSimExec(&sim, apa102_offset_frame);
+        PioSimPush(&sim, PixelTimingClockedFrameBits(settings->pixels) - 1);
+    }
+
+    //  Let the last end frame go out
+    sim.txStall = false;
+    while (sim.error == NULL && (!sim.txStall || sim.pc != apa102_offset_pixel))
+    {
+        PioSimRun(&sim, 1);
+    }
+    PioSimRun(&sim, 64);
+
+    if (sim.error != NULL)
+    {
+        fprintf(stderr, "Simulation stopped at pc %d: %s\n", sim.pc, sim.error);
+        return 1;
+    }
+
+    //
+    //  Clock timing, and the bits on each rising edge
+    //
+    enum ClockedChecks
+    {
+        CLOCKED_HIGH = 0,
+        CLOCKED_LOW = 1,
+        CLOCKED_SETUP = 2,
+        CLOCKED_PERIOD = 3,
+        CLOCKED_CHECKS = 4
+    };
+    const char* clockedNames[CLOCKED_CHECKS] = {"clock_high", "clock_low", "setup", "period"};
+    struct CheckResult checks[CLOCKED_CHECKS];
+    double nsPerCycle = 1e9 / settings->clockHz;
+
+    memset(checks, 0, sizeof(checks));
+    checks[CLOCKED_HIGH].limitMin = CLOCKED_HIGH_MIN_NS;
+    checks[CLOCKED_LOW].limitMin = CLOCKED_LOW_MIN_NS;
+    checks[CLOCKED_SETUP].limitMin = CLOCKED_SETUP_MIN_NS;
+    checks[CLOCKED_PERIOD].limitMin = CLOCKED_HIGH_MIN_NS + CLOCKED_LOW_MIN_NS;
+
+    uint8_t* bits = malloc(sim.transitionCount);
+    long bitCount = 0;
+    uint64_t rise = 0;
+    uint64_t fall = 0;
+    uint64_t dataChange = 0;
+    bool clock = false;
+    bool data = false;
+    bool firstRise = true;
+
+    for (int i = 0; i < sim.transitionCount; i++)
+    {
+        bool newData = sim.transitions[i].pins & 1;
+        bool newClock = sim.transitions[i].pins & 2;
+        uint64_t cycle = sim.transitions[i].cycle;
+
+        if (newData != data)
+        {
+            dataChange = cycle;
+            data = newData;
+        }
+
+        if (newClock == clock)
+        {
+            continue;
+        }
+        clock = newClock;
+
+        if (newClock)
+        {
+            //  Gaps between pixels and frames just hold the clock low, only bit times count
+            if (!firstRise)
+            {
+                double lowNs = (cycle - fall) * nsPerCycle;
+                double periodNs = (cycle - rise) * nsPerCycle;
+
+                if (periodNs < 4 * 1e9 / settings->bitHz)
+                {
+                    CheckSample(&checks[CLOCKED_LOW], lowNs);
+                    CheckSample(&checks[CLOCKED_PERIOD], periodNs);
+                }
+            }
+            if (!firstRise && dataChange >= fall)
+            {
+                CheckSample(&checks[CLOCKED_SETUP], (cycle - dataChange) * nsPerCycle);
+            }
+            firstRise = false;
+            rise = cycle;
+            bits[bitCount++] = data;
+        }
+        else
+        {
+            fall = cycle;
+            CheckSample(&checks[CLOCKED_HIGH], (fall - rise) * nsPerCycle);
+        }
+    }
+
+    //
+    //  32 or more zeros start a frame, LED frames follow for as long as they start 111
+    //
+    uint32_t bitErrors = 0;
+    int framesSeen = 0;
+    long zeros = 0;
+    long bit = 0;
+
+    while (bit < bitCount)
+    {
+        if (!bits[bit])
+        {
+            zeros++;
+            bit++;
+            continue;
+        }
+
+        if (zeros < 32)
+        {
+            //  Ones outside a frame
+            bitErrors++;
+            bit++;
+            continue;
+        }
+        zeros = 0;
+
+        int pixel = 0;
+        while (bit + 32 <= bitCount && bits[bit] && bits[bit + 1] && bits[bit + 2])
+        {
+            uint32_t word = 0;
+            for (int j = 0; j < 32; j++)
+            {
+                word = word << 1 | bits[bit + j];
+            }
+            bit += 32;
+
+            if (framesSeen >= PIXWAVE_FRAMES || pixel >= settings->pixels ||
+                (word >> 24 & 0x1F) != (uint32_t) settings->brightness ||
+                (word & 0xFFFFFF) != pixels[framesSeen][pixel])
+            {
+                bitErrors++;
+            }
+            pixel++;
+        }
+
+        if (pixel != settings->pixels)
+        {
+            bitErrors++;
+        }
+        framesSeen++;
+    }
+    free(bits);
+
+    //
+    //  Report
+    //
+    uint32_t violations = 0;
+
+    printf("PIXWAVE program=apa102 clock_hz=%.0f bit_hz=%.0f divider=%.3f lanes=1 pixels=%d brightness=%d\n",
+           settings->clockHz, settings->bitHz, sim.clockDivider / 256.0, settings->pixels, settings->brightness);
+
+    for (int check = 0; check < CLOCKED_CHECKS; check++)
+    {
+        printf("TIMING %s min_ns=%.1f max_ns=%.1f limit_ns=%u- samples=%u violations=%u\n", clockedNames[check],
+               checks[check].min, checks[check].max, checks[check].limitMin, checks[check].samples,
+               checks[check].violations);
+        violations += checks[check].violations;
+    }
+
+    printf("DECODE frames_sent=%d frames_seen=%d bit_errors=%u\n", PIXWAVE_FRAMES, framesSeen, bitErrors);
+
+    bool pass = violations == 0 && bitErrors == 0 && framesSeen == PIXWAVE_FRAMES;
+    printf("RESULT %s\n", pass ? "pass" : "fail");
+
+    if (settings->vcdPath != NULL)
+    {
+        WriteVcd(settings->vcdPath, &sim, 2, settings->clockHz);
+    }
+
+    PioSimFree(&sim);
+
+    return pass ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    struct WaveSettings settings = {"ws2812", 125000000, 800000, 64, 4, false, &TimingProfiles[0], NULL, 0, NULL, 31};
+    bool limitsChosen = false;
+    bool rateChosen = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:c:f:n:l:wt:P:b:g:o:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'p': settings.program = optarg; break;
+            case 'c': settings.clockHz = atof(optarg); break;
+            case 'f': settings.bitHz = atof(optarg); rateChosen = true; break;
+            case 'n': settings.pixels = atoi(optarg); break;
+            case 'l': settings.lanes = atoi(optarg); break;
+            case 'w': settings.rgbw = true; break;
+            case 'b': settings.brightness = atoi(optarg); break;
+            case 'g': settings.gapUs = atof(optarg); break;
+            case 'o': settings.vcdPath = optarg; break;
+            case 't':
+                settings.profile = NULL;
+                for (unsigned i = 0; i < sizeof(TimingProfiles) / sizeof(TimingProfiles[0]); i++)
+                {
+                    if (strcmp(optarg, TimingProfiles[i].name) == 0)
+                    {
+                        settings.profile = &TimingProfiles[i];
+                    }
+                }
+                if (settings.profile == NULL)
+                {
+                    fprintf(stderr, "No timing profile called %s\n", optarg);
+                    return 1;
+                }
+                limitsChosen = true;
+                break;
+            case 'P':
+                for (int i = 0; i < PIXEL_TIMING_PROFILES; i++)
+                {
+                    if (strcasecmp(optarg, PixelTimingProfiles[i].name) == 0 ||
+                        (optarg[0] == '0' + i && optarg[1] == 0))
+                    {
+                        settings.timing = &PixelTimingProfiles[i];
+                    }
+                }
+                if (settings.timing == NULL)
+                {
+                    fprintf(stderr, "No firmware timing profile called %s\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                Usage(argv[0]);
+                return 1;
+        }
+    }
+
+    //  Without -P or -f, ws2812 runs the way the firmware drives it by default
+    if (settings.timing == NULL && !rateChosen && strcmp(settings.program, "ws2812") == 0)
+    {
+        settings.timing = &PixelTimingProfiles[PIXEL_TIMING_WS2812B];
+    }
+
+    //  Clocked profiles run the clocked program
+    if (settings.timing != NULL && settings.timing->protocol == PIXEL_PROTOCOL_APA102)
+    {
+        settings.program = "apa102";
+        settings.bitHz = settings.timing->bitHz;
+    }
+
+    if (strcmp(settings.program, "apa102") == 0)
+    {
+        if (settings.pixels < 1 || settings.pixels > 1024 || settings.rgbw || settings.brightness < 0 ||
+            settings.brightness > 31)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        if (settings.timing == NULL && settings.bitHz == 800000)
+        {
+            settings.bitHz = PixelTimingProfiles[PIXEL_TIMING_APA102].bitHz;
+        }
+        return RunClocked(&settings);
+    }
+
+    bool parallel = strcmp(settings.program, "ws2812_parallel") == 0;
+    if ((!parallel && strcmp(settings.program, "ws2812") != 0) || settings.pixels < 1 || settings.pixels > 1024 ||
+        settings.lanes < 1 || settings.lanes > PIXWAVE_MAX_LANES || (parallel && (settings.rgbw || settings.timing != NULL)))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    if (!parallel)
+    {
+        settings.lanes = 1;
+    }
+
+    //  The profile sets the rate, and the limits to go with it
+    if (settings.timing != NULL)
+    {
+        settings.bitHz = settings.timing->bitHz;
+
+        for (unsigned i = 0; i < sizeof(TimingProfiles) / sizeof(TimingProfiles[0]) && !limitsChosen; i++)
+        {
+            if (strcmp(PixelTimingLimits[settings.timing - PixelTimingProfiles], TimingProfiles[i].name) == 0)
+            {
+                settings.profile = &TimingProfiles[i];
+            }
+        }
+    }
+
+    //
+    //  Set the state machine up the way ws2812_program_init / ws2812_parallel_program_init do
+    //
+    struct PioSimStruct sim;
+    int cyclesPerBit;
+
+    if (!parallel)
+    {
+        //  Patched with the profile's split if there is one
+        uint16_t instructions[PIXEL_TIMING_PROGRAM_LENGTH];
+        memcpy(instructions, ws2812_program_instructions, sizeof(instructions));
+        cyclesPerBit = ws2812_T1 + ws2812_T2 + ws2812_T3;
+
+        if (settings.timing != NULL)
+        {
+            PixelTimingProgram(settings.timing, instructions);
+            cyclesPerBit = settings.timing->t1 + settings.timing->t2 + settings.timing->t3;
+        }
+
+        PioSimInit(&sim, instructions, PIXEL_TIMING_PROGRAM_LENGTH, ws2812_wrap_target, ws2812_wrap);
+        sim.sidesetCount = 1;
+        sim.sidesetBase = 0;
+        sim.outShiftRight = false;
+        sim.pullThreshold = settings.rgbw ? 32 : 24;
+    }
+    else
+    {
+        PioSimInit(&sim, ws2812_parallel_program_instructions, 4, ws2812_parallel_wrap_target, ws2812_parallel_wrap);
+        sim.outShiftRight = true;
+        sim.pullThreshold = 32;
+        sim.outBase = 0;
+        sim.outCount = settings.lanes;
+        sim.setBase = 0;
+        sim.setCount = settings.lanes;
+        cyclesPerBit = ws2812_parallel_T1 + ws2812_parallel_T2 + ws2812_parallel_T3;
+    }
+    sim.autopull = true;
+    sim.fifoDepth = PIO_SIM_FIFO_JOINED;
+    sim.watch = settings.lanes == 32 ? ~0u : (1u << settings.lanes) - 1;
+
+    float divider = (float) (settings.clockHz / (settings.bitHz * cyclesPerBit));
+    PioSimSetClockDivider(&sim, divider);
+
+    //
+    //  Frames in, with the line left idle long enough to latch after each
+    //
+    static uint32_t pixels[PIXWAVE_FRAMES][PIXWAVE_MAX_LANES][1024];
+    static uint32_t words[1024 * 32];
+    int pixelBits = settings.rgbw ? 32 : 24;
+    uint64_t idleCycles = (uint64_t) (settings.profile->resetMin * 2 / 1e9 * settings.clockHz);
+    uint64_t gapCycles = (uint64_t) (settings.gapUs / 1e6 * settings.clockHz);
+
+    srand(1);
+    for (int frame = 0; frame < PIXWAVE_FRAMES; frame++)
+    {
+        for (int lane = 0; lane < settings.lanes; lane++)
+        {
+            for (int i = 0; i < settings.pixels; i++)
+            {
+                pixels[frame][lane][i] = ((uint32_t) rand() << 16 ^ rand()) & (pixelBits == 32 ? 0xFFFFFFFFu : 0xFFFFFF);
+            }
+        }
+
+        int wordCount = BuildWords(&settings, pixels[frame], pixelBits, words);
+
+        for (int i = 0; i < wordCount; i++)
+        {
+            if (frame == 0 && i == wordCount / 2 && gapCycles > 0)
+            {
+                PioSimRun(&sim, gapCycles);
+            }
+
+            while (!PioSimPush(&sim, words[i]))
+            {
+                PioSimRun(&sim, 1);
+            }
+        }
+
+        while (sim.txCount > 0 || sim.osrShifted < sim.pullThreshold)
+        {
+            PioSimRun(&sim, 1);
+        }
+        PioSimRun(&sim, idleCycles);
+    }
+
+    if (sim.error != NULL)
+    {
+        fprintf(stderr, "Simulation stopped at pc %d: %s\n", sim.pc, sim.error);
+        return 1;
+    }
+
+    //
+    //  Decode each lane and check its timing
+    //
+    struct CheckResult checks[CHECKS];
+    const struct TimingProfile* profile = settings.profile;
+    uint32_t limits[CHECKS][2] =
+            {
+                    {profile->t0hMin, profile->t0hMax},
+                    {profile->t1hMin, profile->t1hMax},
+                    {profile->t0lMin, profile->t0lMax},
+                    {profile->t1lMin, profile->t1lMax},
+                    {profile->periodMin, profile->periodMax},
+                    {profile->resetMin, 0}
+            };
+    uint32_t bitThreshold = (profile->t0hMax + profile->t1hMin) / 2;
+    uint32_t bitErrors = 0;
+    int framesSeen = 0;
+
+    memset(checks, 0, sizeof(checks));
+    for (int check = 0; check < CHECKS; check++)
+    {
+        checks[check].limitMin = limits[check][0];
+        checks[check].limitMax = limits[check][1];
+    }
+
+    double nsPerCycle = 1e9 / settings.clockHz;
+
+    for (int lane = 0; lane < settings.lanes; lane++)
+    {
+        uint32_t mask = 1u << lane;
+        uint64_t rise = 0;
+        uint64_t fall = 0;
+        bool high = false;
+        bool lastBit = false;
+        bool inFrame = false;
+        int frame = 0;
+        long bit = 0;
+
+        for (int i = 0; i < sim.transitionCount; i++)
+        {
+            bool level = sim.transitions[i].pins & mask;
+            uint64_t cycle = sim.transitions[i].cycle;
+
+            if (level == high)
+            {
+                continue;
+            }
+            high = level;
+
+            if (level)
+            {
+                //  Low time before this rise ends the previous bit, or a frame
+                if (inFrame)
+                {
+                    double lowNs = (cycle - fall) * nsPerCycle;
+
+                    if (lowNs >= profile->resetMin)
+                    {
+                        CheckSample(&checks[CHECK_RESET], lowNs);
+                        frame++;
+                        bit = 0;
+                    }
+                    else
+                    {
+                        CheckSample(&checks[lastBit ? CHECK_T1L : CHECK_T0L], lowNs);
+                        CheckSample(&checks[CHECK_PERIOD], (cycle - rise) * nsPerCycle);
+                    }
+                }
+                rise = cycle;
+                inFrame = true;
+                continue;
+            }
+
+            fall = cycle;
+            double highNs = (fall - rise) * nsPerCycle;
+            lastBit = highNs >= bitThreshold;
+            CheckSample(&checks[lastBit ? CHECK_T1H : CHECK_T0H], highNs);
+
+            //  Compare with what was sent, MSB first
+            long pixel = bit / pixelBits;
+            if (frame < PIXWAVE_FRAMES && pixel < settings.pixels)
+            {
+                bool sent = (pixels[frame][lane][pixel] >> (pixelBits - 1 - bit % pixelBits)) & 1;
+                if (sent != lastBit)
+                {
+                    bitErrors++;
+                }
+            }
+            else
+            {
+                bitErrors++;
+            }
+            bit++;
+        }
+
+        //  The idle after the last frame ends it
+        double lowNs = (sim.cycle - fall) * nsPerCycle;
+        CheckSample(&checks[CHECK_RESET], lowNs);
+
+        //  A frame that latched early shows up as an extra one, with the rest of the bits in the wrong place
+        if (frame + 1 > framesSeen)
+        {
+            framesSeen = frame + 1;
+        }
+    }
+
+    //
+    //  Report
+    //
+    uint32_t violations = 0;
+
+    printf("PIXWAVE program=%s clock_hz=%.0f bit_hz=%.0f divider=%.3f lanes=%d pixels=%d profile=%s\n",
+           settings.program, settings.clockHz, settings.bitHz, sim.clockDivider / 256.0, settings.lanes,
+           settings.pixels, profile->name);
+
+    for (int check = 0; check < CHECKS; check++)
+    {
+        printf("TIMING %s min_ns=%.1f max_ns=%.1f limit_ns=%u-", CheckNames[check], checks[check].min, checks[check].max,
+               checks[check].limitMin);
+        if (checks[check].limitMax != 0)
+        {
+            printf("%u", checks[check].limitMax);
+        }
+        printf(" samples=%u violations=%u\n", checks[check].samples, checks[check].violations);
+
+        violations += checks[check].violations;
+    }
+
+    printf("DECODE frames_sent=%d frames_seen=%d bit_errors=%u\n", PIXWAVE_FRAMES, framesSeen, bitErrors);
+
+    bool pass = violations == 0 && bitErrors == 0 && framesSeen == PIXWAVE_FRAMES;
+    printf("RESULT %s\n", pass ? "pass" : "fail");
+
+    if (settings.vcdPath != NULL)
+    {
+        WriteVcd(settings.vcdPath, &sim, settings.lanes, settings.clockHz);
+    }
+
+    PioSimFree(&sim);
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include "hal.h"
+#include "crc.h"
+#include "trace.h"
+
+#define TRACE_CRC_LENGTH 4
+
+struct TraceRingStruct
+{
+    struct TraceEvent events[TRACE_EVENTS_PER_CORE];
+
+    //  Events ever recorded, only written by the ring's own core
+    volatile uint32_t head;
+};
+
+static struct TraceRingStruct TraceRings[TRACE_CORES];
+static volatile bool TraceRecording = true;
+
+//
+//  Dump in progress, a position through the bytes described in trace.h
+//
+struct TraceDumpStruct
+{
+    bool active;
+    struct TraceDumpHeader header;
+    uint32_t first[TRACE_CORES];
+    uint32_t count[TRACE_CORES];
+    uint32_t position;
+    uint32_t length;
+    uint32_t crc;
+};
+
+static struct TraceDumpStruct TraceDump;
+
+void TraceRecord(uint8_t type, uint16_t argument)
+{
+    if (!TraceRecording)
+    {
+        return;
+    }
+
+    struct TraceRingStruct* ring = &TraceRings[HalCoreNumber()];
+    uint32_t head = ring->head;
+    struct TraceEvent* event = &ring->events[head & (TRACE_EVENTS_PER_CORE - 1)];
+
+    event->timeUs = (uint32_t) HalTimeUs();
+    event->type = type;
+    event->reserved = 0;
+    event->argument = argument;
+
+    //  Event has to be in memory before a reader on the other core can see it counted
+    __sync_synchronize();
+    ring->head = head + 1;
+}
+
+bool TraceDumpStart()
+{
+    if (TraceDump.active)
+    {
+        return false;
+    }
+
+    TraceRecord(TRACE_DUMP, 0);
+    TraceRecording = false;
+    __sync_synchronize();
+
+    TraceDump.header.magic = TRACE_MAGIC;
+    TraceDump.header.format = TRACE_FORMAT;
+    TraceDump.header.cores = TRACE_CORES;
+    TraceDump.header.reserved = 0;
+    TraceDump.header.timeUs = HalTimeUs();
+    TraceDump.length = sizeof(struct TraceDumpHeader) + TRACE_CRC_LENGTH;
+
+    for (int core = 0; core < TRACE_CORES; core++)
+    {
+        uint32_t head = TraceRings[core].head;
+
+        //  Leave out the oldest slot of a full ring, the other core may have been part way through reusing it
+        uint32_t count = head < TRACE_EVENTS_PER_CORE - 1 ? head : TRACE_EVENTS_PER_CORE - 1;
+
+        TraceDump.first[core] = head - count;
+        TraceDump.count[core] = count;
+        TraceDump.length += sizeof(uint32_t) + count * sizeof(struct TraceEvent);
+    }
+
+    TraceDump.position = 0;
+    TraceDump.crc = CRC32_INITIAL;
+    TraceDump.active = true;
+
+    return true;
+}
+
+bool TraceDumpActive()
+{
+    return TraceDump.active;
+}
+
+//
+//  Byte at a position through the dump, bar the CRC on the end
+//
+static uint8_t TraceDumpByte(uint32_t position)
+{
+    if (position < sizeof(struct TraceDumpHeader))
+    {
+        return ((const uint8_t*) &TraceDump.header)[position];
+    }
+    position -= sizeof(struct TraceDumpHeader);
+
+    for (int core = 0; core < TRACE_CORES; core++)
+    {
+        if (position < sizeof(uint32_t))
+        {
+            return (uint8_t) (TraceDump.count[core] >> (position * 8));
+        }
+        position -= sizeof(uint32_t);
+
+        uint32_t eventBytes = TraceDump.count[core] * sizeof(struct TraceEvent);
+        if (position < eventBytes)
+        {
+            uint32_t index = (TraceDump.first[core] + position / sizeof(struct TraceEvent)) & (TRACE_EVENTS_PER_CORE - 1);
+            return ((const uint8_t*) &TraceRings[core].events[index])[position % sizeof(struct TraceEvent)];
+        }
+        position -= eventBytes;
+    }
+
+    return 0;
+}
+
+int TraceDumpRead(uint8_t* buffer, int length)
+{
+    if (!TraceDump.active)
+    {
+        return 0;
+    }
+
+    uint32_t crcStart = TraceDump.length - TRACE_CRC_LENGTH;
+    int copied = 0;
+
+    while (copied < length && TraceDump.position < TraceDump.length)
+    {
+        if (TraceDump.position < crcStart)
+        {
+            uint8_t data = TraceDumpByte(TraceDump.position);
+            TraceDump.crc = Crc32UpdateByte(TraceDump.crc, data);
+            buffer[copied++] = data;
+        }
+        else
+        {
+            buffer[copied++] = (uint8_t) (Crc32Final(TraceDump.crc) >> ((TraceDump.position - crcStart) * 8));
+        }
+        TraceDump.position++;
+    }
+
+    //  All gone, back to recording
+    if (copied == 0)
+    {
+        TraceDumpStop();
+    }
+
+    return copied;
+}
+
+void TraceDumpStop()
+{
+    TraceDump.active = false;
+    TraceRecording = true;
+}
@@ -0,0 +1,109 @@
+#ifndef PICOPIXOS_TRACE_H
+#define PICOPIXOS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  Event Trace
+//
+//  Each core records timestamped events into its own ring of the last TRACE_EVENTS_PER_CORE, so recording is
+//  lock free: a core only ever writes its own ring, and bumps the ring's head after the event is in place.
+//
+//  T on the console dumps both rings down the data interface as:
+//
+//      Offset  Size    Field
+//      0       16      struct TraceDumpHeader (little endian)
+//      16      ...     For each core, a uint32_t event count then that many struct TraceEvent, oldest first
+//      ...     4       CRC-32 of everything before it
+//
+//  Event times are the low 32 bits of the microsecond timer, the header carries the full timer at the dump so
+//  tools/pixtrace can put them back on one timeline and write it out as Chrome trace / Perfetto JSON.
+//
+
+//  'PPXT'
+#define TRACE_MAGIC 0x54585050u
+#define TRACE_FORMAT 1
+
+#define TRACE_CORES 2
+
+//  Power of two
+#define TRACE_EVENTS_PER_CORE 512
+
+enum TraceEventTypes
+{
+    //  Core 0 starts rendering a frame, argument is the effect
+    TRACE_FRAME_START = 1,
+
+    //  Core 0 has written the frame out, argument is the pixel count
+    TRACE_FRAME_PRESENT = 2,
+
+    //  A flash playback frame has left DMA, argument counts frames played
+    TRACE_DMA_DONE = 3,
+
+    //  A streamed frame is complete in the back buffer, argument is its sequence number
+    TRACE_STREAM_FRAME = 4,
+
+    //  Something changed because of the console or the stream, argument is command << 8 | value
+    TRACE_COMMAND = 5,
+
+    //  A console key came in, argument is the character
+    TRACE_INPUT = 6,
+
+    //  Data interface bytes that didn't fit in the TX FIFO, argument is the count (saturates)
+    TRACE_USB_TX_DROP = 7,
+
+    //  Where the dump was asked for
+    TRACE_DUMP = 8,
+
+    //  Core 0's frame ran the FIFO dry, argument is how many times
+    TRACE_UNDERRUN = 9
+};
+
+enum TraceCommands
+{
+    TRACE_COMMAND_EFFECT = 1,
+    TRACE_COMMAND_PAUSE = 2,
+    TRACE_COMMAND_OUTPUT = 3,
+    TRACE_COMMAND_COMMIT = 4,
+    TRACE_COMMAND_BOOT_FRAME = 5,
+    TRACE_COMMAND_STREAM = 6
+};
+
+struct TraceEvent
+{
+    uint32_t timeUs;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t argument;
+};
+
+struct TraceDumpHeader
+{
+    uint32_t magic;
+    uint16_t format;
+    uint8_t cores;
+    uint8_t reserved;
+    uint64_t timeUs;
+};
+
+//  Record an event on the calling core
+void TraceRecord(uint8_t type, uint16_t argument);
+
+//
+//  Dumping, from core 1
+//
+
+//  Stop recording and start a dump, false if one is already going
+bool TraceDumpStart();
+
+//  Copy the next part of the dump to buffer, up to length bytes.  Returns how many, 0 once it's all gone,
+//  after which recording starts again.
+int TraceDumpRead(uint8_t* buffer, int length);
+
+bool TraceDumpActive();
+
+//  Give up on a dump nobody is reading, and start recording again
+void TraceDumpStop();
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
+
+//
+//  TinyUSB configuration for the composite console + data device, see usb_descriptors.c
+//
+
+#define CFG_TUSB_RHPORT0_MODE (OPT_MODE_DEVICE)
+
+#define CFG_TUD_ENDPOINT0_SIZE (64)
+
+//  Interface 0 is the terminal console, interface 1 is the frame stream/telemetry data channel.
+//  TinyUSB gives each CDC interface its own RX and TX FIFO of these sizes.
+#define CFG_TUD_CDC (2)
+#define CFG_TUD_CDC_RX_BUFSIZE (1024)
+#define CFG_TUD_CDC_TX_BUFSIZE (1024)
+#define CFG_TUD_CDC_EP_BUFSIZE (64)
+
+#define CFG_TUD_MSC (0)
+#define CFG_TUD_HID (0)
+#define CFG_TUD_MIDI (0)
+#define CFG_TUD_VENDOR (0)
+
+#endif
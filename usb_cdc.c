@@ -0,0 +1,120 @@
+#include "pico/stdlib.h"
+#include "pico/stdio.h"
+#include "pico/stdio/driver.h"
+#include "tusb.h"
+#include "usb_cdc.h"
+#include "trace.h"
+
+//  Longest console output waits for the host to drain the TX FIFO before giving up
+const uint64_t USB_CONSOLE_TX_TIMEOUT_US = 50000;
+
+uint32_t UsbDataTxDropped = 0;
+
+//
+//  Console stdio driver
+//
+static void UsbConsoleOutChars(const char* buffer, int length)
+{
+    //  Nobody listening, don't stall the interface
+    if (!tud_cdc_n_connected(USB_CDC_CONSOLE))
+    {
+        return;
+    }
+
+    uint64_t deadline = time_us_64() + USB_CONSOLE_TX_TIMEOUT_US;
+    int sent = 0;
+
+    while (sent < length)
+    {
+        sent += tud_cdc_n_write(USB_CDC_CONSOLE, buffer + sent, length - sent);
+
+        if (sent < length)
+        {
+            //  FIFO full, push it out and let USB run until there's room
+            tud_cdc_n_write_flush(USB_CDC_CONSOLE);
+            tud_task();
+
+            if (!tud_cdc_n_connected(USB_CDC_CONSOLE) || time_us_64() > deadline)
+            {
+                return;
+            }
+        }
+    }
+}
+
+static void UsbConsoleOutFlush()
+{
+    tud_cdc_n_write_flush(USB_CDC_CONSOLE);
+}
+
+static int UsbConsoleInChars(char* buffer, int length)
+{
+    if (!tud_cdc_n_available(USB_CDC_CONSOLE))
+    {
+        return PICO_ERROR_NO_DATA;
+    }
+
+    return tud_cdc_n_read(USB_CDC_CONSOLE, buffer, length);
+}
+
+static stdio_driver_t UsbConsoleDriver =
+        {
+                .out_chars = UsbConsoleOutChars,
+                .out_flush = UsbConsoleOutFlush,
+                .in_chars = UsbConsoleInChars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+                .crlf_enabled = PICO_STDIO_DEFAULT_CRLF
+#endif
+        };
+
+void UsbCdcInit()
+{
+    tusb_init();
+
+    stdio_set_driver_enabled(&UsbConsoleDriver, true);
+}
+
+void UsbCdcTask()
+{
+    tud_task();
+
+    //  Send anything left sitting in the FIFOs
+    tud_cdc_n_write_flush(USB_CDC_CONSOLE);
+    tud_cdc_n_write_flush(USB_CDC_DATA);
+}
+
+//
+//  Data interface
+//
+int UsbDataRead(uint8_t* buffer, int length)
+{
+    if (!tud_cdc_n_available(USB_CDC_DATA))
+    {
+        return 0;
+    }
+
+    return tud_cdc_n_read(USB_CDC_DATA, buffer, length);
+}
+
+int UsbDataWrite(const uint8_t* data, int length)
+{
+    int written = tud_cdc_n_write(USB_CDC_DATA, data, length);
+
+    if (written < length)
+    {
+        UsbDataTxDropped += length - written;
+        TraceRecord(TRACE_USB_TX_DROP, length - written > 0xFFFF ? 0xFFFF : length - written);
+    }
+
+    return written;
+}
+
+int UsbDataWriteAvailable()
+{
+    return tud_cdc_n_write_available(USB_CDC_DATA);
+}
+
+bool UsbDataConnected()
+{
+    return tud_cdc_n_connected(USB_CDC_DATA);
+}
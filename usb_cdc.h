@@ -0,0 +1,36 @@
+#ifndef PICOPIXOS_USB_CDC_H
+#define PICOPIXOS_USB_CDC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+//  USB CDC Interfaces
+//
+//  The console interface carries stdio (the terminal interface), the data interface carries frame streams and
+//  telemetry so bulk traffic never queues up behind terminal output.  Everything here, including printf, has to
+//  be called from the core that called UsbCdcInit.
+//
+
+#define USB_CDC_CONSOLE 0
+#define USB_CDC_DATA 1
+
+//  Bytes that didn't fit in the data interface TX FIFO
+extern uint32_t UsbDataTxDropped;
+
+//  Bring up USB and register the console as a stdio driver
+void UsbCdcInit();
+
+//  Service USB, call frequently
+void UsbCdcTask();
+
+//  Non-blocking data interface access, both return the number of bytes moved
+int UsbDataRead(uint8_t* buffer, int length);
+int UsbDataWrite(const uint8_t* data, int length);
+
+//  Bytes UsbDataWrite can take right now without dropping any
+int UsbDataWriteAvailable();
+
+bool UsbDataConnected();
+
+#endif
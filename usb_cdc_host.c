@@ -0,0 +1,96 @@
+//
+//  Host stand-in for usb_cdc.c
+//
+//  Each CDC interface becomes a pty, whose name is printed at start up.  Point a terminal at the console one
+//  and pixsend at the data one.  The console is made stdin and stdout so printf and HalConsoleRead use it.
+//
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "usb_cdc.h"
+#include "trace.h"
+
+uint32_t UsbDataTxDropped = 0;
+
+static int DataPty = -1;
+
+static int HostOpenPty(const char* name)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        fprintf(stderr, "Can't open a pty for the %s\n", name);
+        exit(1);
+    }
+
+    //  Hold the other end open so there's no hangup between connections, and make it raw like a CDC port
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    struct termios options;
+    tcgetattr(slave, &options);
+    cfmakeraw(&options);
+    tcsetattr(slave, TCSANOW, &options);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    fprintf(stderr, "USB %s on %s\n", name, ptsname(master));
+
+    return master;
+}
+
+void UsbCdcInit()
+{
+    int console = HostOpenPty("console");
+
+    dup2(console, STDIN_FILENO);
+    dup2(console, STDOUT_FILENO);
+
+    DataPty = HostOpenPty("data");
+}
+
+void UsbCdcTask()
+{
+}
+
+int UsbDataRead(uint8_t* buffer, int length)
+{
+    ssize_t received = read(DataPty, buffer, length);
+
+    return received > 0 ? (int) received : 0;
+}
+
+int UsbDataWrite(const uint8_t* data, int length)
+{
+    ssize_t sent = write(DataPty, data, length);
+
+    if (sent < 0)
+    {
+        sent = 0;
+    }
+
+    if (sent < length)
+    {
+        UsbDataTxDropped += length - sent;
+        TraceRecord(TRACE_USB_TX_DROP, length - sent > 0xFFFF ? 0xFFFF : length - sent);
+    }
+
+    return (int) sent;
+}
+
+int UsbDataWriteAvailable()
+{
+    struct pollfd output = {DataPty, POLLOUT, 0};
+
+    //  No telling how much room a pty has, offer what a USB FIFO would once it has any
+    return poll(&output, 1, 0) > 0 && (output.revents & POLLOUT) ? 256 : 0;
+}
+
+bool UsbDataConnected()
+{
+    return DataPty >= 0;
+}
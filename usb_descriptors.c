@@ -0,0 +1,144 @@
+#include "tusb.h"
+#include "pico/unique_id.h"
+
+//
+//  USB Descriptors
+//
+//  Composite device with two CDC ACM interfaces: the terminal console and a data channel reserved for
+//  frame streaming and telemetry.
+//
+
+#define USBD_VID 0x2E8A
+#define USBD_PID 0x000A
+
+#define USBD_CDC_NOTIFY_SIZE 8
+#define USBD_CDC_DATA_SIZE 64
+
+//  Endpoints
+#define EPNUM_CONSOLE_NOTIFY 0x81
+#define EPNUM_CONSOLE_OUT 0x02
+#define EPNUM_CONSOLE_IN 0x82
+#define EPNUM_DATA_NOTIFY 0x83
+#define EPNUM_DATA_OUT 0x04
+#define EPNUM_DATA_IN 0x84
+
+//  Interfaces
+enum
+{
+    ITF_NUM_CONSOLE = 0,
+    ITF_NUM_CONSOLE_DATA,
+    ITF_NUM_DATA,
+    ITF_NUM_DATA_DATA,
+    ITF_NUM_TOTAL
+};
+
+//  Strings
+enum
+{
+    STRING_LANGUAGE = 0,
+    STRING_MANUFACTURER,
+    STRING_PRODUCT,
+    STRING_SERIAL,
+    STRING_CONSOLE,
+    STRING_DATA,
+    STRING_COUNT
+};
+
+#define USBD_CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_CDC * TUD_CDC_DESC_LEN)
+#define USBD_MAX_POWER_MA 250
+#define USBD_STRING_MAX 32
+
+static const tusb_desc_device_t DeviceDescriptor =
+        {
+                .bLength = sizeof(tusb_desc_device_t),
+                .bDescriptorType = TUSB_DESC_DEVICE,
+                .bcdUSB = 0x0200,
+
+                //  Interface association, needed for more than one CDC
+                .bDeviceClass = TUSB_CLASS_MISC,
+                .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+                .bDeviceProtocol = MISC_PROTOCOL_IAD,
+
+                .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+                .idVendor = USBD_VID,
+                .idProduct = USBD_PID,
+                .bcdDevice = 0x0100,
+                .iManufacturer = STRING_MANUFACTURER,
+                .iProduct = STRING_PRODUCT,
+                .iSerialNumber = STRING_SERIAL,
+                .bNumConfigurations = 1
+        };
+
+static const uint8_t ConfigurationDescriptor[] =
+        {
+                TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, USBD_CONFIG_TOTAL_LEN, 0, USBD_MAX_POWER_MA),
+
+                TUD_CDC_DESCRIPTOR(ITF_NUM_CONSOLE, STRING_CONSOLE, EPNUM_CONSOLE_NOTIFY, USBD_CDC_NOTIFY_SIZE,
+                                   EPNUM_CONSOLE_OUT, EPNUM_CONSOLE_IN, USBD_CDC_DATA_SIZE),
+
+                TUD_CDC_DESCRIPTOR(ITF_NUM_DATA, STRING_DATA, EPNUM_DATA_NOTIFY, USBD_CDC_NOTIFY_SIZE,
+                                   EPNUM_DATA_OUT, EPNUM_DATA_IN, USBD_CDC_DATA_SIZE),
+        };
+
+static char SerialString[PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1];
+
+static const char* const StringDescriptors[STRING_COUNT] =
+        {
+                NULL,               //  Language, handled separately
+                "Raspberry Pi",
+                "Pico Pix OS",
+                SerialString,
+                "Pico Pix OS Console",
+                "Pico Pix OS Data"
+        };
+
+const uint8_t* tud_descriptor_device_cb(void)
+{
+    return (const uint8_t*) &DeviceDescriptor;
+}
+
+const uint8_t* tud_descriptor_configuration_cb(uint8_t index)
+{
+    (void) index;
+    return ConfigurationDescriptor;
+}
+
+const uint16_t* tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+    static uint16_t descriptor[USBD_STRING_MAX + 1];
+    int length;
+
+    (void) langid;
+
+    if (index == STRING_LANGUAGE)
+    {
+        //  English (US)
+        descriptor[1] = 0x0409;
+        length = 1;
+    }
+    else
+    {
+        if (index >= STRING_COUNT)
+        {
+            return NULL;
+        }
+
+        if (index == STRING_SERIAL && SerialString[0] == 0)
+        {
+            pico_get_unique_board_id_string(SerialString, sizeof(SerialString));
+        }
+
+        const char* string = StringDescriptors[index];
+
+        //  ASCII to UTF-16
+        for (length = 0; string[length] != 0 && length < USBD_STRING_MAX; length++)
+        {
+            descriptor[1 + length] = string[length];
+        }
+    }
+
+    //  First entry is the byte length and descriptor type
+    descriptor[0] = (TUSB_DESC_STRING << 8) | (2 * length + 2);
+
+    return descriptor;
+}
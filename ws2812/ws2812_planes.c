@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "ws2812_planes.h"
+
+void add_error(value_bits_t *d, const value_bits_t *s, const value_bits_t *e) {
+    uint32_t carry_plane = 0;
+    // add the FRAC_BITS low planes
+    for (int p = VALUE_PLANE_COUNT - 1; p >= 8; p--) {
+        uint32_t e_plane = e->planes[p];
+        uint32_t s_plane = s->planes[p];
+        d->planes[p] = (e_plane ^ s_plane) ^ carry_plane;
+        carry_plane = (e_plane & s_plane) | (carry_plane & (s_plane ^ e_plane));
+    }
+    // then just ripple carry through the non fractional bits
+    for (int p = 7; p >= 0; p--) {
+        uint32_t s_plane = s->planes[p];
+        d->planes[p] = s_plane ^ carry_plane;
+        carry_plane &= s_plane;
+    }
+}
+
+void transform_strings(string_t **strings, unsigned int num_strings, value_bits_t *values, unsigned int value_length,
+                       unsigned int frac_brightness) {
+    for (unsigned int v = 0; v < value_length; v++) {
+        memset(&values[v], 0, sizeof(values[v]));
+        for (unsigned int i = 0; i < num_strings; i++) {
+            if (v < strings[i]->data_len) {
+                // todo clamp?
+                uint32_t value = (strings[i]->data[v] * strings[i]->frac_brightness) >> 8u;
+                value = (value * frac_brightness) >> 8u;
+                for (int j = 0; j < VALUE_PLANE_COUNT && value; j++, value >>= 1u) {
+                    if (value & 1u) values[v].planes[VALUE_PLANE_COUNT - 1 - j] |= 1u << i;
+                }
+            }
+        }
+    }
+}
+
+void dither_values(const value_bits_t *colors, value_bits_t *state, const value_bits_t *old_state, unsigned int value_length) {
+    for (unsigned int i = 0; i < value_length; i++) {
+        add_error(state + i, colors + i, old_state + i);
+    }
+}
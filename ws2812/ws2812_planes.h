@@ -0,0 +1,39 @@
+/**
+ * Copyright (c) 2020 Raspberry Pi (Trading) Ltd.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _WS2812_PLANES_H
+#define _WS2812_PLANES_H
+
+#include <stdint.h>
+
+// bit plane transform and dithering used by ws2812_parallel.c, split out so it can be benchmarked on its own
+
+#define FRAC_BITS 4
+
+#define VALUE_PLANE_COUNT (8 + FRAC_BITS)
+// we store value (8 bits + fractional bits of a single color (R/G/B/W) value) for multiple
+// strings, in bit planes. bit plane N has the Nth bit of each string.
+typedef struct {
+    // stored MSB first
+    uint32_t planes[VALUE_PLANE_COUNT];
+} value_bits_t;
+
+typedef struct {
+    uint8_t *data;
+    unsigned int data_len;
+    unsigned int frac_brightness; // 256 = *1.0;
+} string_t;
+
+// Add FRAC_BITS planes of e to s and store in d
+void add_error(value_bits_t *d, const value_bits_t *s, const value_bits_t *e);
+
+// takes 8 bit color values, multiply by brightness and store in bit planes
+void transform_strings(string_t **strings, unsigned int num_strings, value_bits_t *values, unsigned int value_length,
+                       unsigned int frac_brightness);
+
+void dither_values(const value_bits_t *colors, value_bits_t *state, const value_bits_t *old_state, unsigned int value_length);
+
+#endif